@@ -0,0 +1,252 @@
+#ifndef CMX_BARRIER_H
+#define CMX_BARRIER_H 1
+
+#include <limits.h>
+#include <stdint.h>
+
+#include <cmx/cmx-env.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Reusable barrier and phaser for threads computing in phases.
+ **
+ ** @section Idea behind
+ **
+ ** Barrier: every thread decrements arrival counter, last one resets
+ ** it and advances phase word (sense reversal: threads wait until
+ ** phase differs from the one they arrived at, so barrier is reusable
+ ** without per-thread state). Waiting threads spin for a while and then
+ ** park on phase word (CMX_ATOMIC_INT_WAIT, futex / condition).
+ **
+ ** Phaser: barrier with dynamic number of parties. Number of parties
+ ** and number of parties not yet arrived share one 64-bit atomic word,
+ ** so registration, arrival and deregistration are single
+ ** compare-and-swap each.
+ **
+ ** Macros require environment with CMX_ATOMIC_INT_, CMX_ATOMIC_INT64_
+ ** and CMX_ATOMIC_INT_WAIT / CMX_ATOMIC_INT_WAKE_ALL defined.
+ **
+ ** @section Proposed usage
+ **
+ **     CMX_BARRIER_DEFINE barrier;
+ **
+ **     CMX_BARRIER_INIT (&barrier, workers);
+ **
+ **     worker:
+ **         for (step = 0; step < steps; ++step) {
+ **             compute (step);
+ **             if (CMX_BARRIER_WAIT (&barrier))
+ **                 merge (step);           // one thread per phase
+ **             CMX_BARRIER_WAIT (&barrier);
+ **         }
+ **
+ **     CMX_PHASER_DEFINE phaser;
+ **
+ **     CMX_PHASER_INIT (&phaser, 1);
+ **     CMX_PHASER_REGISTER (&phaser);       // before worker starts
+ **     start_worker ();
+ **
+ **     worker:
+ **         CMX_PHASER_ARRIVE_AND_WAIT (&phaser);
+ **         ...
+ **         CMX_PHASER_ARRIVE_AND_DEREGISTER (&phaser);
+ **/
+
+#ifndef CMX_BARRIER_SPIN
+#define CMX_BARRIER_SPIN                                                \
+    128
+/**<Number of checks of waiting thread before it parks
+ **/
+#endif
+
+struct CMX_Barrier {
+    CMX_ATOMIC_INT_TYPE remaining;
+    CMX_ATOMIC_INT_TYPE phase;
+    int parties;
+};
+
+struct CMX_Phaser {
+    CMX_ATOMIC_INT64_TYPE state;
+    CMX_ATOMIC_INT_TYPE phase;
+};
+
+#define CMX_BARRIER_DEFINE                                              \
+    struct CMX_Barrier
+/**<Barrier type specifier
+ **
+ ** Usage:
+ **   CMX_BARRIER_DEFINE barrier;
+ **/
+
+#define CMX_BARRIER_INIT(Barrier, Parties)                              \
+    cmx_barrier_init ((Barrier), (Parties))
+/**<Initialize barrier for Parties threads
+ **
+ ** @param Barrier pointer to CMX_BARRIER_DEFINE variable
+ ** @param Parties number of threads evaluating CMX_BARRIER_WAIT
+ **                in every phase
+ **/
+
+#define CMX_BARRIER_WAIT(Barrier)                                       \
+    cmx_barrier_wait (Barrier)
+/**<Wait until all parties arrive
+ **
+ ** Evaluates TRUE in exactly one thread of every phase (the last one
+ ** arriving), FALSE in others.
+ **/
+
+#define CMX_PHASER_DEFINE                                               \
+    struct CMX_Phaser
+/**<Phaser type specifier
+ **/
+
+#define CMX_PHASER_INIT(Phaser, Parties)                                \
+    cmx_phaser_init ((Phaser), (Parties))
+/**<Initialize phaser with Parties registered parties
+ **/
+
+#define CMX_PHASER_PHASE(Phaser)                                        \
+    CMX_ATOMIC_INT_LOAD ((Phaser)->phase)
+/**<Current phase number
+ **
+ ** Phase number wraps around from INT_MAX to INT_MIN.
+ **/
+
+#define CMX_PHASER_REGISTER(Phaser)                                     \
+    cmx_phaser_update ((Phaser), 1, 1)
+/**<Register new party
+ **
+ ** New party participates in current phase. Register party before
+ ** handing it over to new thread (by already registered party),
+ ** otherwise current phase may finish without it.
+ ** Evaluates current phase number.
+ **/
+
+#define CMX_PHASER_ARRIVE(Phaser)                                       \
+    cmx_phaser_update ((Phaser), 0, -1)
+/**<Arrive at phaser without waiting for others
+ **
+ ** Evaluates phase number party arrived at.
+ **/
+
+#define CMX_PHASER_ARRIVE_AND_DEREGISTER(Phaser)                        \
+    cmx_phaser_update ((Phaser), -1, -1)
+/**<Arrive at phaser and deregister party
+ **
+ ** Evaluates phase number party arrived at.
+ **/
+
+#define CMX_PHASER_ARRIVE_AND_WAIT(Phaser)                              \
+    cmx_barrier_await (                                                 \
+        & (Phaser)->phase,                                              \
+        CMX_PHASER_ARRIVE (Phaser)                                      \
+    )
+/**<Arrive at phaser and wait until all other parties arrive
+ **
+ ** Evaluates phase number party arrived at.
+ **/
+
+static inline int
+cmx_barrier_await (CMX_ATOMIC_INT_TYPE *phase, int arrived) {
+    int spin;
+
+    for (spin = 0; spin < CMX_BARRIER_SPIN; ++spin)
+        if (arrived != CMX_ATOMIC_INT_LOAD (*phase))
+            return arrived;
+
+    while (arrived == CMX_ATOMIC_INT_LOAD (*phase))
+        CMX_ATOMIC_INT_WAIT (*phase, arrived);
+
+    return arrived;
+}
+/**<Implementation function
+ **
+ ** Wait until phase word differs from arrived phase,
+ ** spin first, then park.
+ **/
+
+static inline void
+cmx_barrier_advance (CMX_ATOMIC_INT_TYPE *phase, int arrived) {
+    CMX_ATOMIC_INT_STORE (*phase, INT_MAX == arrived ? INT_MIN : arrived + 1);
+    CMX_ATOMIC_INT_WAKE_ALL (*phase);
+}
+/**<Implementation function
+ **
+ ** Phase wraps from INT_MAX to INT_MIN (without signed overflow),
+ ** waiting threads compare phases only for equality.
+ **/
+
+static inline void
+cmx_barrier_init (struct CMX_Barrier *barrier, int parties) {
+    barrier->parties = parties;
+    CMX_ATOMIC_INT_STORE (barrier->remaining, parties);
+    CMX_ATOMIC_INT_STORE (barrier->phase, 0);
+}
+/**<Implementation function
+ **/
+
+static inline int
+cmx_barrier_wait (struct CMX_Barrier *barrier) {
+    int arrived = CMX_ATOMIC_INT_LOAD (barrier->phase);
+
+    if (1 == CMX_ATOMIC_INT_FETCH_SUB (barrier->remaining, 1)) {
+        CMX_ATOMIC_INT_STORE (barrier->remaining, barrier->parties);
+        cmx_barrier_advance (&barrier->phase, arrived);
+        return 1;
+    }
+
+    cmx_barrier_await (&barrier->phase, arrived);
+    return 0;
+}
+/**<Implementation function
+ **
+ ** Phase must be read before arrival, it cannot advance until
+ ** current thread arrives. Counter is reset before phase advances,
+ ** so threads of next phase see reset counter.
+ **/
+
+#define CMX_PHASER_STATE(Parties, Unarrived)                            \
+    ((int64_t) (Parties) << 32 | (uint32_t) (Unarrived))
+/**<Implementation macro: pack phaser state
+ **/
+
+static inline void
+cmx_phaser_init (struct CMX_Phaser *phaser, int parties) {
+    CMX_ATOMIC_INT64_STORE (phaser->state, CMX_PHASER_STATE (parties, parties));
+    CMX_ATOMIC_INT_STORE (phaser->phase, 0);
+}
+/**<Implementation function
+ **/
+
+static inline int
+cmx_phaser_update (struct CMX_Phaser *phaser, int parties, int unarrived) {
+    int64_t state = CMX_ATOMIC_INT64_LOAD (phaser->state);
+    int arrived = CMX_ATOMIC_INT_LOAD (phaser->phase);
+    int64_t update;
+    int count;
+    int left;
+
+    do {
+        count = (int) (state >> 32) + parties;
+        left = (int) (uint32_t) state + unarrived;
+        update = 0 == left
+            ? CMX_PHASER_STATE (count, count)
+            : CMX_PHASER_STATE (count, left);
+    } while (! CMX_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK (phaser->state, state, update));
+
+    if (0 == left)
+        cmx_barrier_advance (&phaser->phase, arrived);
+
+    return arrived;
+}
+/**<Implementation function
+ **
+ ** Phase is read before update, it cannot advance until current party
+ ** arrives (registration is done by already registered party).
+ ** Last arrival resets number of unarrived parties to number of
+ ** parties (without deregistered ones) and advances phase.
+ **/
+
+#endif  /* guard */
@@ -0,0 +1,227 @@
+#ifndef CMX_BIASED_LOCK_H
+#define CMX_BIASED_LOCK_H 1
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-meta.h>
+#include <cmx/cmx-env.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Biased lock: mutex locked by its owner thread without atomic
+ ** read-modify-write operations.
+ **
+ ** @section Idea behind
+ **
+ ** Many locks are taken almost exclusively by one thread, still every
+ ** lock / unlock pays atomic operation (and memory barrier).
+ **
+ ** Lock is biased towards the first thread locking it (owner). Owner
+ ** announces critical section with plain store into busy flag, checks
+ ** bias was not revoked and enters. Unlock is plain (release) store.
+ **
+ ** Other thread (rare) locks mutex and revokes the bias: it marks lock
+ ** revoked, issues process-wide memory barrier (CMX_MEMBARRIER,
+ ** membarrier(2) on Linux) and waits until owner leaves its critical
+ ** section. Barrier guarantees that either owner sees revocation or
+ ** revoking thread sees busy flag, so owner needs only compiler
+ ** barrier. Once revoked, all threads (including owner) use mutex.
+ **
+ ** Without process-wide barrier both sides use full memory barrier,
+ ** owner path still avoids atomic read-modify-write.
+ **
+ ** Macros require environment with CMX_ATOMIC_INT_, CMX_MUTEX_,
+ ** CMX_THREAD_SELF, CMX_THREAD_EQUAL, CMX_ATOMIC_FENCE and
+ ** CMX_COMPILER_FENCE defined. Lock cannot be shared by processes.
+ **
+ ** @section Proposed usage
+ **
+ **     struct CMX_Biased_Lock lock;
+ **
+ **     CMX_BIASED_LOCK_INIT (&lock);
+ **
+ **     CMX_SYNCHRONIZE_BIASED (&lock) {
+ **         ...
+ **     }
+ **/
+
+#define CMX_BIASED_LOCK_UNOWNED                                         \
+    0
+/**<Lock state: no thread locked it yet
+ **/
+
+#define CMX_BIASED_LOCK_CLAIMING                                        \
+    1
+/**<Lock state: first thread is becoming owner
+ **/
+
+#define CMX_BIASED_LOCK_BIASED                                          \
+    2
+/**<Lock state: owner may lock it without mutex
+ **/
+
+#define CMX_BIASED_LOCK_REVOKED                                         \
+    3
+/**<Lock state: every thread uses mutex
+ **/
+
+struct CMX_Biased_Lock {
+    CMX_ATOMIC_INT_TYPE state;
+    CMX_ATOMIC_INT_TYPE busy;
+    int membarrier;
+    CMX_THREAD_TYPE owner;
+    CMX_MUTEX_TYPE mutex;
+};
+
+#define CMX_BIASED_LOCK_INIT(Lock)                                      \
+    cmx_biased_lock_init (Lock)
+/**<Initialize biased lock
+ **
+ ** @param Lock pointer to struct CMX_Biased_Lock
+ **/
+
+#define CMX_BIASED_LOCK_MUTEX(Lock)                                     \
+    cmx_biased_lock_mutex (Lock)
+/**<Revoke bias and evaluate pointer to lock's mutex
+ **
+ ** Intended for code locking mutex directly
+ ** (eg. CMX_SYNCHRONIZE_MULTI).
+ **/
+
+#define CMX_SYNCHRONIZE_BIASED(Lock)                                    \
+    CMX_SYNCHRONIZE_BIASED_TRAN (                                       \
+        CMX_UNIQUE_TOKEN (CMX_SYNCHRONIZE_BIASED),                      \
+        Lock                                                            \
+    )
+/**<Synchronize following statement / block using biased lock
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** @param Lock pointer to struct CMX_Biased_Lock
+ **
+ ** Usage:
+ **   CMX_SYNCHRONIZE_BIASED (&lock) { ... }
+ **/
+
+#define CMX_SYNCHRONIZE_BIASED_TRAN(Prefix, Lock)                       \
+    CMX_SYNCHRONIZE_BIASED_IMPL (                                       \
+        CMX_TOKEN (Prefix, Self),                                       \
+        CMX_TOKEN (Prefix, Biased),                                     \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Finish),                                     \
+        Lock                                                            \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_SYNCHRONIZE_BIASED_IMPL(Name, Biased, Body, Finish, Lock)   \
+    if (1) {                                                            \
+        struct CMX_Biased_Lock *Name = (Lock);                          \
+        int Biased = cmx_biased_lock_acquire (Name);                    \
+        goto Body;                                                      \
+    Finish:                                                             \
+        cmx_biased_lock_release (Name, Biased);                         \
+    } else CMX_META_BODY_BREAK (Body, Finish)
+/**<Implementation macro
+ **/
+
+static inline void
+cmx_biased_lock_init (struct CMX_Biased_Lock *lock) {
+    CMX_ATOMIC_INT_STORE (lock->state, CMX_BIASED_LOCK_UNOWNED);
+    CMX_ATOMIC_INT_STORE (lock->busy, 0);
+    lock->membarrier = CMX_MEMBARRIER_INIT ();
+    CMX_MUTEX_INIT (lock->mutex);
+}
+/**<Implementation function
+ **/
+
+static CMX_COLD void
+cmx_biased_lock_revoke (struct CMX_Biased_Lock *lock) {
+    if (CMX_BIASED_LOCK_REVOKED == CMX_ATOMIC_INT_EXCHANGE (lock->state, CMX_BIASED_LOCK_REVOKED))
+        return;
+
+    if (lock->membarrier)
+        CMX_MEMBARRIER ();
+    else
+        CMX_ATOMIC_FENCE ();
+
+    while (CMX_ATOMIC_INT_LOAD (lock->busy))
+        CMX_THREAD_YIELD ();
+}
+/**<Implementation function
+ **
+ ** Caller holds mutex, so revocation is finished (owner left its
+ ** critical section) before any other thread gets mutex.
+ ** Revocation happens once per lock, it is out of line.
+ **/
+
+static inline int
+cmx_biased_lock_acquire (struct CMX_Biased_Lock *lock) {
+    int state = CMX_ATOMIC_INT_LOAD (lock->state);
+    int expected;
+
+    if (CMX_BIASED_LOCK_UNOWNED == state
+        && CMX_ATOMIC_INT_COMPARE_EXCHANGE (lock->state, state, CMX_BIASED_LOCK_CLAIMING)) {
+        lock->owner = CMX_THREAD_SELF ();
+        expected = CMX_BIASED_LOCK_CLAIMING;
+        state = CMX_ATOMIC_INT_COMPARE_EXCHANGE (lock->state, expected, CMX_BIASED_LOCK_BIASED)
+            ? CMX_BIASED_LOCK_BIASED
+            : CMX_BIASED_LOCK_REVOKED;
+    }
+
+    if (CMX_BIASED_LOCK_BIASED == state
+        && CMX_THREAD_EQUAL (lock->owner, CMX_THREAD_SELF ())) {
+        CMX_ATOMIC_INT_STORE (lock->busy, 1);
+        if (lock->membarrier)
+            CMX_COMPILER_FENCE ();
+        else
+            CMX_ATOMIC_FENCE ();
+
+        if (CMX_BIASED_LOCK_BIASED == CMX_ATOMIC_INT_LOAD (lock->state))
+            return 1;
+
+        CMX_ATOMIC_INT_STORE (lock->busy, 0);
+    }
+
+    CMX_MUTEX_LOCK (lock->mutex);
+    if (CMX_UNLIKELY (CMX_BIASED_LOCK_REVOKED != state))
+        cmx_biased_lock_revoke (lock);
+
+    return 0;
+}
+/**<Implementation function
+ **
+ ** Returns TRUE if lock was taken by owner without mutex.
+ ** Owner is published by release compare-and-swap to BIASED, it is
+ ** read only after acquire load of BIASED. Thread revoking the bias
+ ** while first thread is claiming it makes claim fail.
+ ** REVOKED is final state, once it is loaded mutex path skips revoke.
+ **/
+
+static inline void
+cmx_biased_lock_release (struct CMX_Biased_Lock *lock, int biased) {
+    if (biased)
+        CMX_ATOMIC_INT_STORE (lock->busy, 0);
+    else
+        CMX_MUTEX_UNLOCK (lock->mutex);
+}
+/**<Implementation function
+ **/
+
+static inline CMX_MUTEX_TYPE *
+cmx_biased_lock_mutex (struct CMX_Biased_Lock *lock) {
+    if (CMX_BIASED_LOCK_REVOKED != CMX_ATOMIC_INT_LOAD (lock->state)) {
+        CMX_MUTEX_LOCK (lock->mutex);
+        cmx_biased_lock_revoke (lock);
+        CMX_MUTEX_UNLOCK (lock->mutex);
+    }
+
+    return &lock->mutex;
+}
+/**<Implementation function
+ **/
+
+#endif  /* guard */
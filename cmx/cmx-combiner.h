@@ -0,0 +1,186 @@
+#ifndef CMX_COMBINER_H
+#define CMX_COMBINER_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-env.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Flat combining: synchronized operations executed in batches by
+ ** one thread.
+ **
+ ** @section Idea behind
+ **
+ ** When critical section is short and contention is high, threads
+ ** spend more time passing the mutex (and protected data) between
+ ** cores than in the critical section itself.
+ **
+ ** With flat combining every thread publishes its operation (request
+ ** record living on its stack) into combiner's lock-free list. Thread
+ ** acquiring combiner lock becomes combiner, takes whole list and
+ ** evaluates all pending operations in one pass, protected data stay
+ ** in its cache. Other threads only wait until their operation is
+ ** marked as done.
+ **
+ ** Operation cannot be a block (C has no closures, block cannot be
+ ** evaluated by another thread), it is a function with argument.
+ ** Function must not use thread local data of calling thread and
+ ** must not use the same combiner.
+ **
+ ** All operations on protected data must go through the combiner.
+ **
+ ** Macros require environment with CMX_ATOMIC_INT_ and CMX_ATOMIC_PTR_
+ ** defined.
+ **
+ ** @section Proposed usage
+ **
+ **     struct CMX_Combiner combiner = CMX_COMBINER_INITIALIZER;
+ **
+ **     void counter_add (void *arg) {
+ **         struct Add *add = arg;
+ **         add->result = counter += add->value;
+ **     }
+ **
+ **     struct Add add = { .value = 2 };
+ **     CMX_SYNCHRONIZE_COMBINING (&combiner, counter_add, &add);
+ **     use (add.result);
+ **/
+
+#ifndef CMX_COMBINER_SPIN
+#define CMX_COMBINER_SPIN                                               \
+    64
+/**<Number of checks of waiting thread before it yields CPU
+ **/
+#endif
+
+#ifndef CMX_COMBINER_PASSES
+#define CMX_COMBINER_PASSES                                             \
+    4
+/**<Max number of passes over pending list done by one combiner
+ **
+ ** Limits time thread spends executing operations of others.
+ **/
+#endif
+
+struct _CMX_Combiner_Record {
+    struct _CMX_Combiner_Record *next;
+    void (* function) (void *);
+    void *arg;
+    CMX_ATOMIC_INT_TYPE done;
+};
+
+struct CMX_Combiner {
+    CMX_ATOMIC_PTR_TYPE (struct _CMX_Combiner_Record) pending;
+    CMX_ATOMIC_INT_TYPE lock;
+    char padding[CMX_CACHE_LINE_SIZE];
+};
+
+#define CMX_COMBINER_INITIALIZER                                        \
+    { NULL, 0, { 0 } }
+/**<Static initializer of struct CMX_Combiner
+ **/
+
+#define CMX_COMBINER_INIT(Combiner)                                     \
+    cmx_combiner_init (Combiner)
+/**<Initialize combiner
+ **
+ ** @param Combiner pointer to struct CMX_Combiner
+ **/
+
+#define CMX_SYNCHRONIZE_COMBINING(Combiner, Function, Arg)              \
+    cmx_combiner_execute ((Combiner), (Function), (Arg))
+/**<Evaluate Function (Arg) synchronized by Combiner
+ **
+ ** Function is evaluated by current thread or by another thread
+ ** holding combiner, macro returns once it was evaluated.
+ ** All functions using same combiner are evaluated one by one.
+ **
+ ** @param Combiner pointer to struct CMX_Combiner
+ ** @param Function void Function (void *)
+ ** @param Arg      function argument (eg. pointer to struct with
+ **                 arguments and results)
+ **
+ ** Usage:
+ **   CMX_SYNCHRONIZE_COMBINING (&combiner, counter_add, &add);
+ **/
+
+static inline void
+cmx_combiner_init (struct CMX_Combiner *combiner) {
+    CMX_ATOMIC_PTR_STORE (combiner->pending, NULL);
+    CMX_ATOMIC_INT_STORE (combiner->lock, 0);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_combiner_combine (struct CMX_Combiner *combiner) {
+    struct _CMX_Combiner_Record *list;
+    struct _CMX_Combiner_Record *fifo;
+    struct _CMX_Combiner_Record *next;
+    int pass;
+
+    for (pass = 0; pass < CMX_COMBINER_PASSES; ++pass) {
+        list = CMX_ATOMIC_PTR_EXCHANGE (combiner->pending, NULL);
+        if (NULL == list)
+            break;
+
+        /* list is LIFO, reverse it to serve requests in order */
+        for (fifo = NULL; NULL != list; list = next) {
+            next = list->next;
+            list->next = fifo;
+            fifo = list;
+        }
+
+        for (; NULL != fifo; fifo = next) {
+            next = fifo->next;
+            fifo->function (fifo->arg);
+            CMX_ATOMIC_INT_STORE (fifo->done, 1);
+        }
+    }
+}
+/**<Implementation function
+ **
+ ** Record belongs to waiting thread and may disappear once done
+ ** is stored, next must be read before.
+ **/
+
+static inline void
+cmx_combiner_execute (
+    struct CMX_Combiner *combiner,
+    void (* function) (void *),
+    void *arg
+) {
+    struct _CMX_Combiner_Record record;
+    int expected;
+    int spin = 0;
+
+    record.function = function;
+    record.arg = arg;
+    CMX_ATOMIC_INT_STORE (record.done, 0);
+
+    record.next = CMX_ATOMIC_PTR_LOAD (combiner->pending);
+    while (! CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK (combiner->pending, record.next, &record))
+        ;
+
+    while (! CMX_ATOMIC_INT_LOAD (record.done)) {
+        expected = 0;
+        if (0 == CMX_ATOMIC_INT_LOAD (combiner->lock)
+            && CMX_ATOMIC_INT_COMPARE_EXCHANGE (combiner->lock, expected, 1)) {
+            cmx_combiner_combine (combiner);
+            CMX_ATOMIC_INT_STORE (combiner->lock, 0);
+        } else if (++spin >= CMX_COMBINER_SPIN) {
+            spin = 0;
+            CMX_THREAD_YIELD ();
+        }
+    }
+}
+/**<Implementation function
+ **
+ ** Request is published before lock is tried, so it is evaluated
+ ** either by current thread or by combiner taking list later.
+ **/
+
+#endif  /* guard */
@@ -0,0 +1,207 @@
+
+#ifndef CMX_CORO_H
+#define CMX_CORO_H 1
+
+#include <cmx/cmx-env.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Stackless coroutines (state machines written as sequential code).
+ **
+ ** @section Idea behind
+ **
+ ** Coroutine is a function which can return in the middle of its body
+ ** and continue from the same place when called next time.
+ ** Resume point is stored in small struct (one int), so thousands of
+ ** coroutines can be driven by single thread without their own stack.
+ **
+ ** Implementation uses switch/case labels generated by macros
+ ** (see http://www.chiark.greenend.org.uk/~sgtatham/coroutines.html).
+ **
+ ** Limitations:
+ ** - local variables are not preserved between calls, keep state
+ **   in struct holding CMX_CORO_DEFINE
+ ** - CMX_CORO_YIELD and CMX_CORO_AWAIT cannot be used inside
+ **   switch statement of coroutine body
+ ** - 'break' outside of a loop finishes coroutine
+ **
+ ** @section Proposed usage
+ **
+ ** - use CMX_CORO_DEFINE in your structure definition
+ ** - use CMX_CORO_INIT in your constructor
+ ** - write coroutine body between CMX_CORO_BEGIN and CMX_CORO_END
+ **
+ **     int connection_step (struct connection *self) {
+ **         CMX_CORO_BEGIN (self);
+ **         CMX_CORO_AWAIT (connection_readable (self));
+ **         read_request (self);
+ **         CMX_CORO_YIELD;
+ **         write_response (self);
+ **         CMX_CORO_END;
+ **     }
+ **
+ **     while (CMX_CORO_FINISHED != connection_step (conn))
+ **         ...;
+ **/
+
+struct _CMX_Coro {
+    int state;
+};
+
+#ifndef CMX_CORO_NAME
+#define CMX_CORO_NAME                                                   \
+    cmx_coro
+/**<Structure member name
+ **/
+#endif
+
+#define CMX_CORO_CURRENT                                                \
+    cmx_coro_current
+/**<Name of local variable declared by CMX_CORO_BEGIN
+ **/
+
+#define CMX_CORO_STATE_INIT                                             \
+    0
+/**<Resume point of coroutine which didn't run yet
+ **/
+
+#define CMX_CORO_STATE_FINISHED                                         \
+    (-1)
+/**<Resume point of finished coroutine
+ **/
+
+#define CMX_CORO_WAITING                                                \
+    0
+/**<Coroutine return value: CMX_CORO_AWAIT condition is not satisfied
+ **/
+
+#define CMX_CORO_YIELDED                                                \
+    1
+/**<Coroutine return value: coroutine evaluated CMX_CORO_YIELD
+ **/
+
+#define CMX_CORO_FINISHED                                               \
+    2
+/**<Coroutine return value: coroutine reached its end
+ **/
+
+#define CMX_CORO_DEFINE                                                 \
+    struct _CMX_Coro CMX_CORO_NAME
+/**<Structure member definition
+ **
+ ** Uses CMX_CORO_NAME as member name
+ **
+ ** Usage:
+ ** struct {
+ **   CMX_CORO_DEFINE;
+ **   ...
+ ** };
+ **/
+
+#define CMX_CORO_INIT(Ptr)                                              \
+    ((Ptr)->CMX_CORO_NAME.state = CMX_CORO_STATE_INIT)
+/**<Initialize (or restart) coroutine state
+ **
+ ** Static initialization with zeros is valid as well.
+ **/
+
+#define CMX_CORO_FINISHED_P(Ptr)                                        \
+    (CMX_CORO_STATE_FINISHED == (Ptr)->CMX_CORO_NAME.state)
+/**<Test whether coroutine reached its end
+ **/
+
+#define CMX_CORO_BEGIN(Ptr)                                             \
+    CMX_CORO_BEGIN_IMPL (& ((Ptr)->CMX_CORO_NAME))
+/**<Start coroutine body
+ **
+ ** Must be paired with CMX_CORO_END in the same function.
+ ** Function must return int (one of CMX_CORO_WAITING, CMX_CORO_YIELDED,
+ ** CMX_CORO_FINISHED).
+ **
+ ** @param Ptr pointer to struct containing CMX_CORO_DEFINE
+ **/
+
+#define CMX_CORO_BEGIN_IMPL(State)                                      \
+    {                                                                   \
+        struct _CMX_Coro * const CMX_CORO_CURRENT = (State);            \
+        switch (CMX_CORO_CURRENT->state) {                              \
+        case CMX_CORO_STATE_INIT:
+/**<Implementation macro
+ **/
+
+#define CMX_CORO_END                                                    \
+        default:                                                        \
+            ;                                                           \
+        }                                                               \
+        CMX_CORO_CURRENT->state = CMX_CORO_STATE_FINISHED;              \
+        return CMX_CORO_FINISHED;                                       \
+    }
+/**<Finish coroutine body
+ **
+ ** Every subsequent call of finished coroutine returns CMX_CORO_FINISHED
+ ** until it is initialized again.
+ **/
+
+#define CMX_CORO_EXIT                                                   \
+    do {                                                                \
+        CMX_CORO_CURRENT->state = CMX_CORO_STATE_FINISHED;              \
+        return CMX_CORO_FINISHED;                                       \
+    } while (0)
+/**<Finish coroutine immediately
+ **/
+
+#define CMX_CORO_YIELD                                                  \
+    CMX_CORO_YIELD_TRAN (__COUNTER__)
+/**<Return CMX_CORO_YIELDED, next call continues after this statement
+ **
+ ** Usage:
+ **   CMX_CORO_YIELD;
+ **/
+
+#define CMX_CORO_YIELD_TRAN(Counter)                                    \
+    CMX_CORO_YIELD_IMPL (Counter + 1)
+/**<Transient macro to expand arguments
+ **/
+
+#define CMX_CORO_YIELD_IMPL(Point)                                      \
+    do {                                                                \
+        CMX_CORO_CURRENT->state = (Point);                              \
+        return CMX_CORO_YIELDED;                                        \
+    case (Point):                                                       \
+        ;                                                               \
+    } while (0)
+/**<Implementation macro
+ **/
+
+#define CMX_CORO_AWAIT(Cond)                                            \
+    CMX_CORO_AWAIT_TRAN (__COUNTER__, Cond)
+/**<Return CMX_CORO_WAITING until Cond evaluates TRUE
+ **
+ ** Cond is evaluated immediately and on every subsequent call,
+ ** coroutine continues once it evaluates TRUE.
+ **
+ ** Usage:
+ **   CMX_CORO_AWAIT (queue_length (self) > 0);
+ **/
+
+#define CMX_CORO_AWAIT_TRAN(Counter, Cond)                              \
+    CMX_CORO_AWAIT_IMPL (Counter + 1, Cond)
+/**<Transient macro to expand arguments
+ **/
+
+#define CMX_CORO_AWAIT_IMPL(Point, Cond)                                \
+    do {                                                                \
+        CMX_CORO_CURRENT->state = (Point);                              \
+        CMX_FALLTHROUGH;                                                \
+    case (Point):                                                       \
+        if (! (Cond))                                                   \
+            return CMX_CORO_WAITING;                                    \
+    } while (0)
+/**<Implementation macro
+ **
+ ** First evaluation falls through into its own case label.
+ **/
+
+#endif  /* guard */
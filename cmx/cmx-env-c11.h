@@ -0,0 +1,346 @@
+
+/** @file
+ **
+ ** CMX env macros using C11 atomics (<stdatomic.h>)
+ **
+ ** Env file defines macros with CMX_ENV_C11_ prefix.
+ ** Env file defines env dependant macros only if they are not defined yet.
+ **
+ ** Atomic types are declared _Atomic, so this env should not be mixed
+ ** with other env providing CMX_ATOMIC_ macros (eg. glib).
+ **/
+
+#ifndef CMX_ENV_C11_H
+#define CMX_ENV_C11_H 1
+
+#ifdef HAVE_CMX_ENV_C11
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define CMX_ENV_C11_ATOMIC_INT_TYPE                                     \
+    _Atomic int
+
+#  ifndef CMX_ATOMIC_INT_TYPE
+#  define CMX_ATOMIC_INT_TYPE CMX_ENV_C11_ATOMIC_INT_TYPE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_SET(Var, Value)                          \
+    atomic_exchange (& (Var), (Value))
+
+#  ifndef CMX_ATOMIC_INT_SET
+#  define CMX_ATOMIC_INT_SET CMX_ENV_C11_ATOMIC_INT_SET
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_INCREMENT(Var)                           \
+    atomic_fetch_add (& (Var), 1)
+
+#  ifndef CMX_ATOMIC_INT_INCREMENT
+#  define CMX_ATOMIC_INT_INCREMENT CMX_ENV_C11_ATOMIC_INT_INCREMENT
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_DECREMENT_AND_TEST(Var)                  \
+    (1 == atomic_fetch_sub (& (Var), 1))
+
+#  ifndef CMX_ATOMIC_INT_DECREMENT_AND_TEST
+#  define CMX_ATOMIC_INT_DECREMENT_AND_TEST CMX_ENV_C11_ATOMIC_INT_DECREMENT_AND_TEST
+#  endif
+
+
+#define CMX_ENV_C11_ATOMIC_INT64_TYPE                                   \
+    _Atomic int64_t
+
+#  ifndef CMX_ATOMIC_INT64_TYPE
+#  define CMX_ATOMIC_INT64_TYPE CMX_ENV_C11_ATOMIC_INT64_TYPE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_PTR_TYPE(Type)                               \
+    Type * _Atomic
+
+#  ifndef CMX_ATOMIC_PTR_TYPE
+#  define CMX_ATOMIC_PTR_TYPE CMX_ENV_C11_ATOMIC_PTR_TYPE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_TYPE                                    \
+    _Atomic size_t
+
+#  ifndef CMX_ATOMIC_SIZE_TYPE
+#  define CMX_ATOMIC_SIZE_TYPE CMX_ENV_C11_ATOMIC_SIZE_TYPE
+#  endif
+
+
+#define CMX_ENV_C11_ATOMIC_INT_LOAD(Var)                                \
+    atomic_load_explicit (& (Var), memory_order_acquire)
+
+#  ifndef CMX_ATOMIC_INT_LOAD
+#  define CMX_ATOMIC_INT_LOAD CMX_ENV_C11_ATOMIC_INT_LOAD
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_STORE(Var, Value)                        \
+    atomic_store_explicit (& (Var), (Value), memory_order_release)
+
+#  ifndef CMX_ATOMIC_INT_STORE
+#  define CMX_ATOMIC_INT_STORE CMX_ENV_C11_ATOMIC_INT_STORE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_EXCHANGE(Var, Value)                     \
+    atomic_exchange_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT_EXCHANGE
+#  define CMX_ATOMIC_INT_EXCHANGE CMX_ENV_C11_ATOMIC_INT_EXCHANGE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    atomic_compare_exchange_strong_explicit (                           \
+        & (Var), & (Expected), (Desired),                               \
+        memory_order_acq_rel, memory_order_acquire                      \
+    )
+
+#  ifndef CMX_ATOMIC_INT_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_INT_COMPARE_EXCHANGE CMX_ENV_C11_ATOMIC_INT_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    atomic_compare_exchange_weak_explicit (                             \
+        & (Var), & (Expected), (Desired),                               \
+        memory_order_acq_rel, memory_order_acquire                      \
+    )
+
+#  ifndef CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK CMX_ENV_C11_ATOMIC_INT_COMPARE_EXCHANGE_WEAK
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_FETCH_ADD(Var, Value)                    \
+    atomic_fetch_add_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT_FETCH_ADD
+#  define CMX_ATOMIC_INT_FETCH_ADD CMX_ENV_C11_ATOMIC_INT_FETCH_ADD
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_FETCH_SUB(Var, Value)                    \
+    atomic_fetch_sub_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT_FETCH_SUB
+#  define CMX_ATOMIC_INT_FETCH_SUB CMX_ENV_C11_ATOMIC_INT_FETCH_SUB
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_FETCH_OR(Var, Value)                     \
+    atomic_fetch_or_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT_FETCH_OR
+#  define CMX_ATOMIC_INT_FETCH_OR CMX_ENV_C11_ATOMIC_INT_FETCH_OR
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT_FETCH_AND(Var, Value)                    \
+    atomic_fetch_and_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT_FETCH_AND
+#  define CMX_ATOMIC_INT_FETCH_AND CMX_ENV_C11_ATOMIC_INT_FETCH_AND
+#  endif
+
+
+#define CMX_ENV_C11_ATOMIC_INT64_LOAD(Var)                              \
+    atomic_load_explicit (& (Var), memory_order_acquire)
+
+#  ifndef CMX_ATOMIC_INT64_LOAD
+#  define CMX_ATOMIC_INT64_LOAD CMX_ENV_C11_ATOMIC_INT64_LOAD
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT64_STORE(Var, Value)                      \
+    atomic_store_explicit (& (Var), (Value), memory_order_release)
+
+#  ifndef CMX_ATOMIC_INT64_STORE
+#  define CMX_ATOMIC_INT64_STORE CMX_ENV_C11_ATOMIC_INT64_STORE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT64_EXCHANGE(Var, Value)                   \
+    atomic_exchange_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT64_EXCHANGE
+#  define CMX_ATOMIC_INT64_EXCHANGE CMX_ENV_C11_ATOMIC_INT64_EXCHANGE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT64_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    atomic_compare_exchange_strong_explicit (                           \
+        & (Var), & (Expected), (Desired),                               \
+        memory_order_acq_rel, memory_order_acquire                      \
+    )
+
+#  ifndef CMX_ATOMIC_INT64_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_INT64_COMPARE_EXCHANGE CMX_ENV_C11_ATOMIC_INT64_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    atomic_compare_exchange_weak_explicit (                             \
+        & (Var), & (Expected), (Desired),                               \
+        memory_order_acq_rel, memory_order_acquire                      \
+    )
+
+#  ifndef CMX_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK CMX_ENV_C11_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT64_FETCH_ADD(Var, Value)                  \
+    atomic_fetch_add_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_ADD
+#  define CMX_ATOMIC_INT64_FETCH_ADD CMX_ENV_C11_ATOMIC_INT64_FETCH_ADD
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT64_FETCH_SUB(Var, Value)                  \
+    atomic_fetch_sub_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_SUB
+#  define CMX_ATOMIC_INT64_FETCH_SUB CMX_ENV_C11_ATOMIC_INT64_FETCH_SUB
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT64_FETCH_OR(Var, Value)                   \
+    atomic_fetch_or_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_OR
+#  define CMX_ATOMIC_INT64_FETCH_OR CMX_ENV_C11_ATOMIC_INT64_FETCH_OR
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_INT64_FETCH_AND(Var, Value)                  \
+    atomic_fetch_and_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_AND
+#  define CMX_ATOMIC_INT64_FETCH_AND CMX_ENV_C11_ATOMIC_INT64_FETCH_AND
+#  endif
+
+
+#define CMX_ENV_C11_ATOMIC_PTR_LOAD(Var)                                \
+    atomic_load_explicit (& (Var), memory_order_acquire)
+
+#  ifndef CMX_ATOMIC_PTR_LOAD
+#  define CMX_ATOMIC_PTR_LOAD CMX_ENV_C11_ATOMIC_PTR_LOAD
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_PTR_STORE(Var, Value)                        \
+    atomic_store_explicit (& (Var), (Value), memory_order_release)
+
+#  ifndef CMX_ATOMIC_PTR_STORE
+#  define CMX_ATOMIC_PTR_STORE CMX_ENV_C11_ATOMIC_PTR_STORE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_PTR_EXCHANGE(Var, Value)                     \
+    atomic_exchange_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_PTR_EXCHANGE
+#  define CMX_ATOMIC_PTR_EXCHANGE CMX_ENV_C11_ATOMIC_PTR_EXCHANGE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_PTR_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    atomic_compare_exchange_strong_explicit (                           \
+        & (Var), & (Expected), (Desired),                               \
+        memory_order_acq_rel, memory_order_acquire                      \
+    )
+
+#  ifndef CMX_ATOMIC_PTR_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_PTR_COMPARE_EXCHANGE CMX_ENV_C11_ATOMIC_PTR_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    atomic_compare_exchange_weak_explicit (                             \
+        & (Var), & (Expected), (Desired),                               \
+        memory_order_acq_rel, memory_order_acquire                      \
+    )
+
+#  ifndef CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK CMX_ENV_C11_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK
+#  endif
+
+
+#define CMX_ENV_C11_ATOMIC_SIZE_LOAD(Var)                               \
+    atomic_load_explicit (& (Var), memory_order_acquire)
+
+#  ifndef CMX_ATOMIC_SIZE_LOAD
+#  define CMX_ATOMIC_SIZE_LOAD CMX_ENV_C11_ATOMIC_SIZE_LOAD
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_STORE(Var, Value)                       \
+    atomic_store_explicit (& (Var), (Value), memory_order_release)
+
+#  ifndef CMX_ATOMIC_SIZE_STORE
+#  define CMX_ATOMIC_SIZE_STORE CMX_ENV_C11_ATOMIC_SIZE_STORE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_EXCHANGE(Var, Value)                    \
+    atomic_exchange_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_SIZE_EXCHANGE
+#  define CMX_ATOMIC_SIZE_EXCHANGE CMX_ENV_C11_ATOMIC_SIZE_EXCHANGE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    atomic_compare_exchange_strong_explicit (                           \
+        & (Var), & (Expected), (Desired),                               \
+        memory_order_acq_rel, memory_order_acquire                      \
+    )
+
+#  ifndef CMX_ATOMIC_SIZE_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_SIZE_COMPARE_EXCHANGE CMX_ENV_C11_ATOMIC_SIZE_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    atomic_compare_exchange_weak_explicit (                             \
+        & (Var), & (Expected), (Desired),                               \
+        memory_order_acq_rel, memory_order_acquire                      \
+    )
+
+#  ifndef CMX_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK CMX_ENV_C11_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_FETCH_ADD(Var, Value)                   \
+    atomic_fetch_add_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_ADD
+#  define CMX_ATOMIC_SIZE_FETCH_ADD CMX_ENV_C11_ATOMIC_SIZE_FETCH_ADD
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_FETCH_SUB(Var, Value)                   \
+    atomic_fetch_sub_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_SUB
+#  define CMX_ATOMIC_SIZE_FETCH_SUB CMX_ENV_C11_ATOMIC_SIZE_FETCH_SUB
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_FETCH_OR(Var, Value)                    \
+    atomic_fetch_or_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_OR
+#  define CMX_ATOMIC_SIZE_FETCH_OR CMX_ENV_C11_ATOMIC_SIZE_FETCH_OR
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_SIZE_FETCH_AND(Var, Value)                   \
+    atomic_fetch_and_explicit (& (Var), (Value), memory_order_acq_rel)
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_AND
+#  define CMX_ATOMIC_SIZE_FETCH_AND CMX_ENV_C11_ATOMIC_SIZE_FETCH_AND
+#  endif
+
+#define CMX_ENV_C11_ATOMIC_FENCE()                                      \
+    atomic_thread_fence (memory_order_seq_cst)
+
+#  ifndef CMX_ATOMIC_FENCE
+#  define CMX_ATOMIC_FENCE CMX_ENV_C11_ATOMIC_FENCE
+#  endif
+
+#define CMX_ENV_C11_COMPILER_FENCE()                                    \
+    atomic_signal_fence (memory_order_seq_cst)
+
+#  ifndef CMX_COMPILER_FENCE
+#  define CMX_COMPILER_FENCE CMX_ENV_C11_COMPILER_FENCE
+#  endif
+
+#define CMX_ENV_C11_THREAD_LOCAL                                        \
+    _Thread_local
+
+#  ifndef CMX_THREAD_LOCAL
+#  define CMX_THREAD_LOCAL CMX_ENV_C11_THREAD_LOCAL
+#  endif
+
+#endif  /* env conditional */
+#endif  /* header guard */
@@ -11,6 +11,92 @@
 #define CMX_LABEL_UNUSED
 #endif
 
+#ifndef CMX_ENV_STORAGE
+#define CMX_ENV_STORAGE                                                 \
+    extern int cmx_env_storage_unused
+#endif
+
+#ifndef CMX_FALLTHROUGH
+#define CMX_FALLTHROUGH
+#endif
+
+#ifndef CMX_LIKELY
+#define CMX_LIKELY(X)                                                   \
+    (X)
+#endif
+
+#ifndef CMX_UNLIKELY
+#define CMX_UNLIKELY(X)                                                 \
+    (X)
+#endif
+
+#ifndef CMX_COLD
+#define CMX_COLD                                                        \
+    inline
+#endif
+
+#ifndef CMX_SINGLE_THREAD_P
+#define CMX_SINGLE_THREAD_P()                                           \
+    0
+#endif
+
+#ifndef CMX_THREAD_YIELD
+#define CMX_THREAD_YIELD()                                              \
+    ((void) 0)
+#endif
+
+#ifndef CMX_ATOMIC_INT_WAIT
+#define CMX_ATOMIC_INT_WAIT(Var, Value)                                 \
+    CMX_THREAD_YIELD ()
+#endif
+
+#ifndef CMX_ATOMIC_INT_WAKE_ONE
+#define CMX_ATOMIC_INT_WAKE_ONE(Var)                                    \
+    ((void) 0)
+#endif
+
+#ifndef CMX_ATOMIC_INT_WAKE_ALL
+#define CMX_ATOMIC_INT_WAKE_ALL(Var)                                    \
+    ((void) 0)
+#endif
+
+#ifndef CMX_MEMBARRIER_INIT
+#define CMX_MEMBARRIER_INIT()                                           \
+    0
+#endif
+
+#ifndef CMX_MEMBARRIER
+#define CMX_MEMBARRIER()                                                \
+    CMX_ATOMIC_FENCE ()
+#endif
+
+#ifndef CMX_CPU_CURRENT
+#define CMX_CPU_CURRENT()                                               \
+    0
+#endif
+
+#ifndef CMX_ATOMIC_INT64_TYPE
+#include <stdint.h>
+#define CMX_ATOMIC_INT64_TYPE                                           \
+    int64_t
+#endif
+
+#ifndef CMX_ATOMIC_PTR_TYPE
+#define CMX_ATOMIC_PTR_TYPE(Type)                                       \
+    Type *
+#endif
+
+#ifndef CMX_ATOMIC_SIZE_TYPE
+#include <stddef.h>
+#define CMX_ATOMIC_SIZE_TYPE                                            \
+    size_t
+#endif
+
+#ifndef CMX_CACHE_LINE_SIZE
+#define CMX_CACHE_LINE_SIZE                                             \
+    64
+#endif
+
 #ifndef CMX_LOCAL_STORE
 #include <string.h>
 #define CMX_LOCAL_STORE(Name, Var)                                      \
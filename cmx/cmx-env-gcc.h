@@ -41,13 +41,301 @@
 #  endif
 
 
+#define CMX_ENV_GCC_ATOMIC_INT_LOAD(Var)                                \
+    __atomic_load_n (& (Var), __ATOMIC_ACQUIRE)
+
+#  ifndef CMX_ATOMIC_INT_LOAD
+#  define CMX_ATOMIC_INT_LOAD CMX_ENV_GCC_ATOMIC_INT_LOAD
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT_STORE(Var, Value)                        \
+    __atomic_store_n (& (Var), (Value), __ATOMIC_RELEASE)
+
+#  ifndef CMX_ATOMIC_INT_STORE
+#  define CMX_ATOMIC_INT_STORE CMX_ENV_GCC_ATOMIC_INT_STORE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT_EXCHANGE(Var, Value)                     \
+    __atomic_exchange_n (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT_EXCHANGE
+#  define CMX_ATOMIC_INT_EXCHANGE CMX_ENV_GCC_ATOMIC_INT_EXCHANGE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    __atomic_compare_exchange_n (                                       \
+        & (Var), & (Expected), (Desired), 0,                            \
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE                              \
+    )
+
+#  ifndef CMX_ATOMIC_INT_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_INT_COMPARE_EXCHANGE CMX_ENV_GCC_ATOMIC_INT_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    __atomic_compare_exchange_n (                                       \
+        & (Var), & (Expected), (Desired), 1,                            \
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE                              \
+    )
+
+#  ifndef CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK CMX_ENV_GCC_ATOMIC_INT_COMPARE_EXCHANGE_WEAK
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT_FETCH_ADD(Var, Value)                    \
+    __atomic_fetch_add (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT_FETCH_ADD
+#  define CMX_ATOMIC_INT_FETCH_ADD CMX_ENV_GCC_ATOMIC_INT_FETCH_ADD
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT_FETCH_SUB(Var, Value)                    \
+    __atomic_fetch_sub (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT_FETCH_SUB
+#  define CMX_ATOMIC_INT_FETCH_SUB CMX_ENV_GCC_ATOMIC_INT_FETCH_SUB
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT_FETCH_OR(Var, Value)                     \
+    __atomic_fetch_or (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT_FETCH_OR
+#  define CMX_ATOMIC_INT_FETCH_OR CMX_ENV_GCC_ATOMIC_INT_FETCH_OR
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT_FETCH_AND(Var, Value)                    \
+    __atomic_fetch_and (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT_FETCH_AND
+#  define CMX_ATOMIC_INT_FETCH_AND CMX_ENV_GCC_ATOMIC_INT_FETCH_AND
+#  endif
+
+
+#define CMX_ENV_GCC_ATOMIC_INT64_LOAD(Var)                              \
+    __atomic_load_n (& (Var), __ATOMIC_ACQUIRE)
+
+#  ifndef CMX_ATOMIC_INT64_LOAD
+#  define CMX_ATOMIC_INT64_LOAD CMX_ENV_GCC_ATOMIC_INT64_LOAD
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT64_STORE(Var, Value)                      \
+    __atomic_store_n (& (Var), (Value), __ATOMIC_RELEASE)
+
+#  ifndef CMX_ATOMIC_INT64_STORE
+#  define CMX_ATOMIC_INT64_STORE CMX_ENV_GCC_ATOMIC_INT64_STORE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT64_EXCHANGE(Var, Value)                   \
+    __atomic_exchange_n (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT64_EXCHANGE
+#  define CMX_ATOMIC_INT64_EXCHANGE CMX_ENV_GCC_ATOMIC_INT64_EXCHANGE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT64_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    __atomic_compare_exchange_n (                                       \
+        & (Var), & (Expected), (Desired), 0,                            \
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE                              \
+    )
+
+#  ifndef CMX_ATOMIC_INT64_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_INT64_COMPARE_EXCHANGE CMX_ENV_GCC_ATOMIC_INT64_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    __atomic_compare_exchange_n (                                       \
+        & (Var), & (Expected), (Desired), 1,                            \
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE                              \
+    )
+
+#  ifndef CMX_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK CMX_ENV_GCC_ATOMIC_INT64_COMPARE_EXCHANGE_WEAK
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT64_FETCH_ADD(Var, Value)                  \
+    __atomic_fetch_add (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_ADD
+#  define CMX_ATOMIC_INT64_FETCH_ADD CMX_ENV_GCC_ATOMIC_INT64_FETCH_ADD
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT64_FETCH_SUB(Var, Value)                  \
+    __atomic_fetch_sub (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_SUB
+#  define CMX_ATOMIC_INT64_FETCH_SUB CMX_ENV_GCC_ATOMIC_INT64_FETCH_SUB
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT64_FETCH_OR(Var, Value)                   \
+    __atomic_fetch_or (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_OR
+#  define CMX_ATOMIC_INT64_FETCH_OR CMX_ENV_GCC_ATOMIC_INT64_FETCH_OR
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_INT64_FETCH_AND(Var, Value)                  \
+    __atomic_fetch_and (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_AND
+#  define CMX_ATOMIC_INT64_FETCH_AND CMX_ENV_GCC_ATOMIC_INT64_FETCH_AND
+#  endif
+
+
+#define CMX_ENV_GCC_ATOMIC_PTR_LOAD(Var)                                \
+    __atomic_load_n (& (Var), __ATOMIC_ACQUIRE)
+
+#  ifndef CMX_ATOMIC_PTR_LOAD
+#  define CMX_ATOMIC_PTR_LOAD CMX_ENV_GCC_ATOMIC_PTR_LOAD
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_PTR_STORE(Var, Value)                        \
+    __atomic_store_n (& (Var), (Value), __ATOMIC_RELEASE)
+
+#  ifndef CMX_ATOMIC_PTR_STORE
+#  define CMX_ATOMIC_PTR_STORE CMX_ENV_GCC_ATOMIC_PTR_STORE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_PTR_EXCHANGE(Var, Value)                     \
+    __atomic_exchange_n (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_PTR_EXCHANGE
+#  define CMX_ATOMIC_PTR_EXCHANGE CMX_ENV_GCC_ATOMIC_PTR_EXCHANGE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_PTR_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    __atomic_compare_exchange_n (                                       \
+        & (Var), & (Expected), (Desired), 0,                            \
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE                              \
+    )
+
+#  ifndef CMX_ATOMIC_PTR_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_PTR_COMPARE_EXCHANGE CMX_ENV_GCC_ATOMIC_PTR_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    __atomic_compare_exchange_n (                                       \
+        & (Var), & (Expected), (Desired), 1,                            \
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE                              \
+    )
+
+#  ifndef CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK CMX_ENV_GCC_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK
+#  endif
+
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_LOAD(Var)                               \
+    __atomic_load_n (& (Var), __ATOMIC_ACQUIRE)
+
+#  ifndef CMX_ATOMIC_SIZE_LOAD
+#  define CMX_ATOMIC_SIZE_LOAD CMX_ENV_GCC_ATOMIC_SIZE_LOAD
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_STORE(Var, Value)                       \
+    __atomic_store_n (& (Var), (Value), __ATOMIC_RELEASE)
+
+#  ifndef CMX_ATOMIC_SIZE_STORE
+#  define CMX_ATOMIC_SIZE_STORE CMX_ENV_GCC_ATOMIC_SIZE_STORE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_EXCHANGE(Var, Value)                    \
+    __atomic_exchange_n (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_SIZE_EXCHANGE
+#  define CMX_ATOMIC_SIZE_EXCHANGE CMX_ENV_GCC_ATOMIC_SIZE_EXCHANGE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    __atomic_compare_exchange_n (                                       \
+        & (Var), & (Expected), (Desired), 0,                            \
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE                              \
+    )
+
+#  ifndef CMX_ATOMIC_SIZE_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_SIZE_COMPARE_EXCHANGE CMX_ENV_GCC_ATOMIC_SIZE_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    __atomic_compare_exchange_n (                                       \
+        & (Var), & (Expected), (Desired), 1,                            \
+        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE                              \
+    )
+
+#  ifndef CMX_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK CMX_ENV_GCC_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_FETCH_ADD(Var, Value)                   \
+    __atomic_fetch_add (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_ADD
+#  define CMX_ATOMIC_SIZE_FETCH_ADD CMX_ENV_GCC_ATOMIC_SIZE_FETCH_ADD
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_FETCH_SUB(Var, Value)                   \
+    __atomic_fetch_sub (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_SUB
+#  define CMX_ATOMIC_SIZE_FETCH_SUB CMX_ENV_GCC_ATOMIC_SIZE_FETCH_SUB
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_FETCH_OR(Var, Value)                    \
+    __atomic_fetch_or (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_OR
+#  define CMX_ATOMIC_SIZE_FETCH_OR CMX_ENV_GCC_ATOMIC_SIZE_FETCH_OR
+#  endif
+
+#define CMX_ENV_GCC_ATOMIC_SIZE_FETCH_AND(Var, Value)                   \
+    __atomic_fetch_and (& (Var), (Value), __ATOMIC_ACQ_REL)
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_AND
+#  define CMX_ATOMIC_SIZE_FETCH_AND CMX_ENV_GCC_ATOMIC_SIZE_FETCH_AND
+#  endif
+
+#ifdef __cplusplus
+/* g++ doesn't accept attribute between label and following statement */
+#define CMX_ENV_GCC_LABEL_UNUSED
+#else
 #define CMX_ENV_GCC_LABEL_UNUSED                                        \
     __attribute__((__unused__))
+#endif
 
 #  ifndef CMX_LABEL_UNUSED
 #  define CMX_LABEL_UNUSED CMX_ENV_GCC_LABEL_UNUSED
 #  endif
 
+#if __GNUC__ >= 7
+#define CMX_ENV_GCC_FALLTHROUGH                                         \
+    __attribute__ ((__fallthrough__))
+#else
+#define CMX_ENV_GCC_FALLTHROUGH
+#endif
+
+#  ifndef CMX_FALLTHROUGH
+#  define CMX_FALLTHROUGH CMX_ENV_GCC_FALLTHROUGH
+#  endif
+
+#define CMX_ENV_GCC_LIKELY(X)                                           \
+    __builtin_expect (!! (X), 1)
+
+#  ifndef CMX_LIKELY
+#  define CMX_LIKELY CMX_ENV_GCC_LIKELY
+#  endif
+
+#define CMX_ENV_GCC_UNLIKELY(X)                                         \
+    __builtin_expect (!! (X), 0)
+
+#  ifndef CMX_UNLIKELY
+#  define CMX_UNLIKELY CMX_ENV_GCC_UNLIKELY
+#  endif
+
+#define CMX_ENV_GCC_COLD                                                \
+    __attribute__((__cold__, __noinline__, __unused__))
+
+#  ifndef CMX_COLD
+#  define CMX_COLD CMX_ENV_GCC_COLD
+#  endif
+
 #define CMX_ENV_GCC_LOCAL_STORE(Name, Var)                              \
     typeof (Var) Name = Var
 
@@ -62,5 +350,26 @@
 #  define CMX_LOCAL_RESTORE CMX_ENV_GCC_LOCAL_RESTORE
 #  endif
 
+#define CMX_ENV_GCC_ATOMIC_FENCE()                                      \
+    __atomic_thread_fence (__ATOMIC_SEQ_CST)
+
+#  ifndef CMX_ATOMIC_FENCE
+#  define CMX_ATOMIC_FENCE CMX_ENV_GCC_ATOMIC_FENCE
+#  endif
+
+#define CMX_ENV_GCC_COMPILER_FENCE()                                    \
+    __atomic_signal_fence (__ATOMIC_SEQ_CST)
+
+#  ifndef CMX_COMPILER_FENCE
+#  define CMX_COMPILER_FENCE CMX_ENV_GCC_COMPILER_FENCE
+#  endif
+
+#define CMX_ENV_GCC_THREAD_LOCAL                                        \
+    __thread
+
+#  ifndef CMX_THREAD_LOCAL
+#  define CMX_THREAD_LOCAL CMX_ENV_GCC_THREAD_LOCAL
+#  endif
+
 #endif  /* env conditional */
 #endif  /* header guard */
@@ -74,6 +74,269 @@
 #  define CMX_ATOMIC_INT_DECREMENT_AND_TEST CMX_ENV_GLIB_ATOMIC_INT_DECREMENT_AND_TEST
 #  endif
 
+#define CMX_ENV_GLIB_ATOMIC_INT_LOAD(Var)                               \
+    g_atomic_int_get (& (Var))
+
+#  ifndef CMX_ATOMIC_INT_LOAD
+#  define CMX_ATOMIC_INT_LOAD CMX_ENV_GLIB_ATOMIC_INT_LOAD
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_STORE(Var, Value)                       \
+    g_atomic_int_set (& (Var), (Value))
+
+#  ifndef CMX_ATOMIC_INT_STORE
+#  define CMX_ATOMIC_INT_STORE CMX_ENV_GLIB_ATOMIC_INT_STORE
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_FETCH_ADD(Var, Value)                   \
+    g_atomic_int_add (& (Var), (Value))
+
+#  ifndef CMX_ATOMIC_INT_FETCH_ADD
+#  define CMX_ATOMIC_INT_FETCH_ADD CMX_ENV_GLIB_ATOMIC_INT_FETCH_ADD
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_FETCH_SUB(Var, Value)                   \
+    g_atomic_int_add (& (Var), - (Value))
+
+#  ifndef CMX_ATOMIC_INT_FETCH_SUB
+#  define CMX_ATOMIC_INT_FETCH_SUB CMX_ENV_GLIB_ATOMIC_INT_FETCH_SUB
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_FETCH_OR(Var, Value)                    \
+    ((gint) g_atomic_int_or ((guint *) & (Var), (Value)))
+
+#  ifndef CMX_ATOMIC_INT_FETCH_OR
+#  define CMX_ATOMIC_INT_FETCH_OR CMX_ENV_GLIB_ATOMIC_INT_FETCH_OR
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_FETCH_AND(Var, Value)                   \
+    ((gint) g_atomic_int_and ((guint *) & (Var), (Value)))
+
+#  ifndef CMX_ATOMIC_INT_FETCH_AND
+#  define CMX_ATOMIC_INT_FETCH_AND CMX_ENV_GLIB_ATOMIC_INT_FETCH_AND
+#  endif
+
+#  if GLIB_CHECK_VERSION (2, 74, 0)
+#define CMX_ENV_GLIB_ATOMIC_INT_EXCHANGE(Var, Value)                    \
+    g_atomic_int_exchange (& (Var), (Value))
+
+#  ifndef CMX_ATOMIC_INT_EXCHANGE
+#  define CMX_ATOMIC_INT_EXCHANGE CMX_ENV_GLIB_ATOMIC_INT_EXCHANGE
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    g_atomic_int_compare_and_exchange_full (                            \
+        & (Var), (Expected), (Desired), & (Expected)                    \
+    )
+
+#  ifndef CMX_ATOMIC_INT_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_INT_COMPARE_EXCHANGE CMX_ENV_GLIB_ATOMIC_INT_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    CMX_ENV_GLIB_ATOMIC_INT_COMPARE_EXCHANGE ((Var), (Expected), (Desired))
+
+#  ifndef CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK CMX_ENV_GLIB_ATOMIC_INT_COMPARE_EXCHANGE_WEAK
+#  endif
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_PTR_LOAD(Var)                               \
+    g_atomic_pointer_get (& (Var))
+
+#  ifndef CMX_ATOMIC_PTR_LOAD
+#  define CMX_ATOMIC_PTR_LOAD CMX_ENV_GLIB_ATOMIC_PTR_LOAD
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_PTR_STORE(Var, Value)                       \
+    g_atomic_pointer_set (& (Var), (Value))
+
+#  ifndef CMX_ATOMIC_PTR_STORE
+#  define CMX_ATOMIC_PTR_STORE CMX_ENV_GLIB_ATOMIC_PTR_STORE
+#  endif
+
+#  if GLIB_CHECK_VERSION (2, 74, 0)
+#define CMX_ENV_GLIB_ATOMIC_PTR_EXCHANGE(Var, Value)                    \
+    g_atomic_pointer_exchange (& (Var), (Value))
+
+#  ifndef CMX_ATOMIC_PTR_EXCHANGE
+#  define CMX_ATOMIC_PTR_EXCHANGE CMX_ENV_GLIB_ATOMIC_PTR_EXCHANGE
+#  endif
+#  endif
+
+#  if GLIB_CHECK_VERSION (2, 74, 0)
+#define CMX_ENV_GLIB_ATOMIC_PTR_COMPARE_EXCHANGE(Var, Expected, Desired) \
+    g_atomic_pointer_compare_and_exchange_full (                        \
+        & (Var), (Expected), (Desired), & (Expected)                    \
+    )
+
+#  ifndef CMX_ATOMIC_PTR_COMPARE_EXCHANGE
+#  define CMX_ATOMIC_PTR_COMPARE_EXCHANGE CMX_ENV_GLIB_ATOMIC_PTR_COMPARE_EXCHANGE
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK(Var, Expected, Desired) \
+    CMX_ENV_GLIB_ATOMIC_PTR_COMPARE_EXCHANGE ((Var), (Expected), (Desired))
+
+#  ifndef CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK
+#  define CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK CMX_ENV_GLIB_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK
+#  endif
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_KEY_TYPE                                    \
+    GPrivate
+
+#  ifndef CMX_THREAD_KEY_TYPE
+#  define CMX_THREAD_KEY_TYPE CMX_ENV_GLIB_THREAD_KEY_TYPE
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_KEY_INIT(Var, Destroy)                      \
+    Var = (GPrivate) G_PRIVATE_INIT (Destroy)
+
+#  ifndef CMX_THREAD_KEY_INIT
+#  define CMX_THREAD_KEY_INIT CMX_ENV_GLIB_THREAD_KEY_INIT
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_KEY_GET(Var)                                \
+    g_private_get (& (Var))
+
+#  ifndef CMX_THREAD_KEY_GET
+#  define CMX_THREAD_KEY_GET CMX_ENV_GLIB_THREAD_KEY_GET
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_KEY_SET(Var, Value)                         \
+    g_private_set (& (Var), (Value))
+
+#  ifndef CMX_THREAD_KEY_SET
+#  define CMX_THREAD_KEY_SET CMX_ENV_GLIB_THREAD_KEY_SET
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_TYPE                                        \
+    GThread *
+
+#  ifndef CMX_THREAD_TYPE
+#  define CMX_THREAD_TYPE CMX_ENV_GLIB_THREAD_TYPE
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_CREATE(Var, Function, Arg)                  \
+    ((Var) = g_thread_new (NULL, (Function), (Arg)), 0)
+
+#  ifndef CMX_THREAD_CREATE
+#  define CMX_THREAD_CREATE CMX_ENV_GLIB_THREAD_CREATE
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_JOIN(Var)                                   \
+    ((void) g_thread_join (Var))
+
+#  ifndef CMX_THREAD_JOIN
+#  define CMX_THREAD_JOIN CMX_ENV_GLIB_THREAD_JOIN
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_SELF()                                      \
+    g_thread_self ()
+
+#  ifndef CMX_THREAD_SELF
+#  define CMX_THREAD_SELF CMX_ENV_GLIB_THREAD_SELF
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_EQUAL(A, B)                                 \
+    ((A) == (B))
+
+#  ifndef CMX_THREAD_EQUAL
+#  define CMX_THREAD_EQUAL CMX_ENV_GLIB_THREAD_EQUAL
+#  endif
+
+#define CMX_ENV_GLIB_THREAD_YIELD()                                     \
+    g_thread_yield ()
+
+#  ifndef CMX_THREAD_YIELD
+#  define CMX_THREAD_YIELD CMX_ENV_GLIB_THREAD_YIELD
+#  endif
+
+#ifndef CMX_ENV_GLIB_WAIT_BUCKETS
+#define CMX_ENV_GLIB_WAIT_BUCKETS                                       \
+    64
+/**<Number of mutex / condition pairs used by CMX_ATOMIC_INT_WAIT
+ **
+ ** You can override default value defining this macro before including cmx.h
+ **/
+#endif
+
+struct _CMX_Env_Glib_Wait {
+    GMutex mutex;
+    GCond cond;
+};
+
+extern struct _CMX_Env_Glib_Wait cmx_env_glib_wait_table[CMX_ENV_GLIB_WAIT_BUCKETS];
+
+#define CMX_ENV_GLIB_STORAGE                                            \
+    struct _CMX_Env_Glib_Wait cmx_env_glib_wait_table[CMX_ENV_GLIB_WAIT_BUCKETS]
+
+#  ifndef CMX_ENV_STORAGE
+#  define CMX_ENV_STORAGE CMX_ENV_GLIB_STORAGE
+#  endif
+
+static inline struct _CMX_Env_Glib_Wait *
+cmx_env_glib_wait_bucket (gint *var) {
+    return &cmx_env_glib_wait_table[
+        ((guintptr) var / sizeof (gint)) % CMX_ENV_GLIB_WAIT_BUCKETS
+    ];
+}
+/**<Implementation function
+ **
+ ** Variables are hashed by address into table shared by whole program
+ ** (statically allocated GMutex / GCond need no initialization).
+ **/
+
+static inline void
+cmx_env_glib_wait (gint *var, gint value) {
+    struct _CMX_Env_Glib_Wait *bucket = cmx_env_glib_wait_bucket (var);
+
+    g_mutex_lock (&bucket->mutex);
+    if (g_atomic_int_get (var) == value)
+        g_cond_wait (&bucket->cond, &bucket->mutex);
+    g_mutex_unlock (&bucket->mutex);
+}
+/**<Implementation function
+ **
+ ** Value is checked under bucket mutex, waker modifies variable before
+ ** it takes the same mutex, so wake cannot be lost.
+ **/
+
+static inline void
+cmx_env_glib_wake (gint *var) {
+    struct _CMX_Env_Glib_Wait *bucket = cmx_env_glib_wait_bucket (var);
+
+    g_mutex_lock (&bucket->mutex);
+    g_cond_broadcast (&bucket->cond);
+    g_mutex_unlock (&bucket->mutex);
+}
+/**<Implementation function
+ **
+ ** Bucket may be shared by several variables, all its waiters are woken
+ ** (others return spuriously).
+ **/
+
+#define CMX_ENV_GLIB_ATOMIC_INT_WAIT(Var, Value)                        \
+    cmx_env_glib_wait (& (Var), (Value))
+
+#  ifndef CMX_ATOMIC_INT_WAIT
+#  define CMX_ATOMIC_INT_WAIT CMX_ENV_GLIB_ATOMIC_INT_WAIT
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_WAKE_ONE(Var)                           \
+    cmx_env_glib_wake (& (Var))
+
+#  ifndef CMX_ATOMIC_INT_WAKE_ONE
+#  define CMX_ATOMIC_INT_WAKE_ONE CMX_ENV_GLIB_ATOMIC_INT_WAKE_ONE
+#  endif
+
+#define CMX_ENV_GLIB_ATOMIC_INT_WAKE_ALL(Var)                           \
+    cmx_env_glib_wake (& (Var))
+
+#  ifndef CMX_ATOMIC_INT_WAKE_ALL
+#  define CMX_ATOMIC_INT_WAKE_ALL CMX_ENV_GLIB_ATOMIC_INT_WAKE_ALL
+#  endif
+
 #define CMX_ENV_GLIB_LABEL_UNUSED                                       \
     G_GNUC_UNUSED
 
@@ -0,0 +1,172 @@
+
+/** @file
+ **
+ ** CMX env using Linux system calls.
+ **
+ ** Env is enabled automatically on Linux when <unistd.h> declares
+ ** syscall () (_DEFAULT_SOURCE or _GNU_SOURCE, implied unless strict
+ ** ISO C mode is requested). It provides wait / wake operations
+ ** on atomic int variables using futex(2).
+ **
+ ** Private futexes are used unless posix shared env is enabled
+ ** (HAVE_CMX_ENV_POSIX_SHARED), variables may live in memory shared
+ ** by several processes then.
+ **
+ ** Process-wide memory barrier uses membarrier(2) (private expedited
+ ** command, registered by CMX_MEMBARRIER_INIT). It is not provided
+ ** with posix shared env, membarrier doesn't reach other processes.
+ **
+ ** Current CPU is read from rseq(2) area registered by glibc (2.35+),
+ ** without system call. getcpu(2) is used when rseq is not
+ ** registered (older glibc, registration failed or disabled).
+ **/
+
+#ifndef CMX_ENV_LINUX_H
+#define CMX_ENV_LINUX_H 1
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#if defined (__linux__) \
+    && (defined (_DEFAULT_SOURCE) || defined (_BSD_SOURCE) || defined (_GNU_SOURCE))
+
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/membarrier.h>
+
+#  if defined (__GLIBC__) && defined (__has_builtin)
+#    if (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35)) \
+        && __has_builtin (__builtin_thread_pointer)
+#    include <sys/rseq.h>
+#    define CMX_ENV_LINUX_RSEQ 1
+#    endif
+#  endif
+
+#  ifdef CMX_ENV_LINUX_RSEQ
+#  define CMX_ENV_LINUX_RSEQ_AREA()                                     \
+    ((volatile struct rseq *) ((char *) __builtin_thread_pointer () + __rseq_offset))
+/**<Evaluates pointer to current thread's rseq area registered by glibc
+ **
+ ** Valid only when __rseq_size is not zero.
+ **/
+#  endif
+
+#  ifdef HAVE_CMX_ENV_POSIX_SHARED
+#  define CMX_ENV_LINUX_FUTEX_WAIT FUTEX_WAIT
+#  define CMX_ENV_LINUX_FUTEX_WAKE FUTEX_WAKE
+#  else
+#  define CMX_ENV_LINUX_FUTEX_WAIT FUTEX_WAIT_PRIVATE
+#  define CMX_ENV_LINUX_FUTEX_WAKE FUTEX_WAKE_PRIVATE
+#  endif
+
+static inline long
+cmx_env_linux_futex (void *addr, int op, int value) {
+    return syscall (SYS_futex, addr, op, value, NULL, NULL, 0);
+}
+/**<Implementation function
+ **/
+
+#define CMX_ENV_LINUX_ATOMIC_INT_WAIT(Var, Value)                       \
+    ((void) cmx_env_linux_futex (& (Var), CMX_ENV_LINUX_FUTEX_WAIT, (Value)))
+
+#  ifndef CMX_ATOMIC_INT_WAIT
+#  define CMX_ATOMIC_INT_WAIT CMX_ENV_LINUX_ATOMIC_INT_WAIT
+#  endif
+
+#define CMX_ENV_LINUX_ATOMIC_INT_WAKE_ONE(Var)                          \
+    ((void) cmx_env_linux_futex (& (Var), CMX_ENV_LINUX_FUTEX_WAKE, 1))
+
+#  ifndef CMX_ATOMIC_INT_WAKE_ONE
+#  define CMX_ATOMIC_INT_WAKE_ONE CMX_ENV_LINUX_ATOMIC_INT_WAKE_ONE
+#  endif
+
+#define CMX_ENV_LINUX_ATOMIC_INT_WAKE_ALL(Var)                          \
+    ((void) cmx_env_linux_futex (& (Var), CMX_ENV_LINUX_FUTEX_WAKE, INT_MAX))
+
+#  ifndef CMX_ATOMIC_INT_WAKE_ALL
+#  define CMX_ATOMIC_INT_WAKE_ALL CMX_ENV_LINUX_ATOMIC_INT_WAKE_ALL
+#  endif
+
+static inline int
+cmx_env_linux_cpu_current (void) {
+    unsigned int cpu;
+    int retval;
+
+#  ifdef CMX_ENV_LINUX_RSEQ
+    if (__rseq_size) {
+        retval = (int) CMX_ENV_LINUX_RSEQ_AREA ()->cpu_id;
+        if (retval >= 0)
+            return retval;
+    }
+#  endif
+
+    if (0 != syscall (SYS_getcpu, &cpu, NULL, NULL))
+        return 0;
+
+    return (int) cpu;
+}
+/**<Implementation function
+ **
+ ** Negative rseq cpu_id means rseq is not registered for this thread.
+ **/
+
+#define CMX_ENV_LINUX_CPU_CURRENT()                                     \
+    cmx_env_linux_cpu_current ()
+
+#  ifndef CMX_CPU_CURRENT
+#  define CMX_CPU_CURRENT CMX_ENV_LINUX_CPU_CURRENT
+#  endif
+
+#  ifndef HAVE_CMX_ENV_POSIX_SHARED
+
+static inline int
+cmx_env_linux_membarrier_init (void) {
+    static int registered;
+    int retval;
+
+#    ifdef __ATOMIC_RELAXED
+    retval = __atomic_load_n (&registered, __ATOMIC_RELAXED);
+#    else
+    retval = * (volatile int *) &registered;
+#    endif
+
+    if (0 == retval) {
+        retval = 0 == syscall (SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0)
+            ? 1
+            : -1;
+#    ifdef __ATOMIC_RELAXED
+        __atomic_store_n (&registered, retval, __ATOMIC_RELAXED);
+#    else
+        * (volatile int *) &registered = retval;
+#    endif
+    }
+
+    return 1 == retval;
+}
+/**<Implementation function
+ **
+ ** Registration is process-wide, its result is cached (per translation
+ ** unit): 0 not tried yet, 1 registered, -1 not available.
+ ** Threads racing on the first call register twice, which is harmless.
+ **/
+
+#define CMX_ENV_LINUX_MEMBARRIER_INIT()                                 \
+    cmx_env_linux_membarrier_init ()
+
+#    ifndef CMX_MEMBARRIER_INIT
+#    define CMX_MEMBARRIER_INIT CMX_ENV_LINUX_MEMBARRIER_INIT
+#    endif
+
+#define CMX_ENV_LINUX_MEMBARRIER()                                      \
+    ((void) syscall (SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0))
+
+#    ifndef CMX_MEMBARRIER
+#    define CMX_MEMBARRIER CMX_ENV_LINUX_MEMBARRIER
+#    endif
+
+#  endif
+
+#endif  /* env conditional */
+#endif  /* header guard */
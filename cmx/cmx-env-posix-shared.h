@@ -0,0 +1,106 @@
+
+/** @file
+ **
+ ** CMX env using process-shared POSIX mutexes.
+ **
+ ** Env is enabled by HAVE_CMX_ENV_POSIX_SHARED (it enables also
+ ** posix env which provides everything else). Use it when structs
+ ** live in shared memory (MAP_SHARED mapping, memfd, shm_open)
+ ** and are accessed by several processes.
+ **
+ ** Mutexes are initialized with PTHREAD_PROCESS_SHARED and
+ ** PTHREAD_MUTEX_ROBUST attributes. When process holding mutex dies,
+ ** next CMX_MUTEX_LOCK recovers mutex (pthread_mutex_consistent)
+ ** so other processes don't deadlock. Data protected by such mutex
+ ** may be inconsistent.
+ **
+ ** CMX_MUTEX_CREATE (anonymous mutexes of CMX_SYNCHRONIZE) stays
+ ** process private.
+ **
+ ** CMX_SINGLE_THREAD_P is always 0: process being single threaded
+ ** doesn't mean that data are not accessed by another process.
+ **
+ ** Atomic operations of compiler env (gcc, C11) are lock-free on
+ ** supported platforms and work across processes as well.
+ **
+ ** Robust mutexes are POSIX.1-2008, strict ISO C builds (-std=c99,
+ ** -std=c11) have to define _POSIX_C_SOURCE 200809L or later.
+ **/
+
+#ifndef CMX_ENV_POSIX_SHARED_H
+#define CMX_ENV_POSIX_SHARED_H 1
+
+#ifdef HAVE_CMX_ENV_POSIX_SHARED
+
+#ifndef HAVE_CMX_ENV_POSIX
+#define HAVE_CMX_ENV_POSIX 1
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+
+#if (defined (__STRICT_ANSI__) && ! defined (_POSIX_C_SOURCE))          \
+    || (defined (_POSIX_C_SOURCE) && _POSIX_C_SOURCE < 200809L)
+#error "HAVE_CMX_ENV_POSIX_SHARED requires robust mutexes, define _POSIX_C_SOURCE 200809L or later"
+#endif
+
+static inline int
+cmx_env_posix_shared_mutex_init (pthread_mutex_t *mutex) {
+    pthread_mutexattr_t attr;
+    int retval;
+
+    pthread_mutexattr_init (&attr);
+    pthread_mutexattr_setpshared (&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust (&attr, PTHREAD_MUTEX_ROBUST);
+    retval = pthread_mutex_init (mutex, &attr);
+    pthread_mutexattr_destroy (&attr);
+
+    return retval;
+}
+/**<Implementation function
+ **/
+
+static inline int
+cmx_env_posix_shared_mutex_lock (pthread_mutex_t *mutex) {
+    int retval = pthread_mutex_lock (mutex);
+
+    if (EOWNERDEAD == retval)
+        retval = pthread_mutex_consistent (mutex);
+
+    return retval;
+}
+/**<Implementation function
+ **
+ ** Lock mutex, recover it if its previous owner died.
+ **/
+
+#define CMX_ENV_POSIX_SHARED_MUTEX_TYPE                                 \
+    pthread_mutex_t
+
+#  ifndef CMX_MUTEX_TYPE
+#  define CMX_MUTEX_TYPE CMX_ENV_POSIX_SHARED_MUTEX_TYPE
+#  endif
+
+#define CMX_ENV_POSIX_SHARED_MUTEX_INIT(Var)                            \
+    cmx_env_posix_shared_mutex_init (& (Var))
+
+#  ifndef CMX_MUTEX_INIT
+#  define CMX_MUTEX_INIT CMX_ENV_POSIX_SHARED_MUTEX_INIT
+#  endif
+
+#define CMX_ENV_POSIX_SHARED_MUTEX_LOCK(Var)                            \
+    cmx_env_posix_shared_mutex_lock (& (Var))
+
+#  ifndef CMX_MUTEX_LOCK
+#  define CMX_MUTEX_LOCK CMX_ENV_POSIX_SHARED_MUTEX_LOCK
+#  endif
+
+#define CMX_ENV_POSIX_SHARED_SINGLE_THREAD_P()                          \
+    0
+
+#  ifndef CMX_SINGLE_THREAD_P
+#  define CMX_SINGLE_THREAD_P CMX_ENV_POSIX_SHARED_SINGLE_THREAD_P
+#  endif
+
+#endif  /* env conditional */
+#endif  /* header guard */
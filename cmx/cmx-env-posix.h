@@ -21,30 +21,113 @@
 #define CMX_ENV_POSIX_MUTEX_CREATE                                      \
     PTHREAD_MUTEX_INITIALIZER
 
-#  if CMX_MUTEX_CREATE
+#  ifndef CMX_MUTEX_CREATE
 #  define CMX_MUTEX_CREATE CMX_ENV_POSIX_MUTEX_CREATE
 #  endif
 
-#define CMX_ENV_POSIX_MUTEX_INIT(Var)                                  \
-    ((Var) = CMX_MUTEX_CREATE)
+#define CMX_ENV_POSIX_MUTEX_INIT(Var)                                   \
+    pthread_mutex_init (& (Var), NULL)
 
-#  if CMX_MUTEX_INIT
+#  ifndef CMX_MUTEX_INIT
 #  define CMX_MUTEX_INIT CMX_ENV_POSIX_MUTEX_INIT
 #  endif
 
 #define CMX_ENV_POSIX_MUTEX_LOCK(Var)                                    \
     pthread_mutex_lock (& (Var))
 
-#  if CMX_MUTEX_LOCK
+#  ifndef CMX_MUTEX_LOCK
 #  define CMX_MUTEX_LOCK CMX_ENV_POSIX_MUTEX_LOCK
 #  endif
 
 #define CMX_ENV_POSIX_MUTEX_UNLOCK(Var)                                 \
     pthread_mutex_unlock (& (Var))
 
-#  if CMX_ENV_BIND_POSIX_P (MUTEX_UNLOCK)
+#  ifndef CMX_MUTEX_UNLOCK
 #  define CMX_MUTEX_UNLOCK CMX_ENV_POSIX_MUTEX_UNLOCK
 #  endif
 
+#define CMX_ENV_POSIX_THREAD_KEY_TYPE                                   \
+    pthread_key_t
+
+#  ifndef CMX_THREAD_KEY_TYPE
+#  define CMX_THREAD_KEY_TYPE CMX_ENV_POSIX_THREAD_KEY_TYPE
+#  endif
+
+#define CMX_ENV_POSIX_THREAD_KEY_INIT(Var, Destroy)                     \
+    pthread_key_create (& (Var), (Destroy))
+
+#  ifndef CMX_THREAD_KEY_INIT
+#  define CMX_THREAD_KEY_INIT CMX_ENV_POSIX_THREAD_KEY_INIT
+#  endif
+
+#define CMX_ENV_POSIX_THREAD_KEY_GET(Var)                               \
+    pthread_getspecific (Var)
+
+#  ifndef CMX_THREAD_KEY_GET
+#  define CMX_THREAD_KEY_GET CMX_ENV_POSIX_THREAD_KEY_GET
+#  endif
+
+#define CMX_ENV_POSIX_THREAD_KEY_SET(Var, Value)                        \
+    pthread_setspecific ((Var), (Value))
+
+#  ifndef CMX_THREAD_KEY_SET
+#  define CMX_THREAD_KEY_SET CMX_ENV_POSIX_THREAD_KEY_SET
+#  endif
+
+#define CMX_ENV_POSIX_THREAD_TYPE                                       \
+    pthread_t
+
+#  ifndef CMX_THREAD_TYPE
+#  define CMX_THREAD_TYPE CMX_ENV_POSIX_THREAD_TYPE
+#  endif
+
+#define CMX_ENV_POSIX_THREAD_CREATE(Var, Function, Arg)                 \
+    pthread_create (& (Var), NULL, (Function), (Arg))
+
+#  ifndef CMX_THREAD_CREATE
+#  define CMX_THREAD_CREATE CMX_ENV_POSIX_THREAD_CREATE
+#  endif
+
+#define CMX_ENV_POSIX_THREAD_JOIN(Var)                                  \
+    pthread_join ((Var), NULL)
+
+#  ifndef CMX_THREAD_JOIN
+#  define CMX_THREAD_JOIN CMX_ENV_POSIX_THREAD_JOIN
+#  endif
+
+#define CMX_ENV_POSIX_THREAD_SELF()                                     \
+    pthread_self ()
+
+#  ifndef CMX_THREAD_SELF
+#  define CMX_THREAD_SELF CMX_ENV_POSIX_THREAD_SELF
+#  endif
+
+#define CMX_ENV_POSIX_THREAD_EQUAL(A, B)                                \
+    pthread_equal ((A), (B))
+
+#  ifndef CMX_THREAD_EQUAL
+#  define CMX_THREAD_EQUAL CMX_ENV_POSIX_THREAD_EQUAL
+#  endif
+
+#include <sched.h>
+
+#define CMX_ENV_POSIX_THREAD_YIELD()                                    \
+    sched_yield ()
+
+#  ifndef CMX_THREAD_YIELD
+#  define CMX_THREAD_YIELD CMX_ENV_POSIX_THREAD_YIELD
+#  endif
+
+#  if defined (__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 32)
+#include <sys/single_threaded.h>
+
+#define CMX_ENV_POSIX_SINGLE_THREAD_P()                                 \
+    (__libc_single_threaded)
+
+#  ifndef CMX_SINGLE_THREAD_P
+#  define CMX_SINGLE_THREAD_P CMX_ENV_POSIX_SINGLE_THREAD_P
+#  endif
+#  endif
+
 #endif  /* env conditional */
 #endif  /* header guard */
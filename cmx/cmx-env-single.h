@@ -0,0 +1,217 @@
+
+/** @file
+ **
+ ** CMX env for single-threaded programs
+ **
+ ** Env is enabled by HAVE_CMX_ENV_SINGLE_THREAD. It compiles
+ ** synchronization out: mutexes do nothing, atomic variables
+ ** are accessed with plain operations, CMX_SINGLE_THREAD_P is constant 1.
+ **
+ ** Env is evaluated before all other envs, operations it doesn't
+ ** provide (exchange, compare exchange, fetch or / and) are provided
+ ** by other envs.
+ **
+ ** FETCH_ADD / FETCH_SUB evaluate Value twice.
+ **/
+
+#ifndef CMX_ENV_SINGLE_H
+#define CMX_ENV_SINGLE_H 1
+
+#ifdef HAVE_CMX_ENV_SINGLE_THREAD
+
+#define CMX_ENV_SINGLE_SINGLE_THREAD_P()                                \
+    1
+
+#  ifndef CMX_SINGLE_THREAD_P
+#  define CMX_SINGLE_THREAD_P CMX_ENV_SINGLE_SINGLE_THREAD_P
+#  endif
+
+#define CMX_ENV_SINGLE_THREAD_LOCAL
+
+#  ifndef CMX_THREAD_LOCAL
+#  define CMX_THREAD_LOCAL CMX_ENV_SINGLE_THREAD_LOCAL
+#  endif
+
+#define CMX_ENV_SINGLE_MUTEX_TYPE                                       \
+    char
+
+#  ifndef CMX_MUTEX_TYPE
+#  define CMX_MUTEX_TYPE CMX_ENV_SINGLE_MUTEX_TYPE
+#  endif
+
+#define CMX_ENV_SINGLE_MUTEX_CREATE                                     \
+    0
+
+#  ifndef CMX_MUTEX_CREATE
+#  define CMX_MUTEX_CREATE CMX_ENV_SINGLE_MUTEX_CREATE
+#  endif
+
+#define CMX_ENV_SINGLE_MUTEX_INIT(Var)                                  \
+    (Var) = 0
+
+#  ifndef CMX_MUTEX_INIT
+#  define CMX_MUTEX_INIT CMX_ENV_SINGLE_MUTEX_INIT
+#  endif
+
+#define CMX_ENV_SINGLE_MUTEX_LOCK(Var)                                  \
+    ((void) 0)
+
+#  ifndef CMX_MUTEX_LOCK
+#  define CMX_MUTEX_LOCK CMX_ENV_SINGLE_MUTEX_LOCK
+#  endif
+
+#define CMX_ENV_SINGLE_MUTEX_UNLOCK(Var)                                \
+    ((void) 0)
+
+#  ifndef CMX_MUTEX_UNLOCK
+#  define CMX_MUTEX_UNLOCK CMX_ENV_SINGLE_MUTEX_UNLOCK
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_TYPE                                  \
+    int
+
+#  ifndef CMX_ATOMIC_INT_TYPE
+#  define CMX_ATOMIC_INT_TYPE CMX_ENV_SINGLE_ATOMIC_INT_TYPE
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_SET(Var, Value)                       \
+    ((Var) = (Value))
+
+#  ifndef CMX_ATOMIC_INT_SET
+#  define CMX_ATOMIC_INT_SET CMX_ENV_SINGLE_ATOMIC_INT_SET
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_INCREMENT(Var)                        \
+    (++ (Var))
+
+#  ifndef CMX_ATOMIC_INT_INCREMENT
+#  define CMX_ATOMIC_INT_INCREMENT CMX_ENV_SINGLE_ATOMIC_INT_INCREMENT
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_DECREMENT_AND_TEST(Var)               \
+    (0 == -- (Var))
+
+#  ifndef CMX_ATOMIC_INT_DECREMENT_AND_TEST
+#  define CMX_ATOMIC_INT_DECREMENT_AND_TEST CMX_ENV_SINGLE_ATOMIC_INT_DECREMENT_AND_TEST
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_LOAD(Var)                             \
+    (Var)
+
+#  ifndef CMX_ATOMIC_INT_LOAD
+#  define CMX_ATOMIC_INT_LOAD CMX_ENV_SINGLE_ATOMIC_INT_LOAD
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_STORE(Var, Value)                     \
+    ((Var) = (Value))
+
+#  ifndef CMX_ATOMIC_INT_STORE
+#  define CMX_ATOMIC_INT_STORE CMX_ENV_SINGLE_ATOMIC_INT_STORE
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT64_LOAD(Var)                           \
+    (Var)
+
+#  ifndef CMX_ATOMIC_INT64_LOAD
+#  define CMX_ATOMIC_INT64_LOAD CMX_ENV_SINGLE_ATOMIC_INT64_LOAD
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT64_STORE(Var, Value)                   \
+    ((Var) = (Value))
+
+#  ifndef CMX_ATOMIC_INT64_STORE
+#  define CMX_ATOMIC_INT64_STORE CMX_ENV_SINGLE_ATOMIC_INT64_STORE
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_PTR_LOAD(Var)                             \
+    (Var)
+
+#  ifndef CMX_ATOMIC_PTR_LOAD
+#  define CMX_ATOMIC_PTR_LOAD CMX_ENV_SINGLE_ATOMIC_PTR_LOAD
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_PTR_STORE(Var, Value)                     \
+    ((Var) = (Value))
+
+#  ifndef CMX_ATOMIC_PTR_STORE
+#  define CMX_ATOMIC_PTR_STORE CMX_ENV_SINGLE_ATOMIC_PTR_STORE
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_SIZE_LOAD(Var)                            \
+    (Var)
+
+#  ifndef CMX_ATOMIC_SIZE_LOAD
+#  define CMX_ATOMIC_SIZE_LOAD CMX_ENV_SINGLE_ATOMIC_SIZE_LOAD
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_SIZE_STORE(Var, Value)                    \
+    ((Var) = (Value))
+
+#  ifndef CMX_ATOMIC_SIZE_STORE
+#  define CMX_ATOMIC_SIZE_STORE CMX_ENV_SINGLE_ATOMIC_SIZE_STORE
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_FETCH_ADD(Var, Value)                 \
+    (((Var) += (Value)) - (Value))
+
+#  ifndef CMX_ATOMIC_INT_FETCH_ADD
+#  define CMX_ATOMIC_INT_FETCH_ADD CMX_ENV_SINGLE_ATOMIC_INT_FETCH_ADD
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_FETCH_SUB(Var, Value)                 \
+    (((Var) -= (Value)) + (Value))
+
+#  ifndef CMX_ATOMIC_INT_FETCH_SUB
+#  define CMX_ATOMIC_INT_FETCH_SUB CMX_ENV_SINGLE_ATOMIC_INT_FETCH_SUB
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT64_FETCH_ADD(Var, Value)               \
+    (((Var) += (Value)) - (Value))
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_ADD
+#  define CMX_ATOMIC_INT64_FETCH_ADD CMX_ENV_SINGLE_ATOMIC_INT64_FETCH_ADD
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT64_FETCH_SUB(Var, Value)               \
+    (((Var) -= (Value)) + (Value))
+
+#  ifndef CMX_ATOMIC_INT64_FETCH_SUB
+#  define CMX_ATOMIC_INT64_FETCH_SUB CMX_ENV_SINGLE_ATOMIC_INT64_FETCH_SUB
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_SIZE_FETCH_ADD(Var, Value)                \
+    (((Var) += (Value)) - (Value))
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_ADD
+#  define CMX_ATOMIC_SIZE_FETCH_ADD CMX_ENV_SINGLE_ATOMIC_SIZE_FETCH_ADD
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_SIZE_FETCH_SUB(Var, Value)                \
+    (((Var) -= (Value)) + (Value))
+
+#  ifndef CMX_ATOMIC_SIZE_FETCH_SUB
+#  define CMX_ATOMIC_SIZE_FETCH_SUB CMX_ENV_SINGLE_ATOMIC_SIZE_FETCH_SUB
+#  endif
+#define CMX_ENV_SINGLE_ATOMIC_INT_WAIT(Var, Value)                      \
+    ((void) 0)
+
+#  ifndef CMX_ATOMIC_INT_WAIT
+#  define CMX_ATOMIC_INT_WAIT CMX_ENV_SINGLE_ATOMIC_INT_WAIT
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_WAKE_ONE(Var)                         \
+    ((void) 0)
+
+#  ifndef CMX_ATOMIC_INT_WAKE_ONE
+#  define CMX_ATOMIC_INT_WAKE_ONE CMX_ENV_SINGLE_ATOMIC_INT_WAKE_ONE
+#  endif
+
+#define CMX_ENV_SINGLE_ATOMIC_INT_WAKE_ALL(Var)                         \
+    ((void) 0)
+
+#  ifndef CMX_ATOMIC_INT_WAKE_ALL
+#  define CMX_ATOMIC_INT_WAKE_ALL CMX_ENV_SINGLE_ATOMIC_INT_WAKE_ALL
+#  endif
+
+#endif  /* env conditional */
+#endif  /* header guard */
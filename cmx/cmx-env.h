@@ -35,10 +35,91 @@
  **   Unlock mutex.
  **   Var is a CMX_ATOMIC_TYPE variable.
  **
+ ** Implementations:
+ ** - posix env: pthread_mutex_t
+ ** - posix shared env (HAVE_CMX_ENV_POSIX_SHARED): process-shared robust
+ **   pthread_mutex_t for structs living in shared memory
+ ** - glib env: GMutex
+ **
+ ** @subsection Single thread mode
+ **
+ ** - CMX_SINGLE_THREAD_P ()
+ **   Evaluates TRUE while process has only one thread.
+ **   Macros use plain (non-atomic, unlocked) operations in such case.
+ **   Once it evaluates FALSE it must never evaluate TRUE again.
+ **   Don't create threads inside synchronized blocks, mutex of block
+ **   entered in single thread mode is not locked.
+ **   Implementations:
+ **   - single thread env: always 1
+ **   - posix env with glibc 2.32+: __libc_single_threaded
+ **   - posix shared env: always 0
+ **   Default implementation: 0
+ **
+ ** @subsection Thread keys
+ **
+ ** - CMX_THREAD_KEY_TYPE
+ **   Thread specific data key type (eg. pthread_key_t)
+ **
+ ** - CMX_THREAD_KEY_INIT (Var, Destroy)
+ **   Initialize key, must be evaluated once before key is used.
+ **   Destroy is void (*) (void *) function called at thread exit
+ **   with non-NULL value of the thread.
+ **
+ ** - CMX_THREAD_KEY_GET (Var)
+ **   Value (void *) of current thread, NULL if not set.
+ **
+ ** - CMX_THREAD_KEY_SET (Var, Value)
+ **   Set value (void *) of current thread.
+ **
+ ** @subsection Threads
+ **
+ ** - CMX_THREAD_TYPE
+ **   Thread handle type (eg. pthread_t)
+ **
+ ** - CMX_THREAD_CREATE (Var, Function, Arg)
+ **   Start thread evaluating void * Function (void *Arg), store its
+ **   handle into Var. Evaluates 0 on success.
+ **
+ ** - CMX_THREAD_JOIN (Var)
+ **   Wait until thread Var finishes.
+ **
+ ** - CMX_THREAD_SELF ()
+ **   Handle of current thread.
+ **
+ ** - CMX_THREAD_EQUAL (A, B)
+ **   Evaluates TRUE if handles A and B identify the same thread.
+ **
+ ** Implementations: posix env, glib env
+ **
+ ** @subsection Thread yield
+ **
+ ** - CMX_THREAD_YIELD ()
+ **   Let other threads run, used by macros waiting for other thread
+ **   to finish short critical step.
+ **   Implementations:
+ **   - posix env: sched_yield ()
+ **   - glib env: g_thread_yield ()
+ **   Default implementation: no-op (busy wait)
+ **
  ** @subsection Atomic operations
  **
+ ** Atomic operations are provided for four kinds of variables,
+ ** KIND is one of INT, INT64, PTR, SIZE.
+ **
  ** - CMX_ATOMIC_INT_TYPE
- **   Atomic data type
+ **   Atomic int data type
+ **
+ ** - CMX_ATOMIC_INT64_TYPE
+ **   Atomic 64-bit integer data type
+ **   Default implementation: int64_t
+ **
+ ** - CMX_ATOMIC_PTR_TYPE (Type)
+ **   Pointer to Type usable with CMX_ATOMIC_PTR_ macros.
+ **   Default implementation: Type *
+ **
+ ** - CMX_ATOMIC_SIZE_TYPE
+ **   Atomic size_t data type
+ **   Default implementation: size_t
  **
  ** - CMX_ATOMIC_INT_SET (Var, Value)
  **   Set atomically Value to Var.
@@ -49,7 +130,103 @@
  **   Var is a CMX_ATOMIC_INT_TYPE variable.
  **
  ** - CMX_ATOMIC_INT_DECREMENT_AND_TEST (Var)
- **   Assign Value to Var. Var is a CMX_ATOMIC_INT_TYPE variable.
+ **   Decrement Var value, evaluates TRUE when it reached zero.
+ **   Var is a CMX_ATOMIC_INT_TYPE variable.
+ **
+ ** Following macros are available for every KIND,
+ ** Var is a CMX_ATOMIC_KIND_TYPE variable.
+ **
+ ** - CMX_ATOMIC_KIND_LOAD (Var)
+ **   Read Var value (acquire semantic).
+ **
+ ** - CMX_ATOMIC_KIND_STORE (Var, Value)
+ **   Set Value to Var (release semantic).
+ **
+ ** - CMX_ATOMIC_KIND_EXCHANGE (Var, Value)
+ **   Set Value to Var and return its previous value.
+ **
+ ** - CMX_ATOMIC_KIND_COMPARE_EXCHANGE (Var, Expected, Desired)
+ **   If Var equals to Expected set Desired to Var and evaluate TRUE,
+ **   otherwise store current value of Var into Expected and evaluate FALSE.
+ **   Expected must be an lvalue (non-atomic variable).
+ **   Acquire-release semantic on success, acquire on failure.
+ **
+ ** - CMX_ATOMIC_KIND_COMPARE_EXCHANGE_WEAK (Var, Expected, Desired)
+ **   Same as CMX_ATOMIC_KIND_COMPARE_EXCHANGE but may fail spuriously,
+ **   use it in retry loops.
+ **
+ ** Following macros are available for INT, INT64 and SIZE,
+ ** they return previous value of Var.
+ **
+ ** - CMX_ATOMIC_KIND_FETCH_ADD (Var, Value)
+ ** - CMX_ATOMIC_KIND_FETCH_SUB (Var, Value)
+ ** - CMX_ATOMIC_KIND_FETCH_OR (Var, Value)
+ ** - CMX_ATOMIC_KIND_FETCH_AND (Var, Value)
+ **
+ ** Available implementations:
+ ** - gcc (__atomic builtins), complete
+ ** - C11 (<stdatomic.h>), complete, enabled by HAVE_CMX_ENV_C11.
+ **   Atomic types are _Atomic qualified.
+ ** - glib, INT and PTR only (COMPARE_EXCHANGE and INT_EXCHANGE require
+ **   glib 2.74), missing macros are provided by compiler env
+ **
+ ** - CMX_ATOMIC_FENCE ()
+ **   Full (sequentially consistent) memory barrier.
+ **
+ ** - CMX_COMPILER_FENCE ()
+ **   Compiler barrier, prevents only reordering by compiler.
+ **
+ ** Implementations: gcc, C11
+ **
+ ** @subsection Process-wide memory barrier
+ **
+ ** Asymmetric barrier: frequent side uses compiler barrier only,
+ ** rare side issues barrier on all running threads of the process.
+ **
+ ** - CMX_MEMBARRIER_INIT ()
+ **   Prepare process-wide barrier, evaluates TRUE if it is available.
+ **   When it evaluates FALSE, frequent side must use CMX_ATOMIC_FENCE.
+ **
+ ** - CMX_MEMBARRIER ()
+ **   Issue memory barrier on all threads of the process.
+ **
+ ** Implementations:
+ ** - linux env (without posix shared env): membarrier(2)
+ ** Default implementation: not available, CMX_ATOMIC_FENCE
+ **
+ ** @subsection Current CPU
+ **
+ ** - CMX_CPU_CURRENT ()
+ **   Evaluates number of CPU current thread runs on (non-negative int).
+ **   Thread may be migrated immediately, use it only as a hint
+ **   (eg. to select per-CPU shard).
+ **
+ ** Implementations:
+ ** - linux env: rseq(2) area registered by glibc, getcpu(2)
+ ** Default implementation: 0
+ **
+ ** @subsection Wait and wake
+ **
+ ** - CMX_ATOMIC_INT_WAIT (Var, Value)
+ **   Block while CMX_ATOMIC_INT_TYPE Var equals to Value.
+ **   May return spuriously, caller must check Var again.
+ **
+ ** - CMX_ATOMIC_INT_WAKE_ONE (Var)
+ ** - CMX_ATOMIC_INT_WAKE_ALL (Var)
+ **   Wake one / all threads waiting on Var, call them after Var
+ **   was modified.
+ **
+ ** - CMX_ENV_STORAGE
+ **   File scope definitions required by env, use it (followed by ';')
+ **   in exactly one file of program.
+ **
+ ** Implementations:
+ ** - linux env (enabled on Linux unless strict ISO C mode): futex(2)
+ ** - glib env: table of GMutex / GCond pairs hashed by variable address,
+ **   defined by CMX_ENV_STORAGE
+ ** - single thread env: no-op
+ ** Default implementation: CMX_THREAD_YIELD (busy wait), wake is no-op,
+ ** CMX_ENV_STORAGE defines nothing
  **
  ** @subsection Misc macros
  **
@@ -61,6 +238,29 @@
  **   may consider it as warning and provide feature(s) to avoid
  **   it when label is generated by macro.
  **
+ ** - CMX_FALLTHROUGH
+ **   Statement (followed by ';') marking intended fall through
+ **   into macro generated case label, so compilers warning about
+ **   implicit fall through (-Wextra) stay silent.
+ **   Example: (using gcc)
+ **     __attribute__ ((__fallthrough__))
+ **
+ ** - CMX_LIKELY (X)
+ ** - CMX_UNLIKELY (X)
+ **   Evaluate condition X, hint compiler which result is expected
+ **   so expected path is laid out as straight fall-through code.
+ **   Example: (using gcc)
+ **     __builtin_expect (!! (X), 1)
+ **
+ ** - CMX_COLD
+ **   Used instead of 'inline' by static helpers of rarely executed
+ **   slow paths (contended wait, destroy, first share). Compiler doesn't
+ **   inline them and places them away from hot code, so block macros
+ **   expand into short fast path and don't pollute instruction cache.
+ **   Default implementation: inline
+ **   Example: (using gcc)
+ **     __attribute__((__cold__, __noinline__, __unused__))
+ **
  ** - CMX_LOCAL_STORE (Name, Var)
  **   create variable Name and initialize it with value of Var expression
  **   Example: (using gcc)
@@ -70,15 +270,34 @@
  **   Assign value of Name variable into Var expression
  **   Example: (using gcc)
  **     Var = Name
+ **
+ ** - CMX_CACHE_LINE_SIZE
+ **   Size of CPU cache line, used to separate data written
+ **   by different threads.
+ **   Default implementation: 64
+ **
+ ** - CMX_THREAD_LOCAL
+ **   Storage class specifier of thread local variables
+ **   (eg. gcc's __thread). No default implementation.
  **/
 
 #ifndef CMX_ENV_H
 #define CMX_ENV_H 1
 
+/* single thread env (overrides all others) */
+#include <cmx/cmx-env-single.h>
+
 /* library specific env */
 #include <cmx/cmx-env-glib.h>
+#include <cmx/cmx-env-posix-shared.h>
 #include <cmx/cmx-env-posix.h>
 
+/* system specific env */
+#include <cmx/cmx-env-linux.h>
+
+/* language standard env */
+#include <cmx/cmx-env-c11.h>
+
 /* compiler specific env */
 #include <cmx/cmx-env-gcc.h>
 
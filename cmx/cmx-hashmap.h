@@ -0,0 +1,315 @@
+
+#ifndef CMX_HASHMAP_H
+#define CMX_HASHMAP_H 1
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-synchronize.h>
+#include <cmx/cmx-struct-refs.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Concurrent hash map template with per-segment locks.
+ **
+ ** @section Idea behind
+ **
+ ** Map is split into CMX_HASHMAP_SEGMENTS segments, each one is an open
+ ** addressing (linear probing) table guarded by its own mutex,
+ ** so threads working with different keys rarely meet on the same lock.
+ **
+ ** Segment grows independently on others and incrementally: when table
+ ** is full new one is allocated and every following insert / remove
+ ** moves CMX_HASHMAP_MIGRATE_STEP slots from the old one. Lookups check
+ ** both tables until migration finishes.
+ **
+ ** Values are pointers to CMX_STRUCT_REFS structs:
+ ** - insert passes caller's reference to map
+ ** - lookup returns new reference (CMX_STRUCT_REFS_INCREMENT)
+ ** - remove passes map's reference back to caller
+ **
+ ** Keys are copied by value, map doesn't own memory they point to.
+ **
+ ** Macros require environment with CMX_MUTEX_ and CMX_ATOMIC_INT_ defined
+ **
+ ** @section Proposed usage
+ **
+ **     #define foo_hash(Key) ...
+ **     #define foo_eq(A, B)  (0 == strcmp ((A), (B)))
+ **
+ **     CMX_HASHMAP_DEFINE (Foo_Map, const char *, struct Foo *, foo_hash, foo_eq);
+ **
+ **     struct Foo_Map map;
+ **     Foo_Map_init (&map);
+ **     Foo_Map_insert (&map, foo->name, foo);
+ **     foo = Foo_Map_lookup (&map, "name");
+ **     ...
+ **     foo_unref (foo);
+ **     Foo_Map_destroy (&map, foo_unref);
+ **/
+
+#ifndef CMX_HASHMAP_SEGMENTS
+#define CMX_HASHMAP_SEGMENTS                                            \
+    16
+/**<Number of segments (locks) per map
+ **
+ ** You can override default value defining this macro before including cmx.h
+ **/
+#endif
+
+#ifndef CMX_HASHMAP_MIGRATE_STEP
+#define CMX_HASHMAP_MIGRATE_STEP                                        \
+    8
+/**<Number of old table slots migrated by each insert / remove
+ **
+ ** Must be at least 4 to finish migration before table needs to grow again.
+ **/
+#endif
+
+#define CMX_HASHMAP_SIZE_MIN                                            \
+    8
+/**<Initial size of segment table
+ **/
+
+#define CMX_HASHMAP_SLOT_EMPTY                                          \
+    0
+
+#define CMX_HASHMAP_SLOT_FULL                                           \
+    1
+
+#define CMX_HASHMAP_SLOT_DELETED                                        \
+    2
+
+#define CMX_HASHMAP_DEFINE(Name, Key, Value, Hash, Eq)                  \
+    struct Name##_Slot {                                                \
+        Key key;                                                        \
+        Value value;                                                    \
+        unsigned char state;                                            \
+    };                                                                  \
+                                                                        \
+    struct Name##_Table {                                               \
+        size_t size;                                                    \
+        size_t used;                                                    \
+        struct Name##_Slot *slots;                                      \
+    };                                                                  \
+                                                                        \
+    struct Name##_Segment {                                             \
+        CMX_MUTEX_TYPE mutex;                                           \
+        size_t count;                                                   \
+        size_t migrated;                                                \
+        struct Name##_Table table;                                      \
+        struct Name##_Table old;                                        \
+        char padding[CMX_CACHE_LINE_SIZE];                              \
+    };                                                                  \
+                                                                        \
+    struct Name {                                                       \
+        struct Name##_Segment segments[CMX_HASHMAP_SEGMENTS];           \
+    };                                                                  \
+                                                                        \
+    static inline void                                                  \
+    Name##_init (struct Name *self) {                                   \
+        size_t i;                                                       \
+        for (i = 0; i < CMX_HASHMAP_SEGMENTS; ++i) {                    \
+            struct Name##_Segment *segment = &self->segments[i];        \
+            CMX_MUTEX_INIT (segment->mutex);                            \
+            segment->count = 0;                                         \
+            segment->migrated = 0;                                      \
+            segment->table.size = segment->old.size = 0;                \
+            segment->table.used = segment->old.used = 0;                \
+            segment->table.slots = segment->old.slots = NULL;           \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    static inline struct Name##_Slot *                                  \
+    Name##_table_find (struct Name##_Table *table, size_t hash, Key key) { \
+        size_t mask = table->size - 1;                                  \
+        size_t i;                                                       \
+        if (0 == table->size)                                           \
+            return NULL;                                                \
+        for (i = hash & mask;; i = (i + 1) & mask) {                    \
+            struct Name##_Slot *slot = &table->slots[i];                \
+            if (CMX_HASHMAP_SLOT_EMPTY == slot->state)                  \
+                return NULL;                                            \
+            if (CMX_HASHMAP_SLOT_FULL == slot->state && Eq (slot->key, key)) \
+                return slot;                                            \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    static inline void                                                  \
+    Name##_table_place (struct Name##_Table *table, size_t hash, Key key, Value value) { \
+        size_t mask = table->size - 1;                                  \
+        size_t i = hash & mask;                                         \
+        while (CMX_HASHMAP_SLOT_FULL == table->slots[i].state)          \
+            i = (i + 1) & mask;                                         \
+        if (CMX_HASHMAP_SLOT_EMPTY == table->slots[i].state)            \
+            ++table->used;                                              \
+        table->slots[i].key = key;                                      \
+        table->slots[i].value = value;                                  \
+        table->slots[i].state = CMX_HASHMAP_SLOT_FULL;                  \
+    }                                                                   \
+                                                                        \
+    static inline void                                                  \
+    Name##_migrate (struct Name##_Segment *segment, size_t steps) {     \
+        while (NULL != segment->old.slots && steps-- > 0) {             \
+            struct Name##_Slot *slot = &segment->old.slots[segment->migrated++]; \
+            if (CMX_HASHMAP_SLOT_FULL == slot->state) {                 \
+                Name##_table_place (                                    \
+                    &segment->table,                                    \
+                    (size_t) (Hash (slot->key)) / CMX_HASHMAP_SEGMENTS, \
+                    slot->key,                                          \
+                    slot->value                                         \
+                );                                                      \
+                slot->state = CMX_HASHMAP_SLOT_DELETED;                 \
+            }                                                           \
+            if (segment->migrated == segment->old.size) {               \
+                free (segment->old.slots);                              \
+                segment->old.slots = NULL;                              \
+                segment->old.size = segment->old.used = 0;              \
+            }                                                           \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    static inline int                                                   \
+    Name##_grow (struct Name##_Segment *segment) {                      \
+        size_t size = segment->table.size;                              \
+        struct Name##_Slot *slots;                                      \
+        if (0 == size)                                                  \
+            size = CMX_HASHMAP_SIZE_MIN;                                \
+        else if ((segment->count + 1) * 2 > size)                       \
+            size *= 2;                                                  \
+        slots = calloc (size, sizeof (*slots));                         \
+        if (NULL == slots)                                              \
+            return 0;                                                   \
+        Name##_migrate (segment, (size_t) -1);                          \
+        if (NULL != segment->table.slots) {                             \
+            segment->old = segment->table;                              \
+            segment->migrated = 0;                                      \
+        }                                                               \
+        segment->table.size = size;                                     \
+        segment->table.used = 0;                                        \
+        segment->table.slots = slots;                                   \
+        return 1;                                                       \
+    }                                                                   \
+                                                                        \
+    static inline struct Name##_Slot *                                  \
+    Name##_segment_find (struct Name##_Segment *segment, size_t hash, Key key) { \
+        struct Name##_Slot *slot = Name##_table_find (&segment->table, hash, key); \
+        return NULL != slot ? slot : Name##_table_find (&segment->old, hash, key); \
+    }                                                                   \
+                                                                        \
+    static inline int                                                   \
+    Name##_insert (struct Name *self, Key key, Value value) {           \
+        size_t hash = (size_t) (Hash (key));                            \
+        struct Name##_Segment *segment = &self->segments[hash % CMX_HASHMAP_SEGMENTS]; \
+        int retval = 0;                                                 \
+        hash /= CMX_HASHMAP_SEGMENTS;                                   \
+        CMX_SYNCHRONIZE_WITH (&segment->mutex) {                        \
+            Name##_migrate (segment, CMX_HASHMAP_MIGRATE_STEP);         \
+            if (NULL != Name##_segment_find (segment, hash, key))       \
+                break;                                                  \
+            if ((segment->table.used + 1) * 4 > segment->table.size * 3 \
+                && ! Name##_grow (segment)) {                           \
+                retval = -1;                                            \
+                break;                                                  \
+            }                                                           \
+            Name##_table_place (&segment->table, hash, key, value);     \
+            ++segment->count;                                           \
+            retval = 1;                                                 \
+        }                                                               \
+        return retval;                                                  \
+    }                                                                   \
+                                                                        \
+    static inline Value                                                 \
+    Name##_lookup (struct Name *self, Key key) {                        \
+        size_t hash = (size_t) (Hash (key));                            \
+        struct Name##_Segment *segment = &self->segments[hash % CMX_HASHMAP_SEGMENTS]; \
+        Value retval = NULL;                                            \
+        hash /= CMX_HASHMAP_SEGMENTS;                                   \
+        CMX_SYNCHRONIZE_WITH (&segment->mutex) {                        \
+            struct Name##_Slot *slot = Name##_segment_find (segment, hash, key); \
+            if (NULL == slot)                                           \
+                break;                                                  \
+            retval = slot->value;                                       \
+            CMX_STRUCT_REFS_INCREMENT (retval);                         \
+        }                                                               \
+        return retval;                                                  \
+    }                                                                   \
+                                                                        \
+    static inline Value                                                 \
+    Name##_remove (struct Name *self, Key key) {                        \
+        size_t hash = (size_t) (Hash (key));                            \
+        struct Name##_Segment *segment = &self->segments[hash % CMX_HASHMAP_SEGMENTS]; \
+        Value retval = NULL;                                            \
+        hash /= CMX_HASHMAP_SEGMENTS;                                   \
+        CMX_SYNCHRONIZE_WITH (&segment->mutex) {                        \
+            struct Name##_Slot *slot;                                   \
+            Name##_migrate (segment, CMX_HASHMAP_MIGRATE_STEP);         \
+            slot = Name##_segment_find (segment, hash, key);            \
+            if (NULL == slot)                                           \
+                break;                                                  \
+            retval = slot->value;                                       \
+            slot->state = CMX_HASHMAP_SLOT_DELETED;                     \
+            --segment->count;                                           \
+        }                                                               \
+        return retval;                                                  \
+    }                                                                   \
+                                                                        \
+    static inline size_t                                                \
+    Name##_count (struct Name *self) {                                  \
+        size_t retval = 0;                                              \
+        size_t i;                                                       \
+        for (i = 0; i < CMX_HASHMAP_SEGMENTS; ++i)                      \
+            CMX_SYNCHRONIZE_WITH (&self->segments[i].mutex)             \
+                retval += self->segments[i].count;                      \
+        return retval;                                                  \
+    }                                                                   \
+                                                                        \
+    static inline void                                                  \
+    Name##_destroy (struct Name *self, void (*unref) (Value)) {         \
+        size_t i;                                                       \
+        size_t j;                                                       \
+        for (i = 0; i < CMX_HASHMAP_SEGMENTS; ++i) {                    \
+            struct Name##_Segment *segment = &self->segments[i];        \
+            Name##_migrate (segment, (size_t) -1);                      \
+            for (j = 0; NULL != unref && j < segment->table.size; ++j)  \
+                if (CMX_HASHMAP_SLOT_FULL == segment->table.slots[j].state) \
+                    unref (segment->table.slots[j].value);              \
+            free (segment->table.slots);                                \
+            segment->table.slots = NULL;                                \
+            segment->table.size = segment->table.used = 0;              \
+            segment->count = 0;                                         \
+        }                                                               \
+    }                                                                   \
+                                                                        \
+    struct Name
+/**<Define hash map type Name and its functions
+ **
+ ** @param Name  map type name (struct Name) and function prefix
+ ** @param Key   key type
+ ** @param Value value type, pointer to CMX_STRUCT_REFS struct
+ ** @param Hash  function or macro: size_t Hash (Key)
+ ** @param Eq    function or macro: int Eq (Key, Key), nonzero when equal
+ **
+ ** Defines:
+ ** - void  Name_init    (struct Name *)
+ **   Initialize map (allocates nothing)
+ ** - int   Name_insert  (struct Name *, Key, Value)
+ **   Returns 1 when inserted (map owns caller's reference),
+ **   0 when key is already present, -1 when memory allocation failed
+ ** - Value Name_lookup  (struct Name *, Key)
+ **   Returns referenced value or NULL
+ ** - Value Name_remove  (struct Name *, Key)
+ **   Returns removed value (with map's reference) or NULL
+ ** - size_t Name_count  (struct Name *)
+ ** - void  Name_destroy (struct Name *, void (*unref) (Value))
+ **   Release map memory, call unref (if not NULL) for each value.
+ **   Map must not be used concurrently.
+ **
+ ** Usage (at file scope):
+ **   CMX_HASHMAP_DEFINE (Foo_Map, int, struct Foo *, int_hash, int_eq);
+ **/
+
+#endif  /* guard */
@@ -0,0 +1,118 @@
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Lock-free lazy initialization of shared pointer.
+ **
+ ** @section Idea behind
+ **
+ ** CMX_RUN_ONCE makes all racing threads wait on mutex until the first
+ ** one finishes (possibly slow) initialization. For idempotent values
+ ** (parsed schema, compiled regex, ...) it is cheaper to let every racing
+ ** thread build its own candidate and publish the first one using
+ ** compare-and-swap. Losers destroy their candidates and use the winner.
+ **
+ ** Once value is published, CMX_LAZY_INIT costs single acquire load.
+ **
+ ** Macros require environment with CMX_ATOMIC_PTR_ defined
+ **
+ ** @section Proposed usage
+ **
+ **     static CMX_ATOMIC_PTR_TYPE (struct Schema) schema;
+ **
+ **     struct Schema * get_schema (void) {
+ **         struct Schema *candidate;
+ **
+ **         CMX_LAZY_INIT (schema, candidate) {
+ **             candidate = schema_parse (...);
+ **         } else {
+ **             schema_free (candidate);
+ **         }
+ **
+ **         return CMX_ATOMIC_PTR_LOAD (schema);
+ **     }
+ **/
+
+#ifndef CMX_LAZY_H
+#define CMX_LAZY_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-meta.h>
+#include <cmx/cmx-env.h>
+
+#define CMX_LAZY_INIT(PtrVar, Candidate)                                \
+    CMX_LAZY_INIT_TRAN (                                                \
+        CMX_UNIQUE_TOKEN (CMX_LAZY_INIT),                               \
+        PtrVar,                                                         \
+        Candidate                                                       \
+    )
+/**<Build and publish value of PtrVar if it is not set yet
+ **
+ ** Following block is evaluated only if PtrVar is NULL, it should store
+ ** new value into Candidate (leaving it NULL publishes nothing).
+ ** Candidate is then published into PtrVar unless other thread was
+ ** faster, in such case else-clause is evaluated to destroy Candidate.
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** @param PtrVar    CMX_ATOMIC_PTR_TYPE variable
+ ** @param Candidate pointer variable of the same type
+ **
+ ** Usage:
+ **   CMX_LAZY_INIT (ptr, candidate) { candidate = build (); }
+ **   CMX_LAZY_INIT (ptr, candidate) { candidate = build (); } else { destroy (candidate); }
+ **/
+
+#define CMX_LAZY_INIT_TRAN(Prefix, PtrVar, Candidate)                   \
+    CMX_LAZY_INIT_IMPL (                                                \
+        CMX_TOKEN (Prefix, State),                                      \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Else),                                       \
+        CMX_TOKEN (Prefix, Finish),                                     \
+        PtrVar,                                                         \
+        Candidate                                                       \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_LAZY_INIT_IMPL(State, Body, Else, Finish, PtrVar, Candidate) \
+    if (1) {                                                            \
+        int State = 0;                                                  \
+        if (CMX_UNLIKELY (NULL == CMX_ATOMIC_PTR_LOAD (PtrVar))) {      \
+            (Candidate) = NULL;                                         \
+            goto Body;                                                  \
+        }                                                               \
+        if (0) {                                                        \
+        Finish:                                                         \
+            if (0 == State++                                            \
+                && NULL != (Candidate)                                  \
+                && ! cmx_lazy_publish (                                 \
+                    (CMX_ATOMIC_PTR_TYPE (void) *) & (PtrVar),          \
+                    (Candidate)                                         \
+                ))                                                      \
+                goto Else;                                              \
+        }                                                               \
+    } else CMX_META_BODY_ELSE_BREAK (Body, Else, Finish)
+/**<Implementation macro
+ **
+ ** Both block and else-clause return to Finish, State distinguishes
+ ** first return (publish) from second one (after else-clause).
+ **/
+
+static inline int
+cmx_lazy_publish (CMX_ATOMIC_PTR_TYPE (void) *ptr, void *candidate) {
+    void *expected = NULL;
+
+    return CMX_ATOMIC_PTR_COMPARE_EXCHANGE (*ptr, expected, candidate);
+}
+/**<Implementation function
+ **
+ ** Returns TRUE if candidate was published
+ **/
+
+#endif  /* header guard */
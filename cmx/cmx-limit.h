@@ -0,0 +1,272 @@
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Admission control: limit number of threads evaluating block
+ ** concurrently.
+ **
+ ** @section Idea behind
+ **
+ ** Expensive sections (decompression, external calls, ...) may need
+ ** a cap on concurrency to bound memory and cache footprint rather
+ ** than mutual exclusion. CMX_LIMIT is synchronized block backed by
+ ** counting semaphore, slot is released when block finishes or break
+ ** is evaluated.
+ **
+ ** Semaphore is single atomic int: low bits count available slots,
+ ** high bits count parked threads. Acquire is compare-and-swap,
+ ** release is fetch-add, system call (futex wake) is done only when
+ ** some thread is parked. Threads park on the semaphore word via
+ ** CMX_ATOMIC_INT_WAIT, so release cannot be missed: every release
+ ** changes the word.
+ **
+ ** Macros require environment with CMX_ATOMIC_INT_ and
+ ** CMX_ATOMIC_INT_WAIT / CMX_ATOMIC_INT_WAKE_ONE defined.
+ **
+ ** @section Proposed usage
+ **
+ **     static CMX_SEMAPHORE_DEFINE decompress = CMX_SEMAPHORE_INITIALIZER (4);
+ **
+ **     CMX_LIMIT (&decompress) {
+ **         inflate (...);
+ **     }
+ **
+ **     CMX_LIMIT_TRY (&decompress) {
+ **         inflate (...);
+ **     } else {
+ **         return EBUSY;
+ **     }
+ **/
+
+#ifndef CMX_LIMIT_H
+#define CMX_LIMIT_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-meta.h>
+#include <cmx/cmx-env.h>
+
+#ifndef CMX_LIMIT_SPIN
+#define CMX_LIMIT_SPIN                                                  \
+    64
+/**<Number of checks of waiting thread before it parks
+ **/
+#endif
+
+#define CMX_SEMAPHORE_MAX                                               \
+    0xFFFF
+/**<Max number of slots of semaphore
+ **/
+
+#define CMX_SEMAPHORE_WAITER                                            \
+    (CMX_SEMAPHORE_MAX + 1)
+/**<Implementation macro: one parked thread in semaphore word
+ **/
+
+struct CMX_Semaphore {
+    CMX_ATOMIC_INT_TYPE state;
+};
+
+#define CMX_SEMAPHORE_DEFINE                                            \
+    struct CMX_Semaphore
+/**<Counting semaphore type specifier
+ **/
+
+#define CMX_SEMAPHORE_INITIALIZER(Slots)                                \
+    { (Slots) }
+/**<Static initializer of semaphore with Slots slots
+ **
+ ** @param Slots 1 .. CMX_SEMAPHORE_MAX
+ **/
+
+#define CMX_SEMAPHORE_INIT(Semaphore, Slots)                            \
+    CMX_ATOMIC_INT_STORE ((Semaphore)->state, (Slots))
+/**<Initialize semaphore with Slots slots
+ **/
+
+#define CMX_SEMAPHORE_AVAILABLE(Semaphore)                              \
+    (CMX_ATOMIC_INT_LOAD ((Semaphore)->state) & CMX_SEMAPHORE_MAX)
+/**<Number of available slots (informative only)
+ **/
+
+#define CMX_SEMAPHORE_ACQUIRE(Semaphore)                                \
+    ((void) cmx_semaphore_acquire ((Semaphore), 1))
+/**<Acquire slot, wait until one is available
+ **/
+
+#define CMX_SEMAPHORE_TRY_ACQUIRE(Semaphore)                            \
+    cmx_semaphore_acquire ((Semaphore), 0)
+/**<Acquire slot if one is available
+ **
+ ** Evaluates TRUE if slot was acquired.
+ **/
+
+#define CMX_SEMAPHORE_RELEASE(Semaphore)                                \
+    cmx_semaphore_release (Semaphore)
+/**<Release acquired slot
+ **/
+
+#define CMX_LIMIT(Semaphore)                                            \
+    CMX_LIMIT_TRAN (                                                    \
+        CMX_UNIQUE_TOKEN (CMX_LIMIT),                                   \
+        Semaphore                                                       \
+    )
+/**<Evaluate following statement / block holding semaphore slot
+ **
+ ** Waits until slot is available. Slot is released when block finishes
+ ** or break is evaluated.
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** @param Semaphore pointer to CMX_SEMAPHORE_DEFINE variable
+ **
+ ** Usage:
+ **   CMX_LIMIT (&semaphore) { ... }
+ **/
+
+#define CMX_LIMIT_TRAN(Prefix, Semaphore)                               \
+    CMX_LIMIT_IMPL (                                                    \
+        CMX_TOKEN (Prefix, Slot),                                       \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Finish),                                     \
+        Semaphore                                                       \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_LIMIT_IMPL(Name, Body, Finish, Semaphore)                   \
+    if (1) {                                                            \
+        struct CMX_Semaphore *Name = (Semaphore);                       \
+        CMX_SEMAPHORE_ACQUIRE (Name);                                   \
+        goto Body;                                                      \
+    Finish:                                                             \
+        CMX_SEMAPHORE_RELEASE (Name);                                   \
+    } else CMX_META_BODY_BREAK (Body, Finish)
+/**<Implementation macro
+ **/
+
+#define CMX_LIMIT_TRY(Semaphore)                                        \
+    CMX_LIMIT_TRY_TRAN (                                                \
+        CMX_UNIQUE_TOKEN (CMX_LIMIT_TRY),                               \
+        Semaphore                                                       \
+    )
+/**<Evaluate following statement / block if semaphore slot is available
+ **
+ ** Optional else-clause is evaluated (without slot) when all slots
+ ** are taken. Slot is released when block finishes or break is
+ ** evaluated.
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** @param Semaphore pointer to CMX_SEMAPHORE_DEFINE variable
+ **
+ ** Usage:
+ **   CMX_LIMIT_TRY (&semaphore) { ... }
+ **   CMX_LIMIT_TRY (&semaphore) { ... } else { ... }
+ **/
+
+#define CMX_LIMIT_TRY_TRAN(Prefix, Semaphore)                           \
+    CMX_LIMIT_TRY_IMPL (                                                \
+        CMX_TOKEN (Prefix, Slot),                                       \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Else),                                       \
+        CMX_TOKEN (Prefix, Finish),                                     \
+        Semaphore                                                       \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_LIMIT_TRY_IMPL(Name, Body, Else, Finish, Semaphore)         \
+    if (1) {                                                            \
+        struct CMX_Semaphore *Name = (Semaphore);                       \
+        if (CMX_SEMAPHORE_TRY_ACQUIRE (Name))                           \
+            goto Body;                                                  \
+        Name = NULL;                                                    \
+        goto Else;                                                      \
+    Finish:                                                             \
+        if (NULL != Name)                                               \
+            CMX_SEMAPHORE_RELEASE (Name);                               \
+    } else CMX_META_BODY_ELSE_BREAK (Body, Else, Finish)
+/**<Implementation macro
+ **
+ ** Both block and else-clause return to Finish, Name (NULL) remembers
+ ** that slot was not acquired.
+ **/
+
+static CMX_COLD int
+cmx_semaphore_acquire_slow (struct CMX_Semaphore *semaphore, int block) {
+    int state = CMX_ATOMIC_INT_LOAD (semaphore->state);
+    int waiter = 0;
+    int spin = 0;
+
+    for (;;) {
+        if (state & CMX_SEMAPHORE_MAX) {
+            if (CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK (semaphore->state, state, state - 1 - waiter))
+                return 1;
+            continue;
+        }
+
+        if (! block)
+            return 0;
+
+        if (spin < CMX_LIMIT_SPIN) {
+            ++spin;
+            state = CMX_ATOMIC_INT_LOAD (semaphore->state);
+            continue;
+        }
+
+        if (! waiter) {
+            if (! CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK (semaphore->state, state, state + CMX_SEMAPHORE_WAITER))
+                continue;
+            state += CMX_SEMAPHORE_WAITER;
+            waiter = CMX_SEMAPHORE_WAITER;
+        }
+
+        CMX_ATOMIC_INT_WAIT (semaphore->state, state);
+        state = CMX_ATOMIC_INT_LOAD (semaphore->state);
+    }
+}
+/**<Implementation function
+ **
+ ** Parked thread stays counted as waiter until it acquires slot,
+ ** it is unregistered by the same compare-and-swap.
+ **/
+
+static inline int
+cmx_semaphore_acquire (struct CMX_Semaphore *semaphore, int block) {
+    int state = CMX_ATOMIC_INT_LOAD (semaphore->state);
+
+    if (CMX_LIKELY (state & CMX_SEMAPHORE_MAX)
+        && CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK (semaphore->state, state, state - 1))
+        return 1;
+
+    return cmx_semaphore_acquire_slow (semaphore, block);
+}
+/**<Implementation function
+ **
+ ** Inlined fast path takes free slot by single compare-and-swap,
+ ** exhausted semaphore (spin, park) is handled out of line.
+ **/
+
+static CMX_COLD void
+cmx_semaphore_wake (struct CMX_Semaphore *semaphore) {
+    (void) semaphore;
+    CMX_ATOMIC_INT_WAKE_ONE (semaphore->state);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_semaphore_release (struct CMX_Semaphore *semaphore) {
+    if (CMX_UNLIKELY (CMX_ATOMIC_INT_FETCH_ADD (semaphore->state, 1) >= CMX_SEMAPHORE_WAITER))
+        cmx_semaphore_wake (semaphore);
+}
+/**<Implementation function
+ **/
+
+#endif  /* header guard */
@@ -36,7 +36,7 @@
     CMX_META_BODY_BREAK (Body, Finish)
 
 #define CMX_META_TEMPLATE_BODY_ELSE(Prefix, Body, Else, Finish)         \
-    CMX_META_BODY_ELSE_BREAK (Body, Finish)
+    CMX_META_BODY_ELSE_BREAK (Body, Else, Finish)
 
 #define CMX_META_TEMPLATE_DO(Prefix, Body, Else, Finish)                \
     CMX_META_DO_BREAK (Body)
@@ -0,0 +1,221 @@
+
+#ifndef CMX_QUEUE_MPSC_H
+#define CMX_QUEUE_MPSC_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-struct-refs.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Intrusive lock-free multi-producer single-consumer queue.
+ **
+ ** @section Idea behind
+ **
+ ** Queue links are embedded in queued structs so neither push nor pop
+ ** allocates. Push is a single atomic exchange (wait-free), pop is
+ ** evaluated only by one (consumer) thread.
+ **
+ ** Algorithm by Dmitry Vyukov
+ ** (http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue)
+ **
+ ** Pop may report empty queue while some producer is in the middle
+ ** of push. Consumer will see such item with next pop.
+ **
+ ** Macros require environment with CMX_ATOMIC_PTR_ defined
+ **
+ ** @section Proposed usage
+ **
+ **     struct Msg {
+ **         CMX_STRUCT_REFS_DEFINE;
+ **         CMX_QUEUE_MPSC_NODE_DEFINE (link);
+ **         ...
+ **     };
+ **
+ **     CMX_QUEUE_MPSC_DEFINE (struct Msg, link) inbox;
+ **
+ **     CMX_QUEUE_MPSC_INIT (&inbox);
+ **
+ **     producer:
+ **         CMX_QUEUE_MPSC_PUSH (&inbox, msg);
+ **
+ **     consumer:
+ **         while (NULL != (msg = CMX_QUEUE_MPSC_POP (&inbox))) {
+ **             ...
+ **             msg_unref (msg);
+ **         }
+ **/
+
+struct _CMX_Queue_Mpsc_Node {
+    CMX_ATOMIC_PTR_TYPE (struct _CMX_Queue_Mpsc_Node) next;
+};
+
+struct _CMX_Queue_Mpsc {
+    CMX_ATOMIC_PTR_TYPE (struct _CMX_Queue_Mpsc_Node) head;
+    struct _CMX_Queue_Mpsc_Node * tail;
+    struct _CMX_Queue_Mpsc_Node stub;
+};
+
+#define CMX_QUEUE_MPSC_NODE_DEFINE(Member)                              \
+    struct _CMX_Queue_Mpsc_Node Member
+/**<Structure member definition (queue link)
+ **
+ ** Struct can be member of multiple queues using different
+ ** member names.
+ **
+ ** Usage:
+ ** struct {
+ **   CMX_QUEUE_MPSC_NODE_DEFINE (link);
+ **   ...
+ ** };
+ **/
+
+#define CMX_QUEUE_MPSC_DEFINE(Type, Member)                             \
+    struct {                                                            \
+        struct _CMX_Queue_Mpsc queue;                                   \
+        Type * (* type)[offsetof (Type, Member) + 1];                   \
+    }
+/**<Queue type specifier
+ **
+ ** @param Type   type of queued items
+ ** @param Member name of Type member defined by CMX_QUEUE_MPSC_NODE_DEFINE
+ **
+ ** Member 'type' is never dereferenced, it only keeps item type
+ ** and link offset for sizeof () used by other CMX_QUEUE_MPSC_ macros.
+ **
+ ** Usage:
+ **   CMX_QUEUE_MPSC_DEFINE (struct Msg, link) queue;
+ **   typedef CMX_QUEUE_MPSC_DEFINE (struct Msg, link) Msg_Queue;
+ **/
+
+#define CMX_QUEUE_MPSC_OFFSET(Queue)                                    \
+    (sizeof (* (Queue)->type) / sizeof (** (Queue)->type) - 1)
+/**<Offset of queue link in queued item
+ **/
+
+#define CMX_QUEUE_MPSC_INIT(Queue)                                      \
+    cmx_queue_mpsc_init (& (Queue)->queue)
+/**<Initialize queue
+ **
+ ** Queue cannot be initialized statically (it points to itself).
+ **
+ ** @param Queue pointer to CMX_QUEUE_MPSC_DEFINE variable
+ **/
+
+#define CMX_QUEUE_MPSC_PUSH(Queue, Ptr)                                 \
+    ((void) sizeof ((Ptr) == ** (Queue)->type),                         \
+     cmx_queue_mpsc_push (                                              \
+         & (Queue)->queue,                                              \
+         (struct _CMX_Queue_Mpsc_Node *)                                \
+             ((char *) (Ptr) + CMX_QUEUE_MPSC_OFFSET (Queue))           \
+    ))
+/**<Append item into queue
+ **
+ ** Can be called by any thread, never blocks.
+ ** Ownership of Ptr is passed to queue (queue doesn't change
+ ** reference count)
+ **
+ ** @param Queue pointer to CMX_QUEUE_MPSC_DEFINE variable
+ ** @param Ptr   non-NULL item pointer
+ **/
+
+#define CMX_QUEUE_MPSC_PUSH_REF(Queue, Ptr)                             \
+    (CMX_STRUCT_REFS_INCREMENT (Ptr),                                   \
+     CMX_QUEUE_MPSC_PUSH ((Queue), (Ptr)))
+/**<Append item into queue, queue takes its own reference
+ **
+ ** Item must be CMX_STRUCT_REFS struct.
+ ** Caller keeps its reference, reference taken by queue is handed
+ ** over to consumer by CMX_QUEUE_MPSC_POP.
+ **
+ ** Uses
+ ** - CMX_STRUCT_REFS_INCREMENT
+ **/
+
+#define CMX_QUEUE_MPSC_POP(Queue)                                       \
+    cmx_queue_mpsc_pop_item (                                           \
+        & (Queue)->queue,                                               \
+        CMX_QUEUE_MPSC_OFFSET (Queue)                                   \
+    )
+/**<Remove first item from queue
+ **
+ ** Must be called only by one (consumer) thread at a time.
+ ** Returns NULL if queue is empty. Ownership of returned item
+ ** (reference if pushed by CMX_QUEUE_MPSC_PUSH_REF) is passed to caller.
+ **
+ ** @param Queue pointer to CMX_QUEUE_MPSC_DEFINE variable
+ **/
+
+static inline void
+cmx_queue_mpsc_init (struct _CMX_Queue_Mpsc *queue) {
+    CMX_ATOMIC_PTR_STORE (queue->stub.next, NULL);
+    queue->tail = &queue->stub;
+    CMX_ATOMIC_PTR_STORE (queue->head, &queue->stub);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_queue_mpsc_push (struct _CMX_Queue_Mpsc *queue, struct _CMX_Queue_Mpsc_Node *node) {
+    struct _CMX_Queue_Mpsc_Node *prev;
+
+    CMX_ATOMIC_PTR_STORE (node->next, NULL);
+    prev = CMX_ATOMIC_PTR_EXCHANGE (queue->head, node);
+    CMX_ATOMIC_PTR_STORE (prev->next, node);
+}
+/**<Implementation function
+ **
+ ** Between exchange and store queue is disconnected, consumer
+ ** sees queue ending with prev.
+ **/
+
+static inline struct _CMX_Queue_Mpsc_Node *
+cmx_queue_mpsc_pop (struct _CMX_Queue_Mpsc *queue) {
+    struct _CMX_Queue_Mpsc_Node *tail = queue->tail;
+    struct _CMX_Queue_Mpsc_Node *next = CMX_ATOMIC_PTR_LOAD (tail->next);
+
+    if (tail == &queue->stub) {
+        if (NULL == next)
+            return NULL;
+
+        queue->tail = tail = next;
+        next = CMX_ATOMIC_PTR_LOAD (next->next);
+    }
+
+    if (NULL != next) {
+        queue->tail = next;
+        return tail;
+    }
+
+    if (tail != CMX_ATOMIC_PTR_LOAD (queue->head))
+        return NULL;
+
+    cmx_queue_mpsc_push (queue, &queue->stub);
+
+    next = CMX_ATOMIC_PTR_LOAD (tail->next);
+    if (NULL != next) {
+        queue->tail = next;
+        return tail;
+    }
+
+    return NULL;
+}
+/**<Implementation function
+ **
+ ** Stub node is re-queued when last item is removed so the last item
+ ** can be returned without racing with producers.
+ **/
+
+static inline void *
+cmx_queue_mpsc_pop_item (struct _CMX_Queue_Mpsc *queue, size_t offset) {
+    struct _CMX_Queue_Mpsc_Node *node = cmx_queue_mpsc_pop (queue);
+
+    return NULL == node ? NULL : (char *) node - offset;
+}
+/**<Implementation function
+ **/
+
+#endif  /* guard */
@@ -0,0 +1,262 @@
+#ifndef CMX_REAPER_H
+#define CMX_REAPER_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-struct-refs.h>
+#include <cmx/cmx-queue-mpsc.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Asynchronous destruction of ref counted structs.
+ **
+ ** @section Idea behind
+ **
+ ** Destroying large object graph when last reference is dropped may
+ ** take long time. CMX_STRUCT_REFS_UNREF_ASYNC pushes such object into
+ ** lock-free queue (CMX_QUEUE_MPSC) instead, background reaper thread
+ ** destroys queued objects in batches.
+ **
+ ** Backpressure: when reaper has Limit objects pending, unref destroys
+ ** object inline (like CMX_STRUCT_REFS_UNREF), so slow reaper bounds
+ ** memory instead of blocking callers.
+ **
+ ** Objects must not be pushed before reaper is started or after it
+ ** was stopped. CMX_REAPER_FLUSH and CMX_REAPER_STOP must not be
+ ** called by reaper itself (from Destroy function).
+ **
+ ** Macros require environment with CMX_ATOMIC_, CMX_THREAD_ defined,
+ ** module is not included by cmx.h.
+ **
+ ** @section Proposed usage
+ **
+ **     struct Graph {
+ **         CMX_STRUCT_REFS_DEFINE;
+ **         CMX_REAPER_NODE_DEFINE;
+ **         ...
+ **     };
+ **
+ **     struct CMX_Reaper reaper;
+ **
+ **     CMX_REAPER_START (&reaper, 1024);
+ **
+ **     void graph_destroy (void *ptr) { ... }
+ **
+ **     void graph_unref (struct Graph *self) {
+ **         CMX_STRUCT_REFS_UNREF_ASYNC (self, &reaper, graph_destroy);
+ **     }
+ **
+ **     CMX_REAPER_STOP (&reaper);
+ **/
+
+#ifndef CMX_REAPER_NAME
+#define CMX_REAPER_NAME                                                 \
+    cmx_reaper
+/**<Structure member name
+ **/
+#endif
+
+#ifndef CMX_REAPER_BATCH
+#define CMX_REAPER_BATCH                                                \
+    64
+/**<Number of objects destroyed before pending counter is updated
+ **/
+#endif
+
+struct _CMX_Reaper_Node {
+    struct _CMX_Queue_Mpsc_Node link;
+    void (* destroy) (void *);
+    void *ptr;
+};
+
+struct CMX_Reaper {
+    struct _CMX_Queue_Mpsc queue;
+    CMX_ATOMIC_INT_TYPE pending;
+    CMX_ATOMIC_INT_TYPE overflows;
+    int limit;
+    struct _CMX_Reaper_Node stop;
+    CMX_THREAD_TYPE thread;
+};
+
+#define CMX_REAPER_NODE_DEFINE                                          \
+    struct _CMX_Reaper_Node CMX_REAPER_NAME
+/**<Structure member definition
+ **
+ ** Usage:
+ ** struct {
+ **   CMX_STRUCT_REFS_DEFINE;
+ **   CMX_REAPER_NODE_DEFINE;
+ **   ...
+ ** };
+ **/
+
+#define CMX_REAPER_START(Reaper, Limit)                                 \
+    cmx_reaper_start ((Reaper), (Limit))
+/**<Initialize reaper and start its thread
+ **
+ ** Evaluates 0 on success.
+ **
+ ** @param Reaper pointer to struct CMX_Reaper
+ ** @param Limit  max number of pending objects (backpressure)
+ **/
+
+#define CMX_REAPER_FLUSH(Reaper)                                        \
+    cmx_reaper_flush (Reaper)
+/**<Wait until all pushed objects are destroyed
+ **
+ ** Objects pushed meanwhile are waited for as well.
+ **/
+
+#define CMX_REAPER_STOP(Reaper)                                         \
+    cmx_reaper_stop (Reaper)
+/**<Destroy pending objects and stop reaper thread
+ **/
+
+#define CMX_REAPER_OVERFLOWS(Reaper)                                    \
+    CMX_ATOMIC_INT_LOAD ((Reaper)->overflows)
+/**<Number of objects destroyed inline due to backpressure
+ **/
+
+#define CMX_STRUCT_REFS_UNREF_ASYNC(Ptr, Reaper, Destroy)               \
+    CMX_STRUCT_REFS_UNREF (Ptr)                                         \
+        cmx_reaper_push (                                               \
+            (Reaper),                                                   \
+            & (Ptr)->CMX_REAPER_NAME,                                   \
+            (Destroy),                                                  \
+            (Ptr)                                                       \
+        )
+/**<Define unref function body destroying object asynchronously
+ **
+ ** When ref count drops to zero object is handed to reaper which
+ ** evaluates Destroy (Ptr) in its thread (or inline, see backpressure).
+ ** Optional else statement is evaluated if object is still alive.
+ **
+ ** @param Ptr     pointer to struct with CMX_STRUCT_REFS_DEFINE and
+ **                CMX_REAPER_NODE_DEFINE members
+ **                (evaluated multiple times)
+ ** @param Reaper  pointer to started struct CMX_Reaper
+ ** @param Destroy function void Destroy (void *)
+ **
+ ** Uses:
+ ** - CMX_STRUCT_REFS_UNREF
+ ** - CMX_REAPER_NAME
+ **
+ ** Usage:
+ **   void xyz_unref (struct XYZ *self) {
+ **     CMX_STRUCT_REFS_UNREF_ASYNC (self, &reaper, xyz_destroy);
+ **   }
+ **/
+
+static inline void
+cmx_reaper_push (
+    struct CMX_Reaper *reaper,
+    struct _CMX_Reaper_Node *node,
+    void (* destroy) (void *),
+    void *ptr
+) {
+    int previous = CMX_ATOMIC_INT_FETCH_ADD (reaper->pending, 1);
+
+    if (previous >= reaper->limit) {
+        CMX_ATOMIC_INT_FETCH_ADD (reaper->overflows, 1);
+        if (1 == CMX_ATOMIC_INT_FETCH_SUB (reaper->pending, 1))
+            CMX_ATOMIC_INT_WAKE_ALL (reaper->pending);
+        destroy (ptr);
+        return;
+    }
+
+    node->destroy = destroy;
+    node->ptr = ptr;
+    cmx_queue_mpsc_push (&reaper->queue, &node->link);
+
+    if (0 == previous)
+        CMX_ATOMIC_INT_WAKE_ALL (reaper->pending);
+}
+/**<Implementation function
+ **
+ ** Pending counter is futex word of both reaper (waiting while it is 0)
+ ** and flush (waiting until it is 0), only transitions from / to 0 wake.
+ ** Pending counter is incremented before push, reaper seeing pending
+ ** object not yet visible in queue yields.
+ **/
+
+static inline void *
+cmx_reaper_run (void *arg) {
+    struct CMX_Reaper *reaper = arg;
+    struct _CMX_Reaper_Node *node;
+    int stop = 0;
+    int batch;
+
+    while (! stop) {
+        batch = 0;
+        while (batch < CMX_REAPER_BATCH
+            && NULL != (node = cmx_queue_mpsc_pop_item (&reaper->queue, 0))) {
+            ++batch;
+            if (NULL == node->destroy) {
+                stop = 1;
+                break;
+            }
+            node->destroy (node->ptr);
+        }
+
+        if (batch > 0) {
+            if (batch == CMX_ATOMIC_INT_FETCH_SUB (reaper->pending, batch))
+                CMX_ATOMIC_INT_WAKE_ALL (reaper->pending);
+        } else if (0 == CMX_ATOMIC_INT_LOAD (reaper->pending)) {
+            CMX_ATOMIC_INT_WAIT (reaper->pending, 0);
+        } else {
+            CMX_THREAD_YIELD ();
+        }
+    }
+
+    return NULL;
+}
+/**<Implementation function (reaper thread)
+ **
+ ** Stop request is queued node with NULL destroy, so objects pushed
+ ** before stop are destroyed first.
+ **/
+
+static inline int
+cmx_reaper_start (struct CMX_Reaper *reaper, int limit) {
+    cmx_queue_mpsc_init (&reaper->queue);
+    CMX_ATOMIC_INT_STORE (reaper->pending, 0);
+    CMX_ATOMIC_INT_STORE (reaper->overflows, 0);
+    reaper->limit = limit;
+
+    return CMX_THREAD_CREATE (reaper->thread, cmx_reaper_run, reaper);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_reaper_flush (struct CMX_Reaper *reaper) {
+    int value;
+
+    while (0 != (value = CMX_ATOMIC_INT_LOAD (reaper->pending)))
+        CMX_ATOMIC_INT_WAIT (reaper->pending, value);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_reaper_stop (struct CMX_Reaper *reaper) {
+    int previous = CMX_ATOMIC_INT_FETCH_ADD (reaper->pending, 1);
+
+    reaper->stop.destroy = NULL;
+    reaper->stop.ptr = NULL;
+    cmx_queue_mpsc_push (&reaper->queue, &reaper->stop.link);
+
+    if (0 == previous)
+        CMX_ATOMIC_INT_WAKE_ALL (reaper->pending);
+
+    CMX_THREAD_JOIN (reaper->thread);
+}
+/**<Implementation function
+ **
+ ** Stop node bypasses backpressure limit.
+ **/
+
+#endif  /* guard */
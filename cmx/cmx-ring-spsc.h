@@ -0,0 +1,212 @@
+
+#ifndef CMX_RING_SPSC_H
+#define CMX_RING_SPSC_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-env.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Bounded single-producer single-consumer ring buffer.
+ **
+ ** @section Idea behind
+ **
+ ** Producer and consumer indices live on separate cache lines, each side
+ ** keeps cached copy of other side's index and reloads it only when
+ ** cached value says ring is full (empty).
+ **
+ ** Producer can reserve N slots, fill them and publish them all
+ ** with one release store (commit). Consumer can peek N items and
+ ** return their slots with one release store (release).
+ **
+ ** Indices are free running counters, capacity must be power of two.
+ **
+ ** Macros evaluate Ring argument multiple times.
+ ** Macros require environment with CMX_ATOMIC_SIZE_ defined
+ **
+ ** @section Proposed usage
+ **
+ **     CMX_RING_SPSC_DEFINE (struct Item, 1024) ring;
+ **
+ **     producer:
+ **         n = CMX_RING_SPSC_RESERVE (&ring, 16);
+ **         for (i = 0; i < n; ++i)
+ **             CMX_RING_SPSC_SLOT (&ring, i) = ...;
+ **         CMX_RING_SPSC_COMMIT (&ring, n);
+ **
+ **     consumer:
+ **         n = CMX_RING_SPSC_PEEK (&ring, 16);
+ **         for (i = 0; i < n; ++i)
+ **             process (&CMX_RING_SPSC_ITEM (&ring, i));
+ **         CMX_RING_SPSC_RELEASE (&ring, n);
+ **/
+
+struct _CMX_Ring_Spsc_Index {
+    CMX_ATOMIC_SIZE_TYPE index;
+    size_t cache;
+};
+/**<Index owned by one side and cached copy of other side's index
+ **/
+
+struct _CMX_Ring_Spsc {
+    union {
+        struct _CMX_Ring_Spsc_Index tail;
+        char padding[CMX_CACHE_LINE_SIZE];
+    } producer;
+    union {
+        struct _CMX_Ring_Spsc_Index head;
+        char padding[CMX_CACHE_LINE_SIZE];
+    } consumer;
+};
+
+#define CMX_RING_SPSC_DEFINE(Type, Capacity)                            \
+    struct {                                                            \
+        struct _CMX_Ring_Spsc ring;                                     \
+        Type items[(Capacity) + 0 * sizeof (                            \
+            char [((Capacity) & ((Capacity) - 1)) ? -1 : 1]             \
+        )];                                                             \
+    }
+/**<Ring type specifier
+ **
+ ** @param Type     type of items
+ ** @param Capacity number of items, must be power of two
+ **                 (checked at compile time)
+ **
+ ** Usage:
+ **   CMX_RING_SPSC_DEFINE (struct Item, 1024) ring;
+ **   typedef CMX_RING_SPSC_DEFINE (int, 256) Int_Ring;
+ **/
+
+#define CMX_RING_SPSC_INIT(Ring)                                        \
+    do {                                                                \
+        (Ring)->ring.producer.tail.cache = 0;                           \
+        (Ring)->ring.consumer.head.cache = 0;                           \
+        CMX_ATOMIC_SIZE_STORE ((Ring)->ring.producer.tail.index, 0);    \
+        CMX_ATOMIC_SIZE_STORE ((Ring)->ring.consumer.head.index, 0);    \
+    } while (0)
+/**<Initialize ring
+ **
+ ** Static initialization with zeros is valid as well.
+ **/
+
+#define CMX_RING_SPSC_CAPACITY(Ring)                                    \
+    (sizeof ((Ring)->items) / sizeof (* (Ring)->items))
+/**<Number of items ring can hold
+ **/
+
+#define CMX_RING_SPSC_MASK(Ring)                                        \
+    (CMX_RING_SPSC_CAPACITY (Ring) - 1)
+/**<Mask converting free running index into items index
+ **/
+
+#define CMX_RING_SPSC_RESERVE(Ring, Count)                              \
+    cmx_ring_spsc_reserve (                                             \
+        & (Ring)->ring,                                                 \
+        CMX_RING_SPSC_CAPACITY (Ring),                                  \
+        (Count)                                                         \
+    )
+/**<Producer: return number of free slots, at most Count
+ **
+ ** Reserved slots are accessible using CMX_RING_SPSC_SLOT with index
+ ** from 0 to returned value - 1. They are not visible to consumer until
+ ** CMX_RING_SPSC_COMMIT.
+ **/
+
+#define CMX_RING_SPSC_SLOT(Ring, Index)                                 \
+    ((Ring)->items[                                                     \
+        ((Ring)->ring.producer.tail.index + (Index))                    \
+        & CMX_RING_SPSC_MASK (Ring)                                     \
+    ])
+/**<Producer: reserved slot (lvalue)
+ **/
+
+#define CMX_RING_SPSC_COMMIT(Ring, Count)                               \
+    CMX_ATOMIC_SIZE_STORE (                                             \
+        (Ring)->ring.producer.tail.index,                               \
+        (Ring)->ring.producer.tail.index + (Count)                      \
+    )
+/**<Producer: publish Count reserved slots to consumer
+ **
+ ** Uses single release store regardless of Count.
+ **/
+
+#define CMX_RING_SPSC_PEEK(Ring, Count)                                 \
+    cmx_ring_spsc_peek (& (Ring)->ring, (Count))
+/**<Consumer: return number of available items, at most Count
+ **
+ ** Items are accessible using CMX_RING_SPSC_ITEM with index from 0
+ ** to returned value - 1. They stay in ring until CMX_RING_SPSC_RELEASE.
+ **/
+
+#define CMX_RING_SPSC_ITEM(Ring, Index)                                 \
+    ((Ring)->items[                                                     \
+        ((Ring)->ring.consumer.head.index + (Index))                    \
+        & CMX_RING_SPSC_MASK (Ring)                                     \
+    ])
+/**<Consumer: available item (lvalue)
+ **/
+
+#define CMX_RING_SPSC_RELEASE(Ring, Count)                              \
+    CMX_ATOMIC_SIZE_STORE (                                             \
+        (Ring)->ring.consumer.head.index,                               \
+        (Ring)->ring.consumer.head.index + (Count)                      \
+    )
+/**<Consumer: return Count slots to producer
+ **/
+
+#define CMX_RING_SPSC_PUSH(Ring, Value)                                 \
+    (CMX_RING_SPSC_RESERVE ((Ring), 1)                                  \
+        ? (CMX_RING_SPSC_SLOT ((Ring), 0) = (Value),                    \
+           CMX_RING_SPSC_COMMIT ((Ring), 1),                            \
+           1)                                                           \
+        : 0)
+/**<Producer: store single item, return 0 if ring is full
+ **/
+
+#define CMX_RING_SPSC_POP(Ring, Var)                                    \
+    (CMX_RING_SPSC_PEEK ((Ring), 1)                                     \
+        ? ((Var) = CMX_RING_SPSC_ITEM ((Ring), 0),                      \
+           CMX_RING_SPSC_RELEASE ((Ring), 1),                           \
+           1)                                                           \
+        : 0)
+/**<Consumer: fetch single item into Var, return 0 if ring is empty
+ **/
+
+static inline size_t
+cmx_ring_spsc_reserve (struct _CMX_Ring_Spsc *ring, size_t capacity, size_t count) {
+    size_t tail = ring->producer.tail.index;
+    size_t avail = capacity - (tail - ring->producer.tail.cache);
+
+    if (avail < count) {
+        ring->producer.tail.cache = CMX_ATOMIC_SIZE_LOAD (ring->consumer.head.index);
+        avail = capacity - (tail - ring->producer.tail.cache);
+    }
+
+    return avail < count ? avail : count;
+}
+/**<Implementation function
+ **
+ ** Producer's cache holds last seen consumer index.
+ **/
+
+static inline size_t
+cmx_ring_spsc_peek (struct _CMX_Ring_Spsc *ring, size_t count) {
+    size_t head = ring->consumer.head.index;
+    size_t avail = ring->consumer.head.cache - head;
+
+    if (avail < count) {
+        ring->consumer.head.cache = CMX_ATOMIC_SIZE_LOAD (ring->producer.tail.index);
+        avail = ring->consumer.head.cache - head;
+    }
+
+    return avail < count ? avail : count;
+}
+/**<Implementation function
+ **
+ ** Consumer's cache holds last seen producer index.
+ **/
+
+#endif  /* guard */
@@ -0,0 +1,611 @@
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Per-CPU counters and free lists.
+ **
+ ** @section Idea behind
+ **
+ ** Per-thread sharding (see cmx-struct-stats.h) needs memory per thread,
+ ** with thousands of threads it is wasted. Number of CPUs is fixed
+ ** and at most one thread runs on CPU at a time, so per-CPU slot is
+ ** almost never touched by two threads together: its cache line stays
+ ** in CPU's cache and atomic operations on it are uncontended.
+ **
+ ** Slot is selected by CMX_CPU_CURRENT (). Linux env reads CPU number
+ ** from rseq(2) area registered by glibc (plain memory read) and falls
+ ** back to getcpu(2) when rseq registration failed.
+ **
+ ** Slots are updated by rseq(2) critical sections when available
+ ** (glibc registered rseq area, x86-64 or aarch64, all CPU numbers fit
+ ** into CMX_PERCPU_SLOTS). Critical section verifies it still runs
+ ** on the CPU owning the slot and commits update by single store,
+ ** kernel restarts it when thread is preempted, migrated or signaled
+ ** meanwhile. No atomic instruction is used then, every slot is
+ ** modified only by its own CPU.
+ **
+ ** Otherwise thread may be preempted or migrated between reading CPU
+ ** number and updating the slot, slots are updated by atomic operations
+ ** and such race costs only cache line transfer. Mode is selected once,
+ ** process-wide, plain stores would lose concurrent atomic updates of
+ ** the same slot. (Glibc registers rseq for every thread, thread whose
+ ** registration failed anyway uses atomic operations.) ThreadSanitizer
+ ** cannot see critical sections, atomic operations are used with it.
+ **
+ ** Slots are indexed by CPU number modulo CMX_PERCPU_SLOTS, CPUs
+ ** sharing slot are still correct.
+ **
+ ** Free list is stack of memory blocks per slot, block's first
+ ** pointer-sized bytes are used as link. With rseq critical sections
+ ** pop cannot be interleaved with other operation on the same slot
+ ** (no ABA problem). Otherwise push is lock-free, pops of the same slot
+ ** are serialized by slot flag, thread finding it taken yields.
+ **
+ ** Macros require environment with CMX_ATOMIC_INT64_, CMX_ATOMIC_PTR_
+ ** and CMX_ATOMIC_INT_ defined, CMX_CPU_CURRENT and CMX_THREAD_YIELD
+ ** are recommended.
+ **
+ ** @section Proposed usage
+ **
+ **     static struct CMX_Percpu_Counter requests;
+ **     static struct CMX_Percpu_List buffers;
+ **
+ **     CMX_PERCPU_ADD (&requests, 1);
+ **     total = CMX_PERCPU_SUM (&requests);
+ **
+ **     buffer = CMX_PERCPU_LIST_POP (&buffers);
+ **     if (NULL == buffer)
+ **         buffer = malloc (BUFFER_SIZE);
+ **     ...
+ **     CMX_PERCPU_LIST_PUSH (&buffers, buffer);
+ **/
+
+#ifndef CMX_RSEQ_H
+#define CMX_RSEQ_H 1
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <cmx/cmx-env.h>
+
+#ifndef CMX_PERCPU_SLOTS
+#define CMX_PERCPU_SLOTS                                                \
+    64
+/**<Number of per-CPU slots, must be power of two
+ **
+ ** You can override default value defining this macro before including cmx.h
+ **/
+#endif
+
+struct _CMX_Percpu_Counter_Slot {
+    CMX_ATOMIC_INT64_TYPE value;
+    char padding[CMX_CACHE_LINE_SIZE];
+};
+
+struct CMX_Percpu_Counter {
+    struct _CMX_Percpu_Counter_Slot slots[CMX_PERCPU_SLOTS];
+};
+/**<Per-CPU counter
+ **
+ ** Zero filled memory (eg. static variable) is initialized counter.
+ **/
+
+struct _CMX_Percpu_List_Slot {
+    CMX_ATOMIC_PTR_TYPE (void) head;
+    CMX_ATOMIC_INT_TYPE popping;
+    char padding[CMX_CACHE_LINE_SIZE];
+};
+
+struct CMX_Percpu_List {
+    struct _CMX_Percpu_List_Slot slots[CMX_PERCPU_SLOTS];
+};
+/**<Per-CPU free list
+ **
+ ** Zero filled memory (eg. static variable) is initialized empty list.
+ **/
+
+#define CMX_PERCPU_SLOT                                                 \
+    (CMX_CPU_CURRENT () & (CMX_PERCPU_SLOTS - 1))
+/**<Index of slot of current CPU
+ **/
+
+#define CMX_PERCPU_COUNTER_INIT(Counter)                                \
+    cmx_percpu_counter_init (Counter)
+/**<Initialize counter to zero
+ **
+ ** @param Counter pointer to struct CMX_Percpu_Counter
+ **/
+
+#define CMX_PERCPU_RESTARTABLE()                                        \
+    cmx_percpu_rseq_init ()
+/**<Evaluates TRUE if slots are updated by rseq critical sections
+ **/
+
+#define CMX_PERCPU_ADD(Counter, Value)                                  \
+    cmx_percpu_add ((Counter), (Value))
+/**<Add Value to current CPU's slot of counter
+ **/
+
+#define CMX_PERCPU_LOAD(Counter)                                        \
+    CMX_ATOMIC_INT64_LOAD ((Counter)->slots[CMX_PERCPU_SLOT].value)
+/**<Evaluates value of current CPU's slot of counter
+ **/
+
+#define CMX_PERCPU_COMPARE_STORE(Counter, Expected, Desired)            \
+    cmx_percpu_compare_store ((Counter), & (Expected), (Desired))
+/**<Store Desired into current CPU's slot if it contains Expected
+ **
+ ** Evaluates TRUE if Desired was stored. Otherwise Expected (int64_t
+ ** variable) is updated with current value of slot, slot is selected
+ ** again by next evaluation (thread may be migrated meanwhile).
+ **
+ ** Usage (per-CPU maximum):
+ **   int64_t value = CMX_PERCPU_LOAD (&max);
+ **   while (value < sample && ! CMX_PERCPU_COMPARE_STORE (&max, value, sample))
+ **       ;
+ **/
+
+#define CMX_PERCPU_SUM(Counter)                                         \
+    cmx_percpu_sum (Counter)
+/**<Evaluates sum of all slots of counter (int64_t)
+ **
+ ** Slots are read one by one, concurrent updates may be included
+ ** or not.
+ **/
+
+#define CMX_PERCPU_LIST_INIT(List)                                      \
+    cmx_percpu_list_init (List)
+/**<Initialize empty list
+ **
+ ** @param List pointer to struct CMX_Percpu_List
+ **/
+
+#define CMX_PERCPU_LIST_PUSH(List, Ptr)                                 \
+    cmx_percpu_list_push ((List), (Ptr))
+/**<Push memory block into current CPU's list
+ **
+ ** @param Ptr block of at least sizeof (void *) bytes, not used
+ **            by caller until popped
+ **/
+
+#define CMX_PERCPU_LIST_POP(List)                                       \
+    cmx_percpu_list_pop (List)
+/**<Pop memory block from current CPU's list
+ **
+ ** Evaluates NULL if current CPU's list is empty (blocks pushed on
+ ** other CPUs are not taken).
+ **/
+
+#define CMX_PERCPU_LIST_CLEAR(List, FreeFn)                             \
+    cmx_percpu_list_clear ((List), (FreeFn))
+/**<Pop all blocks from all slots and release them by FreeFn
+ **
+ ** Other slots are accessed by atomic operations, with rseq critical
+ ** sections list must not be used by other threads meanwhile.
+ **
+ ** @param FreeFn void FreeFn (void *), eg. free
+ **/
+
+#  if defined (CMX_ENV_LINUX_RSEQ) && defined (__GNUC__) && ! defined (__SANITIZE_THREAD__)
+#    if defined (__x86_64__) && RSEQ_SIG == 0x53053053
+#    define CMX_PERCPU_RSEQ 1
+#    elif defined (__aarch64__) && defined (RSEQ_SIG_CODE) && RSEQ_SIG_CODE == 0xd428bc00
+#    define CMX_PERCPU_RSEQ 1
+#    endif
+#  endif
+
+#  if defined (CMX_PERCPU_RSEQ) && defined (__x86_64__)
+
+#define CMX_PERCPU_RSEQ_START                                           \
+    ".pushsection __rseq_cs, \"aw\"\n\t"                                \
+    ".balign 32\n\t"                                                    \
+    "3:\n\t"                                                            \
+    ".long 0, 0\n\t"                                                    \
+    ".quad 1f, 2f - 1f, 4f\n\t"                                         \
+    ".popsection\n\t"                                                   \
+    "leaq 3b(%%rip), %%rax\n\t"                                         \
+    "movq %%rax, 8(%[rseq])\n\t"                                        \
+    "1:\n\t"                                                            \
+    "cmpl %[cpu], 4(%[rseq])\n\t"                                       \
+    "jnz 4f\n\t"
+/**<Implementation macro
+ **
+ ** Publishes struct rseq_cs (version, flags, start, length, abort)
+ ** in rseq area and verifies that thread runs on slot's CPU.
+ **/
+
+#define CMX_PERCPU_RSEQ_COMMIT                                          \
+    "2:\n\t"                                                            \
+    ".pushsection __rseq_failure, \"ax\"\n\t"                           \
+    ".byte 0x0f, 0xb9, 0x3d\n\t"                                        \
+    ".long 0x53053053\n\t"                                              \
+    "4:\n\t"                                                            \
+    "jmp %l[restart]\n\t"                                               \
+    ".popsection\n\t"
+/**<Implementation macro
+ **
+ ** Abort handler must be preceded by RSEQ_SIG (here as operand
+ ** of ud1 instruction), kernel refuses to jump elsewhere.
+ **/
+
+#define CMX_PERCPU_RSEQ_CLOBBER                                         \
+    "rax"
+
+#define CMX_PERCPU_RSEQ_ADD                                             \
+    "addq %[value], (%[var])\n\t"
+
+#define CMX_PERCPU_RSEQ_COMPARE_STORE                                   \
+    "cmpq %[expected], (%[var])\n\t"                                    \
+    "jnz %l[differ]\n\t"                                                \
+    "movq %[desired], (%[var])\n\t"
+
+#define CMX_PERCPU_RSEQ_POP                                             \
+    "movq (%[var]), %%rax\n\t"                                          \
+    "testq %%rax, %%rax\n\t"                                            \
+    "jz %l[empty]\n\t"                                                  \
+    "movq %%rax, (%[result])\n\t"                                       \
+    "movq (%%rax), %%rax\n\t"                                           \
+    "movq %%rax, (%[var])\n\t"
+
+#  elif defined (CMX_PERCPU_RSEQ) && defined (__aarch64__)
+
+#define CMX_PERCPU_RSEQ_START                                           \
+    ".pushsection __rseq_cs, \"aw\"\n\t"                                \
+    ".balign 32\n\t"                                                    \
+    "3:\n\t"                                                            \
+    ".long 0, 0\n\t"                                                    \
+    ".quad 1f, 2f - 1f, 4f\n\t"                                         \
+    ".popsection\n\t"                                                   \
+    "adrp x15, 3b\n\t"                                                  \
+    "add x15, x15, :lo12:3b\n\t"                                        \
+    "str x15, [%[rseq], #8]\n\t"                                        \
+    "1:\n\t"                                                            \
+    "ldr w15, [%[rseq], #4]\n\t"                                        \
+    "cmp w15, %w[cpu]\n\t"                                              \
+    "b.ne 4f\n\t"
+/**<Implementation macro
+ **
+ ** Publishes struct rseq_cs (version, flags, start, length, abort)
+ ** in rseq area and verifies that thread runs on slot's CPU.
+ **/
+
+#define CMX_PERCPU_RSEQ_COMMIT                                          \
+    "2:\n\t"                                                            \
+    "b 5f\n\t"                                                          \
+    ".inst 0xd428bc00\n\t"                                              \
+    "4:\n\t"                                                            \
+    "b %l[restart]\n\t"                                                 \
+    "5:\n\t"
+/**<Implementation macro
+ **
+ ** Abort handler must be preceded by RSEQ_SIG (here as brk
+ ** instruction), kernel refuses to jump elsewhere.
+ **/
+
+#define CMX_PERCPU_RSEQ_CLOBBER                                         \
+    "x15"
+
+#define CMX_PERCPU_RSEQ_ADD                                             \
+    "ldr x15, [%[var]]\n\t"                                             \
+    "add x15, x15, %[value]\n\t"                                        \
+    "str x15, [%[var]]\n\t"
+
+#define CMX_PERCPU_RSEQ_COMPARE_STORE                                   \
+    "ldr x15, [%[var]]\n\t"                                             \
+    "cmp x15, %[expected]\n\t"                                          \
+    "b.ne %l[differ]\n\t"                                               \
+    "str %[desired], [%[var]]\n\t"
+
+#define CMX_PERCPU_RSEQ_POP                                             \
+    "ldr x15, [%[var]]\n\t"                                             \
+    "cbz x15, %l[empty]\n\t"                                            \
+    "str x15, [%[result]]\n\t"                                          \
+    "ldr x15, [x15]\n\t"                                                \
+    "str x15, [%[var]]\n\t"
+
+#  endif
+
+static inline void
+cmx_percpu_counter_init (struct CMX_Percpu_Counter *counter) {
+    size_t i;
+
+    for (i = 0; i < CMX_PERCPU_SLOTS; ++i)
+        CMX_ATOMIC_INT64_STORE (counter->slots[i].value, 0);
+}
+/**<Implementation function
+ **/
+
+static inline int64_t
+cmx_percpu_sum (struct CMX_Percpu_Counter *counter) {
+    int64_t retval = 0;
+    size_t i;
+
+    for (i = 0; i < CMX_PERCPU_SLOTS; ++i)
+        retval += CMX_ATOMIC_INT64_LOAD (counter->slots[i].value);
+
+    return retval;
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_percpu_list_init (struct CMX_Percpu_List *list) {
+    size_t i;
+
+    for (i = 0; i < CMX_PERCPU_SLOTS; ++i) {
+        CMX_ATOMIC_PTR_STORE (list->slots[i].head, NULL);
+        CMX_ATOMIC_INT_STORE (list->slots[i].popping, 0);
+    }
+}
+/**<Implementation function
+ **/
+
+#  ifdef CMX_PERCPU_RSEQ
+
+static inline int
+cmx_percpu_rseq_init (void) {
+    static int available;
+    long cpus;
+    int retval = __atomic_load_n (&available, __ATOMIC_RELAXED);
+
+    if (0 == retval) {
+        cpus = sysconf (_SC_NPROCESSORS_CONF);
+        retval = __rseq_size && 0 < cpus && cpus <= CMX_PERCPU_SLOTS ? 1 : -1;
+        __atomic_store_n (&available, retval, __ATOMIC_RELAXED);
+    }
+
+    return 1 == retval;
+}
+/**<Implementation function
+ **
+ ** Result depends only on process-wide values, it is the same
+ ** in every translation unit caching it.
+ **/
+
+static inline int
+cmx_percpu_rseq_cpu (void) {
+    volatile struct rseq *rseq;
+
+    if (! cmx_percpu_rseq_init ())
+        return -1;
+
+    rseq = CMX_ENV_LINUX_RSEQ_AREA ();
+    if ((int32_t) rseq->cpu_id < 0)
+        return -1;
+
+    return (int) rseq->cpu_id_start;
+}
+/**<Implementation function
+ **
+ ** Evaluates CPU critical section should run on, -1 when rseq critical
+ ** sections cannot be used.
+ **/
+
+static inline int
+cmx_percpu_rseq_add (int cpu, void *var, int64_t value) {
+    __asm__ goto (
+        CMX_PERCPU_RSEQ_START
+        CMX_PERCPU_RSEQ_ADD
+        CMX_PERCPU_RSEQ_COMMIT
+        :
+        : [rseq] "r" (CMX_ENV_LINUX_RSEQ_AREA ()),
+          [cpu] "r" (cpu),
+          [var] "r" (var),
+          [value] "r" (value)
+        : "memory", "cc", CMX_PERCPU_RSEQ_CLOBBER
+        : restart
+    );
+
+    return 1;
+
+restart:
+    return 0;
+}
+/**<Implementation function
+ **
+ ** Evaluates 0 when critical section was aborted.
+ **/
+
+static inline int
+cmx_percpu_rseq_compare_store (int cpu, void *var, int64_t expected, int64_t desired) {
+    __asm__ goto (
+        CMX_PERCPU_RSEQ_START
+        CMX_PERCPU_RSEQ_COMPARE_STORE
+        CMX_PERCPU_RSEQ_COMMIT
+        :
+        : [rseq] "r" (CMX_ENV_LINUX_RSEQ_AREA ()),
+          [cpu] "r" (cpu),
+          [var] "r" (var),
+          [expected] "r" (expected),
+          [desired] "r" (desired)
+        : "memory", "cc", CMX_PERCPU_RSEQ_CLOBBER
+        : restart, differ
+    );
+
+    return 1;
+
+differ:
+    return 0;
+
+restart:
+    return -1;
+}
+/**<Implementation function
+ **
+ ** Evaluates 1 when Desired was stored, 0 when var doesn't contain
+ ** Expected, -1 when critical section was aborted.
+ **/
+
+static inline int
+cmx_percpu_rseq_pop (int cpu, void *var, void **result) {
+    __asm__ goto (
+        CMX_PERCPU_RSEQ_START
+        CMX_PERCPU_RSEQ_POP
+        CMX_PERCPU_RSEQ_COMMIT
+        :
+        : [rseq] "r" (CMX_ENV_LINUX_RSEQ_AREA ()),
+          [cpu] "r" (cpu),
+          [var] "r" (var),
+          [result] "r" (result)
+        : "memory", "cc", CMX_PERCPU_RSEQ_CLOBBER
+        : restart, empty
+    );
+
+    return 1;
+
+empty:
+    return 0;
+
+restart:
+    return -1;
+}
+/**<Implementation function
+ **
+ ** Evaluates 1 when head was popped into result, 0 when list is empty,
+ ** -1 when critical section was aborted.
+ **/
+
+#  else
+
+static inline int
+cmx_percpu_rseq_init (void) {
+    return 0;
+}
+/**<Implementation function
+ **/
+
+#  endif
+
+static inline void
+cmx_percpu_add (struct CMX_Percpu_Counter *counter, int64_t value) {
+#  ifdef CMX_PERCPU_RSEQ
+    int cpu;
+
+    while (0 <= (cpu = cmx_percpu_rseq_cpu ()))
+        if (cmx_percpu_rseq_add (cpu, &counter->slots[cpu & (CMX_PERCPU_SLOTS - 1)].value, value))
+            return;
+#  endif
+
+    (void) CMX_ATOMIC_INT64_FETCH_ADD (counter->slots[CMX_PERCPU_SLOT].value, value);
+}
+/**<Implementation function
+ **/
+
+static inline int
+cmx_percpu_compare_store (struct CMX_Percpu_Counter *counter, int64_t *expected, int64_t desired) {
+#  ifdef CMX_PERCPU_RSEQ
+    struct _CMX_Percpu_Counter_Slot *slot;
+    int retval;
+    int cpu;
+
+    while (0 <= (cpu = cmx_percpu_rseq_cpu ())) {
+        slot = &counter->slots[cpu & (CMX_PERCPU_SLOTS - 1)];
+        retval = cmx_percpu_rseq_compare_store (cpu, &slot->value, *expected, desired);
+        if (0 == retval)
+            *expected = CMX_ATOMIC_INT64_LOAD (slot->value);
+        if (0 <= retval)
+            return retval;
+    }
+#  endif
+
+    return CMX_ATOMIC_INT64_COMPARE_EXCHANGE (counter->slots[CMX_PERCPU_SLOT].value, *expected, desired);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_percpu_list_slot_push (struct _CMX_Percpu_List_Slot *slot, void *ptr) {
+    void *head = CMX_ATOMIC_PTR_LOAD (slot->head);
+
+    do
+        * (void **) ptr = head;
+    while (! CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK (slot->head, head, ptr));
+}
+/**<Implementation function
+ **/
+
+static inline void *
+cmx_percpu_list_slot_pop (struct _CMX_Percpu_List_Slot *slot) {
+    void *head;
+    int expected;
+
+    if (NULL == CMX_ATOMIC_PTR_LOAD (slot->head))
+        return NULL;
+
+    for (;;) {
+        expected = 0;
+        if (CMX_ATOMIC_INT_COMPARE_EXCHANGE (slot->popping, expected, 1))
+            break;
+        CMX_THREAD_YIELD ();
+    }
+
+    head = CMX_ATOMIC_PTR_LOAD (slot->head);
+    while (NULL != head
+           && ! CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK (slot->head, head, * (void **) head))
+        ;
+
+    CMX_ATOMIC_INT_STORE (slot->popping, 0);
+
+    return head;
+}
+/**<Implementation function
+ **
+ ** Head cannot be popped (and pushed back with other next) by another
+ ** thread while popping flag is held, compare-and-swap from head to its
+ ** next is safe against concurrent pushes.
+ **
+ ** Popping thread is rarely preempted holding flag, other thread
+ ** on the same CPU yields to let it finish.
+ **/
+
+static inline void
+cmx_percpu_list_push (struct CMX_Percpu_List *list, void *ptr) {
+#  ifdef CMX_PERCPU_RSEQ
+    struct _CMX_Percpu_List_Slot *slot;
+    void *head;
+    int cpu;
+
+    while (0 <= (cpu = cmx_percpu_rseq_cpu ())) {
+        slot = &list->slots[cpu & (CMX_PERCPU_SLOTS - 1)];
+        head = CMX_ATOMIC_PTR_LOAD (slot->head);
+        * (void **) ptr = head;
+        if (0 < cmx_percpu_rseq_compare_store (cpu, &slot->head, (intptr_t) head, (intptr_t) ptr))
+            return;
+    }
+#  endif
+
+    cmx_percpu_list_slot_push (&list->slots[CMX_PERCPU_SLOT], ptr);
+}
+/**<Implementation function
+ **/
+
+static inline void *
+cmx_percpu_list_pop (struct CMX_Percpu_List *list) {
+#  ifdef CMX_PERCPU_RSEQ
+    void *retval;
+    int popped;
+    int cpu;
+
+    while (0 <= (cpu = cmx_percpu_rseq_cpu ()))
+        if (0 <= (popped = cmx_percpu_rseq_pop (cpu, &list->slots[cpu & (CMX_PERCPU_SLOTS - 1)].head, &retval)))
+            return popped ? retval : NULL;
+#  endif
+
+    return cmx_percpu_list_slot_pop (&list->slots[CMX_PERCPU_SLOT]);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_percpu_list_clear (struct CMX_Percpu_List *list, void (* free_fn) (void *)) {
+    void *ptr;
+    size_t i;
+
+    for (i = 0; i < CMX_PERCPU_SLOTS; ++i)
+        while (NULL != (ptr = cmx_percpu_list_slot_pop (&list->slots[i])))
+            free_fn (ptr);
+}
+/**<Implementation function
+ **/
+
+#endif  /* header guard */
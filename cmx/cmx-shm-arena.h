@@ -0,0 +1,206 @@
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Shared memory arena (bump allocator) for structs shared between
+ ** processes.
+ **
+ ** @section Idea behind
+ **
+ ** Workers exchanging data over sockets pay a copy and a syscall
+ ** per message. Structs allocated in shared mapping can be accessed
+ ** by all processes directly, synchronized by process-shared mutexes
+ ** (see cmx-env-posix-shared.h) and atomic ref counters.
+ **
+ ** Arena is single mapping starting with its header, allocation is
+ ** one atomic fetch-add so it can be used from several processes
+ ** concurrently. Memory is never freed individually, whole arena is
+ ** released by cmx_shm_arena_destroy().
+ **
+ ** Anonymous arena (cmx_shm_arena_create) is inherited by fork()ed
+ ** children at the same address, so pointers can be shared directly.
+ ** Arena mapped from file descriptor (memfd_create, shm_open) may be
+ ** mapped at different address in every process, exchange offsets
+ ** (cmx_shm_arena_offset / cmx_shm_arena_pointer) in such case.
+ **
+ ** Module requires POSIX (mmap) and environment with CMX_ATOMIC_SIZE_
+ ** defined, it is not included by cmx.h.
+ **
+ ** @section Proposed usage
+ **
+ **     #define HAVE_CMX_ENV_POSIX_SHARED 1
+ **     #include <cmx/cmx.h>
+ **     #include <cmx/cmx-shm-arena.h>
+ **
+ **     struct CMX_Shm_Arena *arena = cmx_shm_arena_create (1 << 20);
+ **     struct Foo *foo = cmx_shm_arena_alloc (arena, sizeof (*foo));
+ **
+ **     CMX_STRUCT_REFS_INIT (foo);
+ **     CMX_STRUCT_SHAREABLE_INIT (foo);
+ **     foo_share (foo);
+ **
+ **     if (0 == fork ()) {
+ **         CMX_STRUCT_SHAREABLE_SYNCHRONIZE (foo) { ... }
+ **         _exit (0);
+ **     }
+ **/
+
+#ifndef CMX_SHM_ARENA_H
+#define CMX_SHM_ARENA_H 1
+
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <cmx/cmx-env.h>
+
+#ifndef CMX_SHM_ARENA_ALIGN
+#define CMX_SHM_ARENA_ALIGN                                             \
+    CMX_CACHE_LINE_SIZE
+/**<Alignment of allocated memory
+ **
+ ** Cache line by default so structs used by different processes
+ ** don't share cache line.
+ **/
+#endif
+
+struct CMX_Shm_Arena {
+    CMX_ATOMIC_SIZE_TYPE used;
+    size_t size;
+};
+
+#define CMX_SHM_ARENA_HEADER_SIZE                                       \
+    CMX_SHM_ARENA_ROUND (sizeof (struct CMX_Shm_Arena))
+/**<Size reserved for arena header at start of mapping
+ **/
+
+#define CMX_SHM_ARENA_ROUND(Size)                                       \
+    (((Size) + CMX_SHM_ARENA_ALIGN - 1)                                 \
+        / CMX_SHM_ARENA_ALIGN * CMX_SHM_ARENA_ALIGN)
+/**<Round Size up to CMX_SHM_ARENA_ALIGN
+ **/
+
+static inline struct CMX_Shm_Arena *
+cmx_shm_arena_map (int fd, size_t size) {
+    struct CMX_Shm_Arena *retval;
+    int flags = MAP_SHARED;
+
+    if (fd < 0)
+        flags |= MAP_ANONYMOUS;
+
+    retval = mmap (NULL, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (MAP_FAILED == retval)
+        return NULL;
+
+    return retval;
+}
+/**<Implementation function
+ **/
+
+static inline struct CMX_Shm_Arena *
+cmx_shm_arena_create (size_t size) {
+    struct CMX_Shm_Arena *retval;
+
+    size = CMX_SHM_ARENA_ROUND (size) + CMX_SHM_ARENA_HEADER_SIZE;
+    retval = cmx_shm_arena_map (-1, size);
+    if (NULL == retval)
+        return NULL;
+
+    retval->size = size;
+    CMX_ATOMIC_SIZE_STORE (retval->used, CMX_SHM_ARENA_HEADER_SIZE);
+
+    return retval;
+}
+/**<Create anonymous arena with Size bytes usable
+ **
+ ** Arena is shared with processes forked after its creation.
+ ** Returns NULL if mapping fails (errno is set).
+ **/
+
+static inline struct CMX_Shm_Arena *
+cmx_shm_arena_create_fd (int fd, size_t size) {
+    struct CMX_Shm_Arena *retval;
+
+    size = CMX_SHM_ARENA_ROUND (size) + CMX_SHM_ARENA_HEADER_SIZE;
+    if (0 != ftruncate (fd, size))
+        return NULL;
+
+    retval = cmx_shm_arena_map (fd, size);
+    if (NULL == retval)
+        return NULL;
+
+    retval->size = size;
+    CMX_ATOMIC_SIZE_STORE (retval->used, CMX_SHM_ARENA_HEADER_SIZE);
+
+    return retval;
+}
+/**<Create arena in shared memory object fd (memfd_create, shm_open)
+ **
+ ** Resizes fd to fit Size usable bytes. Other processes attach
+ ** using cmx_shm_arena_attach().
+ ** Returns NULL on failure (errno is set).
+ **/
+
+static inline struct CMX_Shm_Arena *
+cmx_shm_arena_attach (int fd) {
+    struct CMX_Shm_Arena *header;
+    size_t size;
+
+    header = cmx_shm_arena_map (fd, sizeof (*header));
+    if (NULL == header)
+        return NULL;
+
+    size = header->size;
+    munmap (header, sizeof (*header));
+
+    return cmx_shm_arena_map (fd, size);
+}
+/**<Map arena created by cmx_shm_arena_create_fd() in other process
+ **
+ ** Returns NULL on failure (errno is set).
+ **/
+
+static inline void *
+cmx_shm_arena_alloc (struct CMX_Shm_Arena *arena, size_t size) {
+    size_t offset;
+
+    size = CMX_SHM_ARENA_ROUND (size);
+    offset = CMX_ATOMIC_SIZE_FETCH_ADD (arena->used, size);
+    if (offset + size > arena->size || offset + size < offset)
+        return NULL;
+
+    return (char *) arena + offset;
+}
+/**<Allocate Size bytes from arena, returns NULL when arena is exhausted
+ **
+ ** Memory is zero filled (until arena is reused) and aligned to
+ ** CMX_SHM_ARENA_ALIGN. Function is safe to be called concurrently
+ ** from threads and processes.
+ **/
+
+static inline size_t
+cmx_shm_arena_offset (struct CMX_Shm_Arena *arena, void *ptr) {
+    return (char *) ptr - (char *) arena;
+}
+/**<Convert pointer into arena offset (mapping independent)
+ **/
+
+static inline void *
+cmx_shm_arena_pointer (struct CMX_Shm_Arena *arena, size_t offset) {
+    return (char *) arena + offset;
+}
+/**<Convert arena offset into pointer valid in current process
+ **/
+
+static inline void
+cmx_shm_arena_destroy (struct CMX_Shm_Arena *arena) {
+    if (NULL != arena)
+        munmap (arena, arena->size);
+}
+/**<Unmap arena in current process
+ **
+ ** Other processes keep their mappings.
+ **/
+
+#endif  /* header guard */
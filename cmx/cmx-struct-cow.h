@@ -0,0 +1,108 @@
+#ifndef CMX_STRUCT_COW_H
+#define CMX_STRUCT_COW_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-meta.h>
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-struct-refs.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Copy-on-write for structs with reference counting.
+ **
+ ** @section Idea behind
+ **
+ ** Read-mostly snapshots passed between threads are often copied
+ ** defensively before modification because writer cannot tell whether
+ ** somebody else holds the same struct. Reference counter tells it:
+ ** when it is 1, the only reference is the writer's one and nobody can
+ ** take another (that requires reference), struct can be modified in
+ ** place. Otherwise writer clones it, releases its reference of the
+ ** original (readers keep using it) and continues with the clone.
+ **
+ ** Macros require environment with CMX_ATOMIC_INT_ defined
+ **
+ ** @section Proposed usage
+ **
+ **     struct Config *config = config_ref (current);
+ **
+ **     CMX_STRUCT_COW_WRITE (config, config_clone, config_unref) {
+ **         config->timeout = 10;
+ **     } else {
+ **         return ENOMEM;
+ **     }
+ **/
+
+#define CMX_STRUCT_COW_WRITE(PtrVar, CopyFn, UnrefFn)                   \
+    CMX_STRUCT_COW_WRITE_TRAN (                                         \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_COW_WRITE),                        \
+        PtrVar,                                                         \
+        CopyFn,                                                         \
+        UnrefFn                                                         \
+    )
+/**<Evaluate following block with PtrVar pointing to private struct
+ **
+ ** If PtrVar holds the only reference, block modifies it in place.
+ ** Otherwise struct is cloned by CopyFn, original is released by
+ ** UnrefFn and PtrVar is rebound to the clone before block is
+ ** evaluated.
+ **
+ ** Optional else-clause is evaluated when CopyFn fails (returns NULL),
+ ** PtrVar is left untouched then (still shared).
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** @param PtrVar  variable holding reference to struct with
+ **                CMX_STRUCT_REFS_DEFINE, must not be NULL
+ ** @param CopyFn  function returning clone (with single reference)
+ **                or NULL
+ ** @param UnrefFn unref function of struct (CMX_STRUCT_REFS_UNREF),
+ **                destroys original if other references were released
+ **                meanwhile
+ **
+ ** Usage:
+ **   CMX_STRUCT_COW_WRITE (ptr, xyz_clone, xyz_unref) { ptr->value = 1; }
+ **   CMX_STRUCT_COW_WRITE (ptr, xyz_clone, xyz_unref) { ... } else { ... }
+ **/
+
+#define CMX_STRUCT_COW_WRITE_TRAN(Prefix, PtrVar, CopyFn, UnrefFn)      \
+    CMX_STRUCT_COW_WRITE_IMPL (                                         \
+        CMX_TOKEN (Prefix, Copy),                                       \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Else),                                       \
+        PtrVar,                                                         \
+        CopyFn,                                                         \
+        UnrefFn                                                         \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_STRUCT_COW_WRITE_IMPL(Copy, Body, Else, PtrVar, CopyFn, UnrefFn) \
+    if (1) {                                                            \
+        if (! CMX_STRUCT_COW_EXCLUSIVE_P (PtrVar)) {                    \
+            void *Copy = CopyFn (PtrVar);                               \
+            if (NULL == Copy)                                           \
+                goto Else;                                              \
+            UnrefFn (PtrVar);                                           \
+            (PtrVar) = Copy;                                            \
+        }                                                               \
+        goto Body;                                                      \
+    } else CMX_META_DO_ELSE_BREAK (Body, Else)
+/**<Implementation macro
+ **/
+
+#define CMX_STRUCT_COW_EXCLUSIVE_P(Ptr)                                 \
+    (1 == CMX_ATOMIC_INT_LOAD ((Ptr)->CMX_STRUCT_REFS_NAME))
+/**<Evaluates TRUE if caller's reference is the only one
+ **
+ ** Load is acquire, modifications done by previous holders before
+ ** they released their references are visible.
+ **/
+
+#endif  /* guard */
@@ -0,0 +1,333 @@
+#ifndef CMX_STRUCT_LIST_H
+#define CMX_STRUCT_LIST_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-struct-refs.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Intrusive doubly linked list.
+ **
+ ** @section Idea behind
+ **
+ ** Container allocating node per element doubles allocations and adds
+ ** pointer chase (node -> element) to every traversal. Intrusive list
+ ** links are members of listed structs, insert and remove never
+ ** allocate and traversal reads elements directly.
+ **
+ ** Struct can be member of several lists using different link members,
+ ** one link can be in one list at a time.
+ **
+ ** List is not synchronized, protect it (eg. by
+ ** CMX_STRUCT_SHAREABLE_SYNCHRONIZE of struct owning it).
+ **
+ ** Ownership: CMX_STRUCT_LIST_INSERT_* don't change reference count
+ ** (ownership is passed to list), _REF variants take new reference of
+ ** CMX_STRUCT_REFS struct. CMX_STRUCT_LIST_REMOVE passes ownership
+ ** back to caller, CMX_STRUCT_LIST_CLEAR releases it by unref function.
+ **
+ ** @section Proposed usage
+ **
+ **     struct Job {
+ **         CMX_STRUCT_REFS_DEFINE;
+ **         CMX_STRUCT_LIST_DEFINE (link);
+ **         ...
+ **     };
+ **
+ **     CMX_STRUCT_LIST_HEAD_DEFINE (struct Job, link) jobs;
+ **
+ **     CMX_STRUCT_LIST_INIT (&jobs);
+ **     CMX_STRUCT_LIST_INSERT_TAIL_REF (&jobs, job);
+ **
+ **     CMX_STRUCT_LIST_FOREACH (&jobs, job) {
+ **         if (job_done_p (job)) {
+ **             CMX_STRUCT_LIST_REMOVE (&jobs, job);
+ **             job_unref (job);
+ **         }
+ **     }
+ **
+ **     CMX_STRUCT_LIST_CLEAR (&jobs, job_unref);
+ **/
+
+struct _CMX_Struct_List_Link {
+    struct _CMX_Struct_List_Link *next;
+    struct _CMX_Struct_List_Link *prev;
+};
+
+struct _CMX_Struct_List {
+    struct _CMX_Struct_List_Link head;
+    size_t count;
+};
+
+#define CMX_STRUCT_LIST_DEFINE(Name)                                    \
+    struct _CMX_Struct_List_Link Name
+/**<Structure member definition (list link)
+ **
+ ** Usage:
+ ** struct {
+ **   CMX_STRUCT_LIST_DEFINE (link);
+ **   ...
+ ** };
+ **/
+
+#define CMX_STRUCT_LIST_HEAD_DEFINE(Type, Name)                         \
+    struct {                                                            \
+        struct _CMX_Struct_List list;                                   \
+        Type * (* type)[offsetof (Type, Name) + 1];                     \
+    }
+/**<List type specifier
+ **
+ ** @param Type type of listed items
+ ** @param Name name of Type member defined by CMX_STRUCT_LIST_DEFINE
+ **
+ ** Member 'type' is never dereferenced, it only keeps item type
+ ** and link offset for sizeof () used by other CMX_STRUCT_LIST_ macros.
+ **
+ ** Usage:
+ **   CMX_STRUCT_LIST_HEAD_DEFINE (struct Job, link) jobs;
+ **/
+
+#define CMX_STRUCT_LIST_OFFSET(List)                                    \
+    (sizeof (* (List)->type) / sizeof (** (List)->type) - 1)
+/**<Offset of list link in listed item
+ **/
+
+#define CMX_STRUCT_LIST_LINK(List, Ptr)                                 \
+    ((void) sizeof ((Ptr) == ** (List)->type),                          \
+     (struct _CMX_Struct_List_Link *)                                   \
+         ((char *) (Ptr) + CMX_STRUCT_LIST_OFFSET (List)))
+/**<Implementation macro: link of item (type checked)
+ **/
+
+#define CMX_STRUCT_LIST_ITEM(List, Link)                                \
+    ((void *) ((char *) (Link) - CMX_STRUCT_LIST_OFFSET (List)))
+/**<Implementation macro: item of link
+ **/
+
+#define CMX_STRUCT_LIST_INIT(List)                                      \
+    cmx_struct_list_init (& (List)->list)
+/**<Initialize empty list
+ **
+ ** @param List pointer to CMX_STRUCT_LIST_HEAD_DEFINE variable
+ **/
+
+#define CMX_STRUCT_LIST_COUNT(List)                                     \
+    ((List)->list.count)
+/**<Number of items in list
+ **/
+
+#define CMX_STRUCT_LIST_EMPTY_P(List)                                   \
+    (0 == CMX_STRUCT_LIST_COUNT (List))
+/**<Evaluates TRUE if list is empty
+ **/
+
+#define CMX_STRUCT_LIST_FIRST(List)                                     \
+    cmx_struct_list_item (                                              \
+        & (List)->list,                                                 \
+        (List)->list.head.next,                                         \
+        CMX_STRUCT_LIST_OFFSET (List)                                   \
+    )
+/**<First item of list, NULL if list is empty
+ **/
+
+#define CMX_STRUCT_LIST_LAST(List)                                      \
+    cmx_struct_list_item (                                              \
+        & (List)->list,                                                 \
+        (List)->list.head.prev,                                         \
+        CMX_STRUCT_LIST_OFFSET (List)                                   \
+    )
+/**<Last item of list, NULL if list is empty
+ **/
+
+#define CMX_STRUCT_LIST_INSERT_HEAD(List, Ptr)                          \
+    cmx_struct_list_insert (                                            \
+        & (List)->list,                                                 \
+        & (List)->list.head,                                            \
+        CMX_STRUCT_LIST_LINK ((List), (Ptr))                            \
+    )
+/**<Insert item at beginning of list
+ **
+ ** Ownership of Ptr is passed to list.
+ **
+ ** @param List pointer to CMX_STRUCT_LIST_HEAD_DEFINE variable
+ ** @param Ptr  non-NULL item pointer, not member of other list
+ **             by the same link
+ **/
+
+#define CMX_STRUCT_LIST_INSERT_TAIL(List, Ptr)                          \
+    cmx_struct_list_insert (                                            \
+        & (List)->list,                                                 \
+        (List)->list.head.prev,                                         \
+        CMX_STRUCT_LIST_LINK ((List), (Ptr))                            \
+    )
+/**<Append item at end of list
+ **
+ ** Same rules as CMX_STRUCT_LIST_INSERT_HEAD
+ **/
+
+#define CMX_STRUCT_LIST_INSERT_HEAD_REF(List, Ptr)                      \
+    (CMX_STRUCT_REFS_INCREMENT (Ptr),                                   \
+     CMX_STRUCT_LIST_INSERT_HEAD ((List), (Ptr)))
+/**<Insert item at beginning of list, list takes its own reference
+ **
+ ** Item must be CMX_STRUCT_REFS struct, Ptr is evaluated twice.
+ **
+ ** Uses
+ ** - CMX_STRUCT_REFS_INCREMENT
+ **/
+
+#define CMX_STRUCT_LIST_INSERT_TAIL_REF(List, Ptr)                      \
+    (CMX_STRUCT_REFS_INCREMENT (Ptr),                                   \
+     CMX_STRUCT_LIST_INSERT_TAIL ((List), (Ptr)))
+/**<Append item at end of list, list takes its own reference
+ **
+ ** Same rules as CMX_STRUCT_LIST_INSERT_HEAD_REF
+ **/
+
+#define CMX_STRUCT_LIST_REMOVE(List, Ptr)                               \
+    cmx_struct_list_remove (                                            \
+        & (List)->list,                                                 \
+        CMX_STRUCT_LIST_LINK ((List), (Ptr))                            \
+    )
+/**<Remove item from list
+ **
+ ** Ownership (reference) held by list is passed to caller.
+ **
+ ** @param List pointer to CMX_STRUCT_LIST_HEAD_DEFINE variable
+ ** @param Ptr  item member of List
+ **/
+
+#define CMX_STRUCT_LIST_CLEAR(List, UnrefFn)                            \
+    CMX_STRUCT_LIST_CLEAR_TRAN (                                        \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_LIST_CLEAR),                       \
+        List,                                                           \
+        UnrefFn                                                         \
+    )
+/**<Remove all items and release them by UnrefFn
+ **
+ ** @param List    pointer to CMX_STRUCT_LIST_HEAD_DEFINE variable
+ ** @param UnrefFn function releasing ownership of list (eg. xyz_unref)
+ **/
+
+#define CMX_STRUCT_LIST_CLEAR_TRAN(Prefix, List, UnrefFn)               \
+    CMX_STRUCT_LIST_CLEAR_IMPL (                                        \
+        CMX_TOKEN (Prefix, Link),                                       \
+        List,                                                           \
+        UnrefFn                                                         \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_STRUCT_LIST_CLEAR_IMPL(Link, List, UnrefFn)                 \
+    do {                                                                \
+        struct _CMX_Struct_List_Link *Link;                             \
+        while (& (List)->list.head != (Link = (List)->list.head.next)) { \
+            cmx_struct_list_remove (& (List)->list, Link);              \
+            UnrefFn (CMX_STRUCT_LIST_ITEM ((List), Link));              \
+        }                                                               \
+    } while (0)
+/**<Implementation macro
+ **/
+
+#define CMX_STRUCT_LIST_FOREACH(List, Var)                              \
+    CMX_STRUCT_LIST_FOREACH_TRAN (                                      \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_LIST_FOREACH),                     \
+        List,                                                           \
+        Var                                                             \
+    )
+/**<Evaluate following statement / block for every item of list
+ **
+ ** Var (item pointer variable) is set to every item, from first
+ ** to last. Block may remove current item (only), 'break' and
+ ** 'continue' can be used.
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** @param List pointer to CMX_STRUCT_LIST_HEAD_DEFINE variable
+ ** @param Var  item pointer variable
+ **
+ ** Usage:
+ **   struct Job *job;
+ **   CMX_STRUCT_LIST_FOREACH (&jobs, job) { ... }
+ **/
+
+#define CMX_STRUCT_LIST_FOREACH_TRAN(Prefix, List, Var)                 \
+    CMX_STRUCT_LIST_FOREACH_IMPL (                                      \
+        CMX_TOKEN (Prefix, Link),                                       \
+        CMX_TOKEN (Prefix, Next),                                       \
+        List,                                                           \
+        Var                                                             \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_STRUCT_LIST_FOREACH_IMPL(Link, Next, List, Var)             \
+    for (struct _CMX_Struct_List_Link                                   \
+             *Link = (List)->list.head.next,                            \
+             *Next = Link->next;                                        \
+         Link != & (List)->list.head                                    \
+             && ((Var) = CMX_STRUCT_LIST_ITEM ((List), Link), 1);       \
+         Link = Next, Next = Link->next)
+/**<Implementation macro
+ **
+ ** Next is read before block is evaluated, so block may unlink Link.
+ **/
+
+static inline void
+cmx_struct_list_init (struct _CMX_Struct_List *list) {
+    list->head.next = list->head.prev = &list->head;
+    list->count = 0;
+}
+/**<Implementation function
+ **/
+
+static inline void *
+cmx_struct_list_item (
+    struct _CMX_Struct_List *list,
+    struct _CMX_Struct_List_Link *link,
+    size_t offset
+) {
+    return link == &list->head ? NULL : (char *) link - offset;
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_struct_list_insert (
+    struct _CMX_Struct_List *list,
+    struct _CMX_Struct_List_Link *prev,
+    struct _CMX_Struct_List_Link *link
+) {
+    link->prev = prev;
+    link->next = prev->next;
+    prev->next->prev = link;
+    prev->next = link;
+    ++list->count;
+}
+/**<Implementation function
+ **
+ ** Insert link after prev (list head for insert at beginning)
+ **/
+
+static inline void
+cmx_struct_list_remove (
+    struct _CMX_Struct_List *list,
+    struct _CMX_Struct_List_Link *link
+) {
+    link->prev->next = link->next;
+    link->next->prev = link->prev;
+    link->next = link->prev = NULL;
+    --list->count;
+}
+/**<Implementation function
+ **/
+
+#endif  /* guard */
@@ -0,0 +1,612 @@
+#ifndef CMX_STRUCT_RBTREE_H
+#define CMX_STRUCT_RBTREE_H 1
+
+#include <stddef.h>
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-struct-refs.h>
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Intrusive red-black tree.
+ **
+ ** @section Idea behind
+ **
+ ** Same as CMX_STRUCT_LIST (see cmx-struct-list.h): tree links are
+ ** members of stored structs, insert and remove never allocate and
+ ** lookup compares stored structs directly.
+ **
+ ** Items are ordered by qsort-like compare function of two items.
+ ** Lookup uses probe item (usually automatic variable with only key
+ ** members set). Items with equal keys are not allowed.
+ **
+ ** Remove relinks nodes (never copies items), so pointers to other
+ ** items and iteration positions stay valid.
+ **
+ ** Tree is not synchronized, protect it (eg. by
+ ** CMX_STRUCT_SHAREABLE_SYNCHRONIZE of struct owning it).
+ **
+ ** Ownership rules are same as for CMX_STRUCT_LIST.
+ **
+ ** @section Proposed usage
+ **
+ **     struct Timer {
+ **         CMX_STRUCT_REFS_DEFINE;
+ **         CMX_STRUCT_RBTREE_DEFINE (by_id);
+ **         int id;
+ **         ...
+ **     };
+ **
+ **     int timer_compare (const void *a, const void *b) {
+ **         const struct Timer *x = a, *y = b;
+ **         return (x->id > y->id) - (x->id < y->id);
+ **     }
+ **
+ **     CMX_STRUCT_RBTREE_HEAD_DEFINE (struct Timer, by_id) timers;
+ **
+ **     CMX_STRUCT_RBTREE_INIT (&timers);
+ **     CMX_STRUCT_RBTREE_INSERT_REF (&timers, timer, timer_compare);
+ **
+ **     struct Timer probe = { .id = 42 };
+ **     timer = CMX_STRUCT_RBTREE_FIND (&timers, &probe, timer_compare);
+ **
+ **     CMX_STRUCT_RBTREE_FOREACH (&timers, timer) { ... }
+ **
+ **     CMX_STRUCT_RBTREE_CLEAR (&timers, timer_unref);
+ **/
+
+struct _CMX_Struct_Rbtree_Link {
+    struct _CMX_Struct_Rbtree_Link *parent;
+    struct _CMX_Struct_Rbtree_Link *left;
+    struct _CMX_Struct_Rbtree_Link *right;
+    int red;
+};
+
+struct _CMX_Struct_Rbtree {
+    struct _CMX_Struct_Rbtree_Link *root;
+    size_t count;
+};
+
+typedef int (* _CMX_Struct_Rbtree_Compare) (const void *, const void *);
+
+#define CMX_STRUCT_RBTREE_DEFINE(Name)                                  \
+    struct _CMX_Struct_Rbtree_Link Name
+/**<Structure member definition (tree link)
+ **
+ ** Usage:
+ ** struct {
+ **   CMX_STRUCT_RBTREE_DEFINE (by_id);
+ **   ...
+ ** };
+ **/
+
+#define CMX_STRUCT_RBTREE_HEAD_DEFINE(Type, Name)                       \
+    struct {                                                            \
+        struct _CMX_Struct_Rbtree tree;                                 \
+        Type * (* type)[offsetof (Type, Name) + 1];                     \
+    }
+/**<Tree type specifier
+ **
+ ** @param Type type of stored items
+ ** @param Name name of Type member defined by CMX_STRUCT_RBTREE_DEFINE
+ **
+ ** Usage:
+ **   CMX_STRUCT_RBTREE_HEAD_DEFINE (struct Timer, by_id) timers;
+ **/
+
+#define CMX_STRUCT_RBTREE_OFFSET(Tree)                                  \
+    (sizeof (* (Tree)->type) / sizeof (** (Tree)->type) - 1)
+/**<Offset of tree link in stored item
+ **/
+
+#define CMX_STRUCT_RBTREE_LINK(Tree, Ptr)                               \
+    ((void) sizeof ((Ptr) == ** (Tree)->type),                          \
+     (struct _CMX_Struct_Rbtree_Link *)                                 \
+         ((char *) (Ptr) + CMX_STRUCT_RBTREE_OFFSET (Tree)))
+/**<Implementation macro: link of item (type checked)
+ **/
+
+#define CMX_STRUCT_RBTREE_ITEM(Tree, Link)                              \
+    cmx_struct_rbtree_item ((Link), CMX_STRUCT_RBTREE_OFFSET (Tree))
+/**<Implementation macro: item of link, NULL for NULL link
+ **/
+
+#define CMX_STRUCT_RBTREE_INIT(Tree)                                    \
+    ((Tree)->tree.root = NULL, (Tree)->tree.count = 0)
+/**<Initialize empty tree
+ **
+ ** @param Tree pointer to CMX_STRUCT_RBTREE_HEAD_DEFINE variable
+ **/
+
+#define CMX_STRUCT_RBTREE_COUNT(Tree)                                   \
+    ((Tree)->tree.count)
+/**<Number of items in tree
+ **/
+
+#define CMX_STRUCT_RBTREE_EMPTY_P(Tree)                                 \
+    (NULL == (Tree)->tree.root)
+/**<Evaluates TRUE if tree is empty
+ **/
+
+#define CMX_STRUCT_RBTREE_FIRST(Tree)                                   \
+    CMX_STRUCT_RBTREE_ITEM ((Tree), cmx_struct_rbtree_first ((Tree)->tree.root))
+/**<Smallest item, NULL if tree is empty
+ **/
+
+#define CMX_STRUCT_RBTREE_NEXT(Tree, Ptr)                               \
+    CMX_STRUCT_RBTREE_ITEM (                                            \
+        (Tree),                                                         \
+        cmx_struct_rbtree_next (CMX_STRUCT_RBTREE_LINK ((Tree), (Ptr))) \
+    )
+/**<Item following Ptr in order, NULL if Ptr is the last one
+ **/
+
+#define CMX_STRUCT_RBTREE_FIND(Tree, Probe, Compare)                    \
+    CMX_STRUCT_RBTREE_ITEM (                                            \
+        (Tree),                                                         \
+        cmx_struct_rbtree_find (                                        \
+            & (Tree)->tree,                                             \
+            ((void) sizeof ((Probe) == ** (Tree)->type), (Probe)),      \
+            CMX_STRUCT_RBTREE_OFFSET (Tree),                            \
+            (Compare)                                                   \
+        )                                                               \
+    )
+/**<Find item equal to Probe, NULL if there is none
+ **
+ ** Reference count of found item is not changed.
+ **
+ ** @param Tree    pointer to CMX_STRUCT_RBTREE_HEAD_DEFINE variable
+ ** @param Probe   pointer to item with key members set
+ ** @param Compare qsort-like function comparing two items
+ **/
+
+#define CMX_STRUCT_RBTREE_INSERT(Tree, Ptr, Compare)                    \
+    CMX_STRUCT_RBTREE_ITEM (                                            \
+        (Tree),                                                         \
+        cmx_struct_rbtree_insert (                                      \
+            & (Tree)->tree,                                             \
+            CMX_STRUCT_RBTREE_LINK ((Tree), (Ptr)),                     \
+            CMX_STRUCT_RBTREE_OFFSET (Tree),                            \
+            (Compare)                                                   \
+        )                                                               \
+    )
+/**<Insert item into tree
+ **
+ ** Evaluates NULL when item was inserted (ownership of Ptr is passed
+ ** to tree), or pointer to already stored equal item (Ptr is not
+ ** inserted then).
+ **
+ ** @param Tree    pointer to CMX_STRUCT_RBTREE_HEAD_DEFINE variable
+ ** @param Ptr     non-NULL item pointer, not member of other tree
+ **                by the same link
+ ** @param Compare qsort-like function comparing two items
+ **/
+
+#define CMX_STRUCT_RBTREE_INSERT_REF(Tree, Ptr, Compare)                \
+    (NULL == CMX_STRUCT_RBTREE_INSERT ((Tree), (Ptr), (Compare))        \
+     ? (CMX_STRUCT_REFS_INCREMENT (Ptr), 1)                             \
+     : 0)
+/**<Insert item into tree, tree takes its own reference
+ **
+ ** Evaluates TRUE if item was inserted. Item must be CMX_STRUCT_REFS
+ ** struct, Ptr is evaluated twice.
+ **
+ ** Uses
+ ** - CMX_STRUCT_REFS_INCREMENT
+ **/
+
+#define CMX_STRUCT_RBTREE_REMOVE(Tree, Ptr)                             \
+    cmx_struct_rbtree_remove (                                          \
+        & (Tree)->tree,                                                 \
+        CMX_STRUCT_RBTREE_LINK ((Tree), (Ptr))                          \
+    )
+/**<Remove item from tree
+ **
+ ** Ownership (reference) held by tree is passed to caller.
+ **
+ ** @param Tree pointer to CMX_STRUCT_RBTREE_HEAD_DEFINE variable
+ ** @param Ptr  item member of Tree
+ **/
+
+#define CMX_STRUCT_RBTREE_CLEAR(Tree, UnrefFn)                          \
+    CMX_STRUCT_RBTREE_CLEAR_TRAN (                                      \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_RBTREE_CLEAR),                     \
+        Tree,                                                           \
+        UnrefFn                                                         \
+    )
+/**<Remove all items and release them by UnrefFn
+ **
+ ** Tree is dismantled in post-order without rebalancing.
+ **
+ ** @param Tree    pointer to CMX_STRUCT_RBTREE_HEAD_DEFINE variable
+ ** @param UnrefFn function releasing ownership of tree (eg. xyz_unref)
+ **/
+
+#define CMX_STRUCT_RBTREE_CLEAR_TRAN(Prefix, Tree, UnrefFn)             \
+    CMX_STRUCT_RBTREE_CLEAR_IMPL (                                      \
+        CMX_TOKEN (Prefix, Link),                                       \
+        Tree,                                                           \
+        UnrefFn                                                         \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_STRUCT_RBTREE_CLEAR_IMPL(Link, Tree, UnrefFn)               \
+    do {                                                                \
+        struct _CMX_Struct_Rbtree_Link *Link;                           \
+        while (NULL != (Link = cmx_struct_rbtree_detach (& (Tree)->tree))) \
+            UnrefFn (CMX_STRUCT_RBTREE_ITEM ((Tree), Link));            \
+    } while (0)
+/**<Implementation macro
+ **/
+
+#define CMX_STRUCT_RBTREE_FOREACH(Tree, Var)                            \
+    CMX_STRUCT_RBTREE_FOREACH_TRAN (                                    \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_RBTREE_FOREACH),                   \
+        Tree,                                                           \
+        Var                                                             \
+    )
+/**<Evaluate following statement / block for every item in order
+ **
+ ** Var (item pointer variable) is set to every item, from smallest
+ ** to largest. Block may remove current item (only), 'break' and
+ ** 'continue' can be used.
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** @param Tree pointer to CMX_STRUCT_RBTREE_HEAD_DEFINE variable
+ ** @param Var  item pointer variable
+ **/
+
+#define CMX_STRUCT_RBTREE_FOREACH_TRAN(Prefix, Tree, Var)               \
+    CMX_STRUCT_RBTREE_FOREACH_IMPL (                                    \
+        CMX_TOKEN (Prefix, Link),                                       \
+        CMX_TOKEN (Prefix, Next),                                       \
+        Tree,                                                           \
+        Var                                                             \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_STRUCT_RBTREE_FOREACH_IMPL(Link, Next, Tree, Var)           \
+    for (struct _CMX_Struct_Rbtree_Link                                 \
+             *Link = cmx_struct_rbtree_first ((Tree)->tree.root),       \
+             *Next = cmx_struct_rbtree_next (Link);                     \
+         NULL != Link                                                   \
+             && ((Var) = CMX_STRUCT_RBTREE_ITEM ((Tree), Link), 1);     \
+         Link = Next, Next = cmx_struct_rbtree_next (Link))
+/**<Implementation macro
+ **
+ ** Next is found before block is evaluated, so block may remove Link.
+ **/
+
+static inline void *
+cmx_struct_rbtree_item (struct _CMX_Struct_Rbtree_Link *link, size_t offset) {
+    return link ? (char *) link - offset : NULL;
+}
+/**<Implementation function
+ **/
+
+static inline struct _CMX_Struct_Rbtree_Link *
+cmx_struct_rbtree_first (struct _CMX_Struct_Rbtree_Link *link) {
+    if (link)
+        while (link->left)
+            link = link->left;
+
+    return link;
+}
+/**<Implementation function
+ **
+ ** Leftmost link of subtree, NULL for empty subtree
+ **/
+
+static inline struct _CMX_Struct_Rbtree_Link *
+cmx_struct_rbtree_next (struct _CMX_Struct_Rbtree_Link *link) {
+    if (NULL == link)
+        return NULL;
+
+    if (link->right)
+        return cmx_struct_rbtree_first (link->right);
+
+    while (link->parent && link == link->parent->right)
+        link = link->parent;
+
+    return link->parent;
+}
+/**<Implementation function
+ **
+ ** In-order successor, NULL for NULL or the last link
+ **/
+
+static inline void
+cmx_struct_rbtree_replace (
+    struct _CMX_Struct_Rbtree *tree,
+    struct _CMX_Struct_Rbtree_Link *link,
+    struct _CMX_Struct_Rbtree_Link *with
+) {
+    if (NULL == link->parent)
+        tree->root = with;
+    else if (link == link->parent->left)
+        link->parent->left = with;
+    else
+        link->parent->right = with;
+
+    if (with)
+        with->parent = link->parent;
+}
+/**<Implementation function
+ **
+ ** Replace link by with in link's parent
+ **/
+
+static inline void
+cmx_struct_rbtree_rotate_left (
+    struct _CMX_Struct_Rbtree *tree,
+    struct _CMX_Struct_Rbtree_Link *link
+) {
+    struct _CMX_Struct_Rbtree_Link *pivot = link->right;
+
+    link->right = pivot->left;
+    if (pivot->left)
+        pivot->left->parent = link;
+
+    cmx_struct_rbtree_replace (tree, link, pivot);
+    pivot->left = link;
+    link->parent = pivot;
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_struct_rbtree_rotate_right (
+    struct _CMX_Struct_Rbtree *tree,
+    struct _CMX_Struct_Rbtree_Link *link
+) {
+    struct _CMX_Struct_Rbtree_Link *pivot = link->left;
+
+    link->left = pivot->right;
+    if (pivot->right)
+        pivot->right->parent = link;
+
+    cmx_struct_rbtree_replace (tree, link, pivot);
+    pivot->right = link;
+    link->parent = pivot;
+}
+/**<Implementation function
+ **/
+
+static inline struct _CMX_Struct_Rbtree_Link *
+cmx_struct_rbtree_find (
+    struct _CMX_Struct_Rbtree *tree,
+    const void *probe,
+    size_t offset,
+    _CMX_Struct_Rbtree_Compare compare
+) {
+    struct _CMX_Struct_Rbtree_Link *link = tree->root;
+    int cmp;
+
+    while (link) {
+        cmp = compare (probe, (char *) link - offset);
+        if (0 == cmp)
+            break;
+        link = cmp < 0 ? link->left : link->right;
+    }
+
+    return link;
+}
+/**<Implementation function
+ **/
+
+static inline struct _CMX_Struct_Rbtree_Link *
+cmx_struct_rbtree_insert (
+    struct _CMX_Struct_Rbtree *tree,
+    struct _CMX_Struct_Rbtree_Link *link,
+    size_t offset,
+    _CMX_Struct_Rbtree_Compare compare
+) {
+    struct _CMX_Struct_Rbtree_Link **slot = &tree->root;
+    struct _CMX_Struct_Rbtree_Link *parent = NULL;
+    struct _CMX_Struct_Rbtree_Link *grand;
+    struct _CMX_Struct_Rbtree_Link *uncle;
+    int cmp;
+
+    while (*slot) {
+        parent = *slot;
+        cmp = compare ((char *) link - offset, (char *) parent - offset);
+        if (0 == cmp)
+            return parent;
+        slot = cmp < 0 ? &parent->left : &parent->right;
+    }
+
+    link->parent = parent;
+    link->left = link->right = NULL;
+    link->red = 1;
+    *slot = link;
+    ++tree->count;
+
+    while ((parent = link->parent) && parent->red) {
+        grand = parent->parent;
+
+        if (parent == grand->left) {
+            uncle = grand->right;
+            if (uncle && uncle->red) {
+                parent->red = uncle->red = 0;
+                grand->red = 1;
+                link = grand;
+                continue;
+            }
+            if (link == parent->right) {
+                cmx_struct_rbtree_rotate_left (tree, parent);
+                parent = link;
+            }
+            parent->red = 0;
+            grand->red = 1;
+            cmx_struct_rbtree_rotate_right (tree, grand);
+        } else {
+            uncle = grand->left;
+            if (uncle && uncle->red) {
+                parent->red = uncle->red = 0;
+                grand->red = 1;
+                link = grand;
+                continue;
+            }
+            if (link == parent->left) {
+                cmx_struct_rbtree_rotate_right (tree, parent);
+                parent = link;
+            }
+            parent->red = 0;
+            grand->red = 1;
+            cmx_struct_rbtree_rotate_left (tree, grand);
+        }
+        break;
+    }
+
+    tree->root->red = 0;
+
+    return NULL;
+}
+/**<Implementation function
+ **
+ ** Returns NULL if link was inserted, link of equal item otherwise
+ **/
+
+static inline void
+cmx_struct_rbtree_remove (
+    struct _CMX_Struct_Rbtree *tree,
+    struct _CMX_Struct_Rbtree_Link *link
+) {
+    struct _CMX_Struct_Rbtree_Link *child;
+    struct _CMX_Struct_Rbtree_Link *parent;
+    struct _CMX_Struct_Rbtree_Link *sibling;
+    struct _CMX_Struct_Rbtree_Link *next;
+    int black;
+
+    if (NULL == link->left || NULL == link->right) {
+        child = link->left ? link->left : link->right;
+        parent = link->parent;
+        black = ! link->red;
+        cmx_struct_rbtree_replace (tree, link, child);
+    } else {
+        next = cmx_struct_rbtree_first (link->right);
+        child = next->right;
+        black = ! next->red;
+
+        if (next->parent == link) {
+            parent = next;
+        } else {
+            parent = next->parent;
+            cmx_struct_rbtree_replace (tree, next, child);
+            next->right = link->right;
+            next->right->parent = next;
+        }
+
+        cmx_struct_rbtree_replace (tree, link, next);
+        next->left = link->left;
+        next->left->parent = next;
+        next->red = link->red;
+    }
+
+    --tree->count;
+    link->parent = link->left = link->right = NULL;
+
+    if (! black)
+        return;
+
+    while (child != tree->root && (NULL == child || ! child->red)) {
+        if (child == parent->left) {
+            sibling = parent->right;
+            if (sibling->red) {
+                sibling->red = 0;
+                parent->red = 1;
+                cmx_struct_rbtree_rotate_left (tree, parent);
+                sibling = parent->right;
+            }
+            if ((NULL == sibling->left || ! sibling->left->red)
+                && (NULL == sibling->right || ! sibling->right->red)) {
+                sibling->red = 1;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if (NULL == sibling->right || ! sibling->right->red) {
+                sibling->left->red = 0;
+                sibling->red = 1;
+                cmx_struct_rbtree_rotate_right (tree, sibling);
+                sibling = parent->right;
+            }
+            sibling->red = parent->red;
+            parent->red = 0;
+            sibling->right->red = 0;
+            cmx_struct_rbtree_rotate_left (tree, parent);
+        } else {
+            sibling = parent->left;
+            if (sibling->red) {
+                sibling->red = 0;
+                parent->red = 1;
+                cmx_struct_rbtree_rotate_right (tree, parent);
+                sibling = parent->left;
+            }
+            if ((NULL == sibling->left || ! sibling->left->red)
+                && (NULL == sibling->right || ! sibling->right->red)) {
+                sibling->red = 1;
+                child = parent;
+                parent = child->parent;
+                continue;
+            }
+            if (NULL == sibling->left || ! sibling->left->red) {
+                sibling->right->red = 0;
+                sibling->red = 1;
+                cmx_struct_rbtree_rotate_left (tree, sibling);
+                sibling = parent->left;
+            }
+            sibling->red = parent->red;
+            parent->red = 0;
+            sibling->left->red = 0;
+            cmx_struct_rbtree_rotate_right (tree, parent);
+        }
+        child = tree->root;
+    }
+
+    if (child)
+        child->red = 0;
+}
+/**<Implementation function
+ **
+ ** Link with two children is replaced by its successor link (relinked,
+ ** items are never copied), then removed black height is restored.
+ **/
+
+static inline struct _CMX_Struct_Rbtree_Link *
+cmx_struct_rbtree_detach (struct _CMX_Struct_Rbtree *tree) {
+    struct _CMX_Struct_Rbtree_Link *link = tree->root;
+
+    if (NULL == link)
+        return NULL;
+
+    for (;;) {
+        while (link->left)
+            link = link->left;
+        if (NULL == link->right)
+            break;
+        link = link->right;
+    }
+
+    cmx_struct_rbtree_replace (tree, link, NULL);
+    link->parent = NULL;
+    --tree->count;
+
+    return link;
+}
+/**<Implementation function
+ **
+ ** Unlink any leaf without rebalancing (tree is being cleared),
+ ** NULL when tree is empty
+ **/
+
+#endif  /* guard */
@@ -26,6 +26,8 @@
  ** - use CMX_STRUCT_REFS_INIT in your constructor
  ** - use CMX_STRUCT_REFS_REF and CMX_STRUCT_REFS_UNREF
  **   to define your ref/unref functions
+ ** - use CMX_STRUCT_REFS_WAIT_ZERO to wait until other users
+ **   release their references (shutdown, reload)
  **/
 
 #ifndef CMX_STRUCT_REFS_NAME
@@ -61,8 +63,151 @@
  ** - CMX_STRUCT_REFS_NAME
  **/
 
+#define CMX_STRUCT_REFS_INCREMENT(Ptr)                                  \
+    (CMX_SINGLE_THREAD_P ()                                             \
+        ? (void) ++ (Ptr)->CMX_STRUCT_REFS_NAME                         \
+        : (void) CMX_ATOMIC_INT_INCREMENT ((Ptr)->CMX_STRUCT_REFS_NAME))
+/**<Increment ref counter
+ **
+ ** Expression taking reference outside of ref function
+ ** (eg. by container). Ptr must not be NULL.
+ **
+ ** Uses plain increment while process is single threaded.
+ **
+ ** Uses:
+ ** - CMX_SINGLE_THREAD_P
+ ** - CMX_ATOMIC_INT_INCREMENT
+ ** - CMX_STRUCT_REFS_NAME
+ **/
+
+#if defined (CMX_ATOMIC_INT_FETCH_SUB)                                  \
+    && defined (CMX_ATOMIC_INT_FETCH_OR)                                \
+    && defined (CMX_ATOMIC_INT_FETCH_AND)                               \
+    && defined (CMX_ATOMIC_INT_WAIT)
+#define CMX_STRUCT_REFS_DRAIN_P                                         \
+    1
+/**<Defined when env supports CMX_STRUCT_REFS_WAIT_ZERO
+ **
+ ** Drain-aware decrement is used then, otherwise unref uses
+ ** CMX_ATOMIC_INT_DECREMENT_AND_TEST of env.
+ **/
+#endif
+
+#ifdef CMX_STRUCT_REFS_DRAIN_P
+#define CMX_STRUCT_REFS_DECREMENT_AND_TEST(Ptr)                         \
+    (CMX_SINGLE_THREAD_P ()                                             \
+        ? 0 == -- (Ptr)->CMX_STRUCT_REFS_NAME                           \
+        : cmx_struct_refs_decrement_and_test (                          \
+            & (Ptr)->CMX_STRUCT_REFS_NAME                               \
+        ))
+#else
+#define CMX_STRUCT_REFS_DECREMENT_AND_TEST(Ptr)                         \
+    (CMX_SINGLE_THREAD_P ()                                             \
+        ? 0 == -- (Ptr)->CMX_STRUCT_REFS_NAME                           \
+        : CMX_ATOMIC_INT_DECREMENT_AND_TEST ((Ptr)->CMX_STRUCT_REFS_NAME))
+#endif
+/**<Decrement ref counter, evaluates TRUE when it drops to zero
+ **
+ ** Uses plain decrement while process is single threaded.
+ ** Wakes thread waiting in CMX_STRUCT_REFS_WAIT_ZERO when its
+ ** reference becomes the last one (if CMX_STRUCT_REFS_DRAIN_P).
+ ** Ptr must not be NULL.
+ **
+ ** Uses:
+ ** - CMX_SINGLE_THREAD_P
+ ** - CMX_ATOMIC_INT_DECREMENT_AND_TEST
+ **   or CMX_ATOMIC_INT_FETCH_SUB and CMX_ATOMIC_INT_WAKE_ALL
+ ** - CMX_STRUCT_REFS_NAME
+ **/
+
+#define CMX_STRUCT_REFS_DRAINING                                        \
+    0x40000000
+/**<Ref counter flag set while thread waits in CMX_STRUCT_REFS_WAIT_ZERO
+ **/
+
+#define CMX_STRUCT_REFS_WAIT_ZERO(Ptr)                                  \
+    cmx_struct_refs_wait_zero (& (Ptr)->CMX_STRUCT_REFS_NAME)
+/**<Wait until references of other users are released
+ **
+ ** Caller must hold one reference, macro returns when it is the only
+ ** one left (so object cannot be destroyed meanwhile). Release it
+ ** by unref then.
+ **
+ ** Waiting thread is woken by the unref leaving the last but one
+ ** reference, other unrefs stay single atomic operation.
+ **
+ ** Only one thread may wait on the same object at the same time.
+ ** References taken during wait are waited for as well, remove
+ ** object from shared containers first.
+ ** Ptr must not be NULL.
+ **
+ ** Available only when env provides operations listed below
+ ** (CMX_STRUCT_REFS_DRAIN_P is defined).
+ **
+ ** Uses:
+ ** - CMX_ATOMIC_INT_FETCH_OR
+ ** - CMX_ATOMIC_INT_FETCH_AND
+ ** - CMX_ATOMIC_INT_LOAD
+ ** - CMX_ATOMIC_INT_WAIT
+ ** - CMX_STRUCT_REFS_NAME
+ **
+ ** Usage:
+ **   remove_from_registry (foo);
+ **   CMX_STRUCT_REFS_WAIT_ZERO (foo);
+ **   foo_unref (foo);
+ **/
+
+#ifdef CMX_STRUCT_REFS_DRAIN_P
+
+static CMX_COLD void
+cmx_struct_refs_wake (CMX_ATOMIC_INT_TYPE *refs) {
+    (void) refs;
+    CMX_ATOMIC_INT_WAKE_ALL (*refs);
+}
+/**<Implementation function
+ **
+ ** Wake is issued after decrement, waiter may already release
+ ** the object. Futex wake of such address is harmless (kernel only
+ ** looks up waiters) and other env implementations don't touch it.
+ **/
+
+static inline int
+cmx_struct_refs_decrement_and_test (CMX_ATOMIC_INT_TYPE *refs) {
+    int previous = CMX_ATOMIC_INT_FETCH_SUB (*refs, 1);
+
+    if (CMX_UNLIKELY (CMX_STRUCT_REFS_DRAINING + 2 == previous))
+        cmx_struct_refs_wake (refs);
+
+    return 1 == previous;
+}
+/**<Implementation function
+ **
+ ** Wake (draining object only) is out of line, inlined unref is
+ ** single atomic operation and test.
+ **/
+
+static CMX_COLD void
+cmx_struct_refs_wait_zero (CMX_ATOMIC_INT_TYPE *refs) {
+    int value;
+
+    value = CMX_ATOMIC_INT_FETCH_OR (*refs, CMX_STRUCT_REFS_DRAINING)
+        | CMX_STRUCT_REFS_DRAINING;
+
+    while (CMX_STRUCT_REFS_DRAINING + 1 != value) {
+        CMX_ATOMIC_INT_WAIT (*refs, value);
+        value = CMX_ATOMIC_INT_LOAD (*refs);
+    }
+
+    CMX_ATOMIC_INT_FETCH_AND (*refs, ~ CMX_STRUCT_REFS_DRAINING);
+}
+/**<Implementation function
+ **/
+
+#endif  /* CMX_STRUCT_REFS_DRAIN_P */
+
 #define CMX_STRUCT_REFS_REF(Ptr)                                        \
     CMX_STRUCT_REFS_REF_TRAN (                                          \
+        CMX_STRUCT_REFS_INCREMENT,                                      \
         CMX_UNIQUE_TOKEN (CMX_STRUCT_REFS_REF),                         \
         (Ptr)                                                           \
     )
@@ -78,8 +223,7 @@
  ** Macro generates single statement code.
  **
  ** Macro uses:
- ** - CMX_ATOMIC_INT_INCREMENT
- ** - CMX_STRUCT_REFS_NAME
+ ** - CMX_STRUCT_REFS_INCREMENT
  **
  ** Usage:
  **   struct xyz * xyz_ref (struct xyz * ptr) {
@@ -87,20 +231,23 @@
  **   }
  **/
 
-#define CMX_STRUCT_REFS_REF_TRAN(Prefix, Ptr)                           \
+#define CMX_STRUCT_REFS_REF_TRAN(Increment, Prefix, Ptr)                \
     CMX_STRUCT_REFS_REF_IMPL (                                          \
+        Increment,                                                      \
         CMX_TOKEN (Prefix, Body),                                       \
         CMX_TOKEN (Prefix, Finish),                                     \
         (Ptr)                                                           \
     )
 /**<Transient macro to evaluate arguments and generate tokens
  ** required by implementation macro
+ **
+ ** @param Increment macro incrementing ref counter of Ptr
  **/
 
-#define CMX_STRUCT_REFS_REF_IMPL(Body, Finish, Ptr)                     \
+#define CMX_STRUCT_REFS_REF_IMPL(Increment, Body, Finish, Ptr)          \
     if (1) {                                                            \
-        if (NULL != (Ptr)) {                                            \
-            CMX_ATOMIC_INT_INCREMENT ((Ptr)->CMX_STRUCT_REFS_NAME);     \
+        if (CMX_LIKELY (NULL != (Ptr))) {                               \
+            Increment (Ptr);                                            \
             goto Body;                                                  \
         }                                                               \
     Finish:                                                             \
@@ -111,6 +258,7 @@
 
 #define CMX_STRUCT_REFS_UNREF(Ptr)                                      \
     CMX_STRUCT_REFS_UNREF_TRAN (                                        \
+        CMX_STRUCT_REFS_DECREMENT_AND_TEST,                             \
         (Ptr),                                                          \
         CMX_UNIQUE_TOKEN (CMX_STRUCT_REFS_UNREF)                        \
     )
@@ -126,8 +274,7 @@
  ** Macro generates single statement code.
  **
  ** Uses
- ** - CMX_ATOMIC_INT_DECREMENT_AND_TEST
- ** - CMX_STRUCT_REFS_NAME
+ ** - CMX_STRUCT_REFS_DECREMENT_AND_TEST
  **
  ** Usage:
  ** void xyz_unref (struct xyz * ptr) {
@@ -136,26 +283,33 @@
  ** }
  **/
 
-#define CMX_STRUCT_REFS_UNREF_TRAN(Ptr, Prefix)                         \
+#define CMX_STRUCT_REFS_UNREF_TRAN(DecrementAndTest, Ptr, Prefix)       \
     CMX_STRUCT_REFS_UNREF_IMPL (                                        \
+        DecrementAndTest,                                               \
         (Ptr),                                                          \
         CMX_TOKEN (Prefix, Body),                                       \
         CMX_TOKEN (Prefix, Else)                                        \
     )
 /**<Transition macro to evaluate arguments and generate tokens
  ** required by implementation macro
+ **
+ ** @param DecrementAndTest macro decrementing ref counter of Ptr,
+ **        evaluating TRUE when it drops to zero
  **/
 
-#define CMX_STRUCT_REFS_UNREF_IMPL(Ptr, Body, Else)                     \
+#define CMX_STRUCT_REFS_UNREF_IMPL(DecrementAndTest, Ptr, Body, Else)   \
     if (1) {                                                            \
-        if (NULL != (Ptr)) {                                            \
-            if (CMX_ATOMIC_INT_DECREMENT_AND_TEST ((Ptr)->CMX_STRUCT_REFS_NAME)) \
+        if (CMX_LIKELY (NULL != (Ptr))) {                               \
+            if (CMX_UNLIKELY (DecrementAndTest (Ptr)))                  \
                 goto Body;                                              \
             else                                                        \
                 goto Else;                                              \
         }                                                               \
     } CMX_META_DO_ELSE_BREAK (Body, Else)
 /**<Implementation macro
+ **
+ ** Destroy block (Body) is hinted as unlikely, it is laid out after
+ ** fast path of unref keeping object alive.
  **/
 
 #endif  /* guard */
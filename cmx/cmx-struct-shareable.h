@@ -99,18 +99,97 @@
  **         }
  **         return retval;
  **     }
+ **
+ ** @subsubsection Biased mode
+ **
+ ** Structs locked almost exclusively by one thread may use biased lock
+ ** (see cmx-biased-lock.h) instead of plain mutex: define
+ ** CMX_STRUCT_SHAREABLE_BIASED before including cmx.h. Struct is biased
+ ** towards the first thread synchronizing on it, other threads revoke
+ ** the bias (expensive, once per struct) and use mutex.
+ **
+ ** Biased mode cannot be combined with posix shared env
+ ** (HAVE_CMX_ENV_POSIX_SHARED): forked child has the same thread id
+ ** as its parent and both would take owner's path.
+ **
+ **     #define CMX_STRUCT_SHAREABLE_BIASED 1
+ **     #include <cmx.h>
  **/
 
 #include <cmx/cmx-env.h>
 #include <cmx/cmx-token.h>
 #include <cmx/cmx-meta.h>
 #include <cmx/cmx-synchronize.h>
+#include <cmx/cmx-struct-refs.h>
+
+#ifdef CMX_STRUCT_SHAREABLE_BIASED
+#  ifdef HAVE_CMX_ENV_POSIX_SHARED
+#error "CMX_STRUCT_SHAREABLE_BIASED cannot be used with HAVE_CMX_ENV_POSIX_SHARED, biased lock cannot be shared by processes"
+#  endif
+
+#include <cmx/cmx-biased-lock.h>
+
+#define CMX_STRUCT_SHAREABLE_LOCK_TYPE                                  \
+    struct CMX_Biased_Lock
+
+#define CMX_STRUCT_SHAREABLE_LOCK_INIT(Var)                             \
+    CMX_BIASED_LOCK_INIT (& (Var))
+
+#define CMX_STRUCT_SHAREABLE_LOCK(Var)                                  \
+    cmx_biased_lock_acquire (& (Var))
+
+#define CMX_STRUCT_SHAREABLE_UNLOCK(Var, Biased)                        \
+    cmx_biased_lock_release (& (Var), (Biased))
+
+#define CMX_STRUCT_SHAREABLE_LOCK_MUTEX(Var)                            \
+    CMX_BIASED_LOCK_MUTEX (& (Var))
+
+#else
+
+#define CMX_STRUCT_SHAREABLE_LOCK_TYPE                                  \
+    CMX_MUTEX_TYPE
+/**<Implementation macro: type of struct lock (mutex or biased lock)
+ **/
+
+#define CMX_STRUCT_SHAREABLE_LOCK_INIT(Var)                             \
+    CMX_MUTEX_INIT (Var)
+
+#define CMX_STRUCT_SHAREABLE_LOCK(Var)                                  \
+    (CMX_MUTEX_LOCK (Var), 0)
+/**<Implementation macro: lock, evaluates TRUE if lock is biased
+ **/
+
+#define CMX_STRUCT_SHAREABLE_UNLOCK(Var, Biased)                        \
+    ((void) (Biased), CMX_MUTEX_UNLOCK (Var))
+
+#define CMX_STRUCT_SHAREABLE_LOCK_MUTEX(Var)                            \
+    (& (Var))
+/**<Implementation macro: pointer to mutex usable by CMX_MUTEX_LOCK
+ **/
+
+#endif
 
 struct _CMX_Struct_Shareable {
-    int enabled;
-    CMX_MUTEX_TYPE mutex;
+    CMX_ATOMIC_INT_TYPE enabled;
+    CMX_STRUCT_SHAREABLE_LOCK_TYPE mutex;
 };
 
+#define CMX_STRUCT_SHAREABLE_UNSHARED                                   \
+    0
+/**<Value of enabled member: struct is not shared
+ **/
+
+#define CMX_STRUCT_SHAREABLE_INITIALIZING                               \
+    1
+/**<Value of enabled member: mutex is being initialized by
+ ** CMX_STRUCT_SHAREABLE_SHARE()
+ **/
+
+#define CMX_STRUCT_SHAREABLE_SHARED                                     \
+    2
+/**<Value of enabled member: struct is shared, mutex is initialized
+ **/
+
 #ifndef CMX_STRUCT_SHAREABLE_NAME
 #define CMX_STRUCT_SHAREABLE_NAME                                       \
     cmx_struct_shareable
@@ -144,7 +223,10 @@ struct _CMX_Struct_Shareable {
 #define CMX_STRUCT_SHAREABLE_INIT(Ptr)                                  \
     do {                                                                \
         if (NULL != (Ptr))                                              \
-            (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled = 0;               \
+            CMX_ATOMIC_INT_SET (                                        \
+                (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled,               \
+                CMX_STRUCT_SHAREABLE_UNSHARED                           \
+            );                                                          \
     } while (0);
 /**
  **<@brief Initialize data declared by CMX_STRUCT_SHAREABLE_DEFINE
@@ -153,6 +235,30 @@ struct _CMX_Struct_Shareable {
  ** memory unless you clear whole structure with zeros (bzero())
  **/
 
+static CMX_COLD int
+cmx_struct_shareable_wait (CMX_ATOMIC_INT_TYPE *enabled) {
+    while (CMX_STRUCT_SHAREABLE_SHARED != CMX_ATOMIC_INT_LOAD (*enabled))
+        CMX_THREAD_YIELD ();
+
+    return 1;
+}
+/**<Implementation function
+ **
+ ** Wait until other thread finishes CMX_STRUCT_SHAREABLE_SHARE(),
+ ** returns TRUE.
+ **/
+
+static CMX_COLD void
+cmx_struct_shareable_publish (struct _CMX_Struct_Shareable *shareable) {
+    CMX_STRUCT_SHAREABLE_LOCK_INIT (shareable->mutex);
+    CMX_ATOMIC_INT_STORE (shareable->enabled, CMX_STRUCT_SHAREABLE_SHARED);
+}
+/**<Implementation function
+ **
+ ** Initialize mutex of struct won by CMX_STRUCT_SHAREABLE_SHARE()
+ ** and publish it.
+ **/
+
 #define CMX_STRUCT_SHAREABLE_SHARE(Ptr)                                 \
     CMX_STRUCT_SHAREABLE_SHARE_TRAN (                                   \
         CMX_UNIQUE_TOKEN (CMX_STRUCT_SHAREABLE_SHARE),                  \
@@ -166,6 +272,11 @@ struct _CMX_Struct_Shareable {
  ** BLOCK is executed only once, when share is enabled
  ** ELSE is executed otherwise.
  **
+ ** Macro is thread safe and lock-free: threads sharing same struct
+ ** concurrently race with compare-and-swap on enabled member, winner
+ ** initializes mutex and publishes it (release store), others wait
+ ** until it is published so mutex is usable once macro returns.
+ **
  ** Macro returns its argument
  ** Macro generates NULL safe code (BLOCK is not executed then)
  ** Macro allows 'break' in BLOCK.
@@ -176,11 +287,15 @@ struct _CMX_Struct_Shareable {
  ** Uses:
  ** - CMX_STRUCT_SHAREABLE_NAME
  ** - CMX_MUTEX_INIT
+ ** - CMX_ATOMIC_INT_LOAD
+ ** - CMX_ATOMIC_INT_STORE
+ ** - CMX_ATOMIC_INT_COMPARE_EXCHANGE
  ** - CMX_META_BODY_ELSE_BREAK
  **/
 
 #define CMX_STRUCT_SHAREABLE_SHARE_TRAN(Prefix, Ptr)                    \
     CMX_STRUCT_SHAREABLE_SHARE_IMPL (                                   \
+        CMX_TOKEN (Prefix, Expected),                                   \
         CMX_TOKEN (Prefix, Body),                                       \
         CMX_TOKEN (Prefix, Else),                                       \
         CMX_TOKEN (Prefix, Finish),                                     \
@@ -191,16 +306,28 @@ struct _CMX_Struct_Shareable {
  ** by implementation macro.
  **/
 
-#define CMX_STRUCT_SHAREABLE_SHARE_IMPL(Body, Else, Finish, Ptr)        \
+#define CMX_STRUCT_SHAREABLE_SHARE_IMPL(Expected, Body, Else, Finish, Ptr) \
     if (1) {                                                            \
-        if (NULL != (Ptr)) {                                            \
-            if (! ((Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled)) {         \
-                (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled = 1;           \
-                CMX_MUTEX_INIT (                                        \
-                    (Ptr)->CMX_STRUCT_SHAREABLE_NAME.mutex              \
+        int Expected;                                                   \
+        if (CMX_LIKELY (NULL != (Ptr))) {                               \
+            Expected = CMX_ATOMIC_INT_LOAD (                            \
+                (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled                \
+            );                                                          \
+            if (CMX_STRUCT_SHAREABLE_UNSHARED == Expected               \
+                && CMX_ATOMIC_INT_COMPARE_EXCHANGE (                    \
+                    (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled,           \
+                    Expected,                                           \
+                    CMX_STRUCT_SHAREABLE_INITIALIZING                   \
+                )) {                                                    \
+                cmx_struct_shareable_publish (                          \
+                    & (Ptr)->CMX_STRUCT_SHAREABLE_NAME                  \
                 );                                                      \
                 goto Body;                                              \
             } else {                                                    \
+                if (CMX_UNLIKELY (CMX_STRUCT_SHAREABLE_SHARED != Expected)) \
+                    cmx_struct_shareable_wait (                         \
+                        & (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled      \
+                    );                                                  \
                 goto Else;                                              \
             }                                                           \
         }                                                               \
@@ -209,6 +336,43 @@ struct _CMX_Struct_Shareable {
     } else CMX_META_BODY_ELSE_BREAK (Body, Else, Finish)
 /**
  **<Implementation macro
+ **
+ ** Implementation notes
+ ** - load first, already shared struct is not written to
+ ** - first share (mutex initialization) is out of line
+ ** - mutex is initialized before SHARED is stored (release),
+ **   so acquire load of SHARED guarantees initialized mutex
+ **/
+
+#define CMX_STRUCT_SHAREABLE_MUTEX(Ptr)                                 \
+    (NULL == (Ptr)                                                      \
+        ? NULL                                                          \
+        : cmx_struct_shareable_mutex (& (Ptr)->CMX_STRUCT_SHAREABLE_NAME))
+/**
+ **<@brief Pointer to struct mutex, NULL if struct is not shared
+ **
+ ** Intended for CMX_SYNCHRONIZE_MULTI() which skips NULL mutexes,
+ ** to lock several shareable structs at once.
+ **
+ ** @param Ptr struct pointer (evaluated twice)
+ **
+ ** Usage:
+ **   CMX_SYNCHRONIZE_MULTI (
+ **     CMX_STRUCT_SHAREABLE_MUTEX (from),
+ **     CMX_STRUCT_SHAREABLE_MUTEX (to)
+ **   ) { ... }
+ **/
+
+static inline CMX_MUTEX_TYPE *
+cmx_struct_shareable_mutex (struct _CMX_Struct_Shareable *shareable) {
+    int enabled = CMX_ATOMIC_INT_LOAD (shareable->enabled);
+
+    if (CMX_UNLIKELY (CMX_STRUCT_SHAREABLE_INITIALIZING == enabled))
+        enabled = cmx_struct_shareable_wait (&shareable->enabled);
+
+    return enabled ? CMX_STRUCT_SHAREABLE_LOCK_MUTEX (shareable->mutex) : NULL;
+}
+/**<Implementation function
  **/
 
 #define CMX_STRUCT_SHAREABLE_SYNCHRONIZE(Ptr)                           \
@@ -230,7 +394,8 @@ struct _CMX_Struct_Shareable {
  **
  ** Uses:
  ** - CMX_STRUCT_SHAREABLE_NAME
- ** - CMX_MUTEX_LOCK
+ ** - CMX_ATOMIC_INT_LOAD
+ ** - CMX_MUTEX_LOCK (or biased lock, see CMX_STRUCT_SHAREABLE_BIASED)
  ** - CMX_MUTEX_UNLOCK
  ** - CMX_META_BODY_BREAK
  **
@@ -246,6 +411,7 @@ struct _CMX_Struct_Shareable {
 #define CMX_STRUCT_SHAREABLE_SYNCHRONIZE_TRAN(Prefix, Ptr)              \
     CMX_STRUCT_SHAREABLE_SYNCHRONIZE_IMPL (                             \
         CMX_TOKEN (Prefix, Enabled),                                    \
+        CMX_TOKEN (Prefix, Biased),                                     \
         CMX_TOKEN (Prefix, Body),                                       \
         CMX_TOKEN (Prefix, Finish),                                     \
         (Ptr)                                                           \
@@ -255,18 +421,31 @@ struct _CMX_Struct_Shareable {
  ** by implementation macro.
  **/
 
-#define CMX_STRUCT_SHAREABLE_SYNCHRONIZE_IMPL(Enabled, Body, Finish, Ptr) \
+#define CMX_STRUCT_SHAREABLE_SYNCHRONIZE_IMPL(Enabled, Biased, Body, Finish, Ptr) \
     if (1) {                                                            \
         int Enabled = 0;                                                \
-        if ((NULL != (Ptr))) {                                          \
-            Enabled = (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled;         \
+        int Biased = 0;                                                 \
+        if (CMX_LIKELY (NULL != (Ptr))) {                               \
+            Enabled = CMX_ATOMIC_INT_LOAD (                             \
+                (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled                \
+            );                                                          \
+            if (CMX_UNLIKELY (CMX_STRUCT_SHAREABLE_INITIALIZING == Enabled)) \
+                Enabled = cmx_struct_shareable_wait (                   \
+                    & (Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled          \
+                );                                                      \
+            Enabled = Enabled && ! CMX_SINGLE_THREAD_P ();              \
             if (Enabled)                                                \
-                CMX_MUTEX_LOCK ((Ptr)->CMX_STRUCT_SHAREABLE_NAME.mutex); \
+                Biased = CMX_STRUCT_SHAREABLE_LOCK (                    \
+                    (Ptr)->CMX_STRUCT_SHAREABLE_NAME.mutex              \
+                );                                                      \
             goto Body;                                                  \
         }                                                               \
     Finish:                                                             \
         if (Enabled)                                                    \
-            CMX_MUTEX_UNLOCK ((Ptr)->CMX_STRUCT_SHAREABLE_NAME.mutex);  \
+            CMX_STRUCT_SHAREABLE_UNLOCK (                               \
+                (Ptr)->CMX_STRUCT_SHAREABLE_NAME.mutex,                 \
+                Biased                                                  \
+            );                                                          \
     } else CMX_META_BODY_BREAK (Body, Finish)
 /**
  **<Implementation macro
@@ -274,7 +453,81 @@ struct _CMX_Struct_Shareable {
  ** Implementation notes
  ** - if Struct ptr is NULL, skip protected block
  ** - if synchronization is not enabled, skip mutex
+ ** - if share is in progress, wait (out of line) until mutex is initialized
+ ** - if process is single threaded, skip mutex
  ** - synchronization status is preserved locally to prevent unlock without lock
  **/
 
+#define CMX_STRUCT_SHAREABLE_REFS_INCREMENT(Ptr)                        \
+    (CMX_ATOMIC_INT_LOAD ((Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled)     \
+        ? (void) CMX_STRUCT_REFS_INCREMENT (Ptr)                        \
+        : (void) ++ (Ptr)->CMX_STRUCT_REFS_NAME)
+/**
+ **<@brief Increment ref counter of shareable struct
+ **
+ ** Unshared struct is owned by single thread so plain increment is used,
+ ** atomic one only after CMX_STRUCT_SHAREABLE_SHARE().
+ ** Ptr must not be NULL.
+ **
+ ** Uses:
+ ** - CMX_STRUCT_SHAREABLE_NAME
+ ** - CMX_STRUCT_REFS_INCREMENT
+ ** - CMX_STRUCT_REFS_NAME
+ **/
+
+#define CMX_STRUCT_SHAREABLE_REFS_DECREMENT_AND_TEST(Ptr)               \
+    (CMX_ATOMIC_INT_LOAD ((Ptr)->CMX_STRUCT_SHAREABLE_NAME.enabled)     \
+        ? CMX_STRUCT_REFS_DECREMENT_AND_TEST (Ptr)                      \
+        : 0 == -- (Ptr)->CMX_STRUCT_REFS_NAME)
+/**
+ **<@brief Decrement ref counter of shareable struct,
+ ** evaluates TRUE when it drops to zero
+ **
+ ** Same rules as CMX_STRUCT_SHAREABLE_REFS_INCREMENT().
+ **/
+
+#define CMX_STRUCT_SHAREABLE_REFS_REF(Ptr)                              \
+    CMX_STRUCT_REFS_REF_TRAN (                                          \
+        CMX_STRUCT_SHAREABLE_REFS_INCREMENT,                            \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_SHAREABLE_REFS_REF),               \
+        (Ptr)                                                           \
+    )
+/**
+ **<@brief Defines ref function body of struct using both
+ ** CMX_STRUCT_REFS_DEFINE and CMX_STRUCT_SHAREABLE_DEFINE
+ **
+ ** Same as CMX_STRUCT_REFS_REF() but ref counter is updated atomically
+ ** only if struct is shared.
+ **
+ ** Struct must be shared before its pointer is published to other thread
+ ** (including insertion into shared container), otherwise concurrent
+ ** plain updates may lose references.
+ **
+ ** Usage:
+ **   struct XYZ * xyz_ref (struct XYZ *self) {
+ **     CMX_STRUCT_SHAREABLE_REFS_REF (self);
+ **   }
+ **/
+
+#define CMX_STRUCT_SHAREABLE_REFS_UNREF(Ptr)                            \
+    CMX_STRUCT_REFS_UNREF_TRAN (                                        \
+        CMX_STRUCT_SHAREABLE_REFS_DECREMENT_AND_TEST,                   \
+        (Ptr),                                                          \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_SHAREABLE_REFS_UNREF)              \
+    )
+/**
+ **<@brief Defines unref function body of struct using both
+ ** CMX_STRUCT_REFS_DEFINE and CMX_STRUCT_SHAREABLE_DEFINE
+ **
+ ** Same as CMX_STRUCT_REFS_UNREF(), same rules as
+ ** CMX_STRUCT_SHAREABLE_REFS_REF().
+ **
+ ** Usage:
+ **   void xyz_unref (struct XYZ *self) {
+ **     CMX_STRUCT_SHAREABLE_REFS_UNREF (self) {
+ **       xyz_free (self);
+ **     }
+ **   }
+ **/
+
 #endif  /* header guard */
@@ -0,0 +1,517 @@
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Live object and reference counting statistics per struct type.
+ **
+ ** @section Idea behind
+ **
+ ** Leaks and object churn are visible in numbers of created, destroyed
+ ** and living objects of given type. Counting them in one shared
+ ** variable makes every constructor / ref / unref contend on single
+ ** cache line, so counters are sharded: every thread is assigned one
+ ** of CMX_STRUCT_STATS_SHARDS cache line sized shards and increments
+ ** only its counters. Reader sums all shards.
+ **
+ ** Statistics are collected by _STATS variants of CMX_STRUCT_REFS_
+ ** macros using per-type descriptor. Descriptor is registered in global
+ ** lock-free list by first CMX_STRUCT_REFS_INIT_STATS of its type.
+ **
+ ** Peak live count is sampled (every CMX_STRUCT_STATS_PEAK_INTERVAL
+ ** objects created by thread's shard and by every snapshot), so it may
+ ** miss up to INTERVAL objects per shard. Rates are computed by snapshot
+ ** as difference since previous snapshot.
+ **
+ ** References taken by CMX_STRUCT_REFS_INCREMENT (containers) are not
+ ** counted.
+ **
+ ** Statistics are compiled in only when CMX_STRUCT_STATS_ENABLED
+ ** is defined, otherwise _STATS macros are plain CMX_STRUCT_REFS_
+ ** macros and CMX_STRUCT_STATS_FOREACH iterates nothing.
+ **
+ ** Macros require environment with CMX_THREAD_LOCAL and CMX_ATOMIC_
+ ** defined. Enabled statistics require POSIX clock_gettime (), strict
+ ** ISO C builds (-std=c99, -std=c11) have to define _POSIX_C_SOURCE
+ ** 199309L or later.
+ **
+ ** @section Proposed usage
+ **
+ **     // exactly one translation unit
+ **     CMX_STRUCT_STATS_STORAGE;
+ **     CMX_STRUCT_STATS_TYPE_STORAGE (Job);
+ **
+ **     struct Job * job_new (void) {
+ **         ...
+ **         CMX_STRUCT_REFS_INIT_STATS (retval, Job);
+ **     }
+ **
+ **     struct Job * job_ref (struct Job *self) {
+ **         CMX_STRUCT_REFS_REF_STATS (self, Job);
+ **     }
+ **
+ **     void job_unref (struct Job *self) {
+ **         CMX_STRUCT_REFS_UNREF_STATS (self, Job) { free (self); }
+ **     }
+ **
+ **     struct CMX_Struct_Stats_Snapshot snapshot;
+ **     CMX_STRUCT_STATS_FOREACH (snapshot)
+ **         metrics_gauge (snapshot.name, "live", snapshot.live);
+ **
+ **     CMX_STRUCT_STATS_DUMP (stderr);
+ **/
+
+#ifndef CMX_STRUCT_STATS_H
+#define CMX_STRUCT_STATS_H 1
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-meta.h>
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-struct-refs.h>
+
+#ifndef CMX_STRUCT_STATS_SHARDS
+#define CMX_STRUCT_STATS_SHARDS                                         \
+    16
+/**<Number of counter shards per type, must be power of two
+ **
+ ** You can override default value defining this macro before including cmx.h
+ **/
+#endif
+
+#ifndef CMX_STRUCT_STATS_PEAK_INTERVAL
+#define CMX_STRUCT_STATS_PEAK_INTERVAL                                  \
+    64
+/**<Shard samples peak live count every INTERVAL created objects,
+ ** must be power of two
+ **
+ ** You can override default value defining this macro before including cmx.h
+ **/
+#endif
+
+struct CMX_Struct_Stats_Snapshot {
+    const char *name;
+    size_t live;
+    size_t peak;
+    size_t created;
+    size_t destroyed;
+    size_t refs;
+    size_t unrefs;
+    double destroy_rate;
+    double ref_rate;
+    double unref_rate;
+};
+/**<Statistics of one struct type
+ **
+ ** Rates are per second, since previous snapshot.
+ **/
+
+#define CMX_STRUCT_STATS_FOREACH(Snapshot)                              \
+    CMX_STRUCT_STATS_FOREACH_TRAN (                                     \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_STATS_FOREACH),                    \
+        Snapshot                                                        \
+    )
+/**<Evaluate following statement / block for every registered type
+ **
+ ** Snapshot (struct CMX_Struct_Stats_Snapshot variable) is filled
+ ** with statistics of every type.
+ **
+ ** Must not be evaluated by multiple threads at the same time.
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** Usage:
+ **   struct CMX_Struct_Stats_Snapshot snapshot;
+ **   CMX_STRUCT_STATS_FOREACH (snapshot) { ... }
+ **/
+
+#define CMX_STRUCT_STATS_FOREACH_TRAN(Prefix, Snapshot)                 \
+    CMX_STRUCT_STATS_FOREACH_IMPL (                                     \
+        CMX_TOKEN (Prefix, Type),                                       \
+        Snapshot                                                        \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_STRUCT_STATS_DUMP(File)                                     \
+    cmx_struct_stats_dump (File)
+/**<Write statistics of every registered type into FILE *
+ **
+ ** One line per type. Same rules as CMX_STRUCT_STATS_FOREACH.
+ ** Returns number of types.
+ **/
+
+#ifdef CMX_STRUCT_STATS_ENABLED
+
+#include <time.h>
+
+#ifndef CLOCK_MONOTONIC
+#error "CMX_STRUCT_STATS_ENABLED requires clock_gettime (), define _POSIX_C_SOURCE 199309L or later"
+#endif
+
+#define CMX_STRUCT_STATS_CREATED                                        \
+    0
+/**<Counter index: objects created
+ **/
+
+#define CMX_STRUCT_STATS_DESTROYED                                      \
+    1
+/**<Counter index: objects destroyed
+ **/
+
+#define CMX_STRUCT_STATS_REFS                                           \
+    2
+/**<Counter index: ref operations
+ **/
+
+#define CMX_STRUCT_STATS_UNREFS                                         \
+    3
+/**<Counter index: unref operations
+ **/
+
+struct _CMX_Struct_Stats_Shard {
+    CMX_ATOMIC_SIZE_TYPE counter[4];
+    char padding[CMX_CACHE_LINE_SIZE];
+};
+
+struct _CMX_Struct_Stats_Type {
+    const char *name;
+    struct _CMX_Struct_Stats_Type *next;
+    CMX_ATOMIC_INT_TYPE registered;
+    CMX_ATOMIC_SIZE_TYPE peak;
+    size_t last[4];
+    double last_time;
+    struct _CMX_Struct_Stats_Shard shards[CMX_STRUCT_STATS_SHARDS];
+};
+
+struct _CMX_Struct_Stats {
+    CMX_ATOMIC_PTR_TYPE (struct _CMX_Struct_Stats_Type) types;
+    CMX_ATOMIC_SIZE_TYPE threads;
+};
+
+extern struct _CMX_Struct_Stats cmx_struct_stats;
+extern CMX_THREAD_LOCAL unsigned int cmx_struct_stats_shard;
+
+#define CMX_STRUCT_STATS_STORAGE                                        \
+    struct _CMX_Struct_Stats cmx_struct_stats;                          \
+    CMX_THREAD_LOCAL unsigned int cmx_struct_stats_shard
+/**<Define statistics registry storage
+ **
+ ** Must be used exactly once in program, at file scope.
+ **/
+
+#define CMX_STRUCT_STATS_TYPE(Name)                                     \
+    cmx_struct_stats_type_##Name
+/**<Name of per-type descriptor variable
+ **/
+
+#define CMX_STRUCT_STATS_TYPE_STORAGE(Name)                             \
+    struct _CMX_Struct_Stats_Type CMX_STRUCT_STATS_TYPE (Name) = {      \
+        .name = CMX_STRINGIFY (Name)                                    \
+    }
+/**<Define descriptor of type Name
+ **
+ ** Must be used exactly once per type, at file scope.
+ **
+ ** @param Name identifier used as type name in statistics
+ **             (eg. Job for struct Job)
+ **/
+
+#define CMX_STRUCT_STATS_TYPE_EXTERN(Name)                              \
+    extern struct _CMX_Struct_Stats_Type CMX_STRUCT_STATS_TYPE (Name)
+/**<Declare descriptor of type Name (eg. in header)
+ **/
+
+#define CMX_STRUCT_REFS_INIT_STATS(Ptr, Name)                           \
+    (CMX_STRUCT_REFS_INIT (Ptr),                                        \
+     cmx_struct_stats_created (& CMX_STRUCT_STATS_TYPE (Name)))
+/**<Initialize ref counter and count created object of type Name
+ **
+ ** Uses:
+ ** - CMX_STRUCT_REFS_INIT
+ **/
+
+#define CMX_STRUCT_REFS_REF_STATS(Ptr, Name)                            \
+    CMX_STRUCT_REFS_REF_STATS_TRAN (                                    \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_REFS_REF_STATS),                   \
+        (Ptr),                                                          \
+        & CMX_STRUCT_STATS_TYPE (Name)                                  \
+    )
+/**<Define body of ref function counting ref operations of type Name
+ **
+ ** Same rules as CMX_STRUCT_REFS_REF
+ **/
+
+#define CMX_STRUCT_REFS_REF_STATS_TRAN(Prefix, Ptr, Type)               \
+    CMX_STRUCT_REFS_REF_STATS_IMPL (                                    \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Finish),                                     \
+        (Ptr),                                                          \
+        Type                                                            \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_STRUCT_REFS_REF_STATS_IMPL(Body, Finish, Ptr, Type)         \
+    if (1) {                                                            \
+        if (NULL != (Ptr)) {                                            \
+            CMX_STRUCT_REFS_INCREMENT (Ptr);                            \
+            cmx_struct_stats_count ((Type), CMX_STRUCT_STATS_REFS);     \
+            goto Body;                                                  \
+        }                                                               \
+    Finish:                                                             \
+        return (Ptr);                                                   \
+    } CMX_META_BODY_BREAK (Body, Finish)
+/**<Implementation macro
+ **/
+
+#define CMX_STRUCT_REFS_UNREF_STATS(Ptr, Name)                          \
+    CMX_STRUCT_REFS_UNREF_STATS_TRAN (                                  \
+        CMX_UNIQUE_TOKEN (CMX_STRUCT_REFS_UNREF_STATS),                 \
+        (Ptr),                                                          \
+        & CMX_STRUCT_STATS_TYPE (Name)                                  \
+    )
+/**<Define unref function body counting unref operations
+ ** and destroyed objects of type Name
+ **
+ ** Same rules as CMX_STRUCT_REFS_UNREF
+ **/
+
+#define CMX_STRUCT_REFS_UNREF_STATS_TRAN(Prefix, Ptr, Type)             \
+    CMX_STRUCT_REFS_UNREF_STATS_IMPL (                                  \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Else),                                       \
+        (Ptr),                                                          \
+        Type                                                            \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#define CMX_STRUCT_REFS_UNREF_STATS_IMPL(Body, Else, Ptr, Type)         \
+    if (1) {                                                            \
+        if (NULL != (Ptr)) {                                            \
+            cmx_struct_stats_count ((Type), CMX_STRUCT_STATS_UNREFS);   \
+            if (! CMX_STRUCT_REFS_DECREMENT_AND_TEST (Ptr))             \
+                goto Else;                                              \
+            cmx_struct_stats_count ((Type), CMX_STRUCT_STATS_DESTROYED); \
+            goto Body;                                                  \
+        }                                                               \
+    } CMX_META_DO_ELSE_BREAK (Body, Else)
+/**<Implementation macro
+ **/
+
+#define CMX_STRUCT_STATS_FOREACH_IMPL(Type, Snapshot)                   \
+    for (struct _CMX_Struct_Stats_Type                                  \
+             *Type = CMX_ATOMIC_PTR_LOAD (cmx_struct_stats.types);      \
+         NULL != Type                                                   \
+             && (cmx_struct_stats_snapshot (Type, & (Snapshot)), 1);    \
+         Type = Type->next)
+/**<Implementation macro
+ **/
+
+static inline struct _CMX_Struct_Stats_Shard *
+cmx_struct_stats_shard_of (struct _CMX_Struct_Stats_Type *type) {
+    if (0 == cmx_struct_stats_shard)
+        cmx_struct_stats_shard = 1 + CMX_ATOMIC_SIZE_FETCH_ADD (cmx_struct_stats.threads, 1);
+
+    return &type->shards[(cmx_struct_stats_shard - 1) & (CMX_STRUCT_STATS_SHARDS - 1)];
+}
+/**<Implementation function
+ **
+ ** Threads are assigned shards round-robin by their first counting
+ **/
+
+static inline size_t
+cmx_struct_stats_count (struct _CMX_Struct_Stats_Type *type, int counter) {
+    struct _CMX_Struct_Stats_Shard *shard = cmx_struct_stats_shard_of (type);
+
+    return CMX_SINGLE_THREAD_P ()
+        ? shard->counter[counter]++
+        : CMX_ATOMIC_SIZE_FETCH_ADD (shard->counter[counter], 1);
+}
+/**<Implementation function
+ **
+ ** Returns previous counter value of current thread's shard.
+ ** Uses plain increment while process is single threaded.
+ **/
+
+static inline double
+cmx_struct_stats_clock (void) {
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+/**<Implementation function
+ **/
+
+static inline size_t
+cmx_struct_stats_sum (struct _CMX_Struct_Stats_Type *type, int counter) {
+    size_t retval = 0;
+    size_t i;
+
+    for (i = 0; i < CMX_STRUCT_STATS_SHARDS; ++i)
+        retval += CMX_ATOMIC_SIZE_LOAD (type->shards[i].counter[counter]);
+
+    return retval;
+}
+/**<Implementation function
+ **/
+
+static inline size_t
+cmx_struct_stats_sample_peak (struct _CMX_Struct_Stats_Type *type) {
+    size_t destroyed = cmx_struct_stats_sum (type, CMX_STRUCT_STATS_DESTROYED);
+    size_t created = cmx_struct_stats_sum (type, CMX_STRUCT_STATS_CREATED);
+    size_t live = created > destroyed ? created - destroyed : 0;
+    size_t peak = CMX_ATOMIC_SIZE_LOAD (type->peak);
+
+    while (peak < live)
+        if (CMX_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK (type->peak, peak, live))
+            break;
+
+    return live;
+}
+/**<Implementation function
+ **
+ ** Destroyed are summed first, so concurrent unrefs never make live
+ ** count lower than real one. Returns sampled live count.
+ **/
+
+static inline void
+cmx_struct_stats_register (struct _CMX_Struct_Stats_Type *type) {
+    struct _CMX_Struct_Stats_Type *head;
+    int expected = 0;
+
+    if (! CMX_ATOMIC_INT_COMPARE_EXCHANGE (type->registered, expected, 1))
+        return;
+
+    type->last_time = cmx_struct_stats_clock ();
+
+    head = CMX_ATOMIC_PTR_LOAD (cmx_struct_stats.types);
+    do
+        type->next = head;
+    while (! CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK (cmx_struct_stats.types, head, type));
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_struct_stats_created (struct _CMX_Struct_Stats_Type *type) {
+    if (! CMX_ATOMIC_INT_LOAD (type->registered))
+        cmx_struct_stats_register (type);
+
+    if (0 == (cmx_struct_stats_count (type, CMX_STRUCT_STATS_CREATED) & (CMX_STRUCT_STATS_PEAK_INTERVAL - 1)))
+        cmx_struct_stats_sample_peak (type);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_struct_stats_snapshot (
+    struct _CMX_Struct_Stats_Type *type,
+    struct CMX_Struct_Stats_Snapshot *snapshot
+) {
+    double now = cmx_struct_stats_clock ();
+    double elapsed = now - type->last_time;
+    size_t current[4];
+    size_t i;
+
+    snapshot->live = cmx_struct_stats_sample_peak (type);
+    for (i = 0; i < 4; ++i)
+        current[i] = cmx_struct_stats_sum (type, i);
+
+    snapshot->name = type->name;
+    snapshot->peak = CMX_ATOMIC_SIZE_LOAD (type->peak);
+    snapshot->created = current[CMX_STRUCT_STATS_CREATED];
+    snapshot->destroyed = current[CMX_STRUCT_STATS_DESTROYED];
+    snapshot->refs = current[CMX_STRUCT_STATS_REFS];
+    snapshot->unrefs = current[CMX_STRUCT_STATS_UNREFS];
+
+    if (elapsed <= 0)
+        elapsed = 1e-9;
+    snapshot->destroy_rate = (current[CMX_STRUCT_STATS_DESTROYED] - type->last[CMX_STRUCT_STATS_DESTROYED]) / elapsed;
+    snapshot->ref_rate = (current[CMX_STRUCT_STATS_REFS] - type->last[CMX_STRUCT_STATS_REFS]) / elapsed;
+    snapshot->unref_rate = (current[CMX_STRUCT_STATS_UNREFS] - type->last[CMX_STRUCT_STATS_UNREFS]) / elapsed;
+
+    for (i = 0; i < 4; ++i)
+        type->last[i] = current[i];
+    type->last_time = now;
+}
+/**<Implementation function
+ **
+ ** Live count comes from the same sample used to update peak,
+ ** so peak is never lower than reported live count.
+ **/
+
+#else  /* CMX_STRUCT_STATS_ENABLED */
+
+#define CMX_STRUCT_STATS_STORAGE                                        \
+    extern int cmx_struct_stats_disabled
+/**<Define statistics registry storage (statistics disabled)
+ **/
+
+#define CMX_STRUCT_STATS_TYPE_STORAGE(Name)                             \
+    extern int cmx_struct_stats_disabled
+/**<Define descriptor of type Name (statistics disabled)
+ **/
+
+#define CMX_STRUCT_STATS_TYPE_EXTERN(Name)                              \
+    extern int cmx_struct_stats_disabled
+/**<Declare descriptor of type Name (statistics disabled)
+ **/
+
+#define CMX_STRUCT_REFS_INIT_STATS(Ptr, Name)                           \
+    CMX_STRUCT_REFS_INIT (Ptr)
+/**<Initialize ref counter (statistics disabled)
+ **/
+
+#define CMX_STRUCT_REFS_REF_STATS(Ptr, Name)                            \
+    CMX_STRUCT_REFS_REF (Ptr)
+/**<Define body of ref function (statistics disabled)
+ **/
+
+#define CMX_STRUCT_REFS_UNREF_STATS(Ptr, Name)                          \
+    CMX_STRUCT_REFS_UNREF (Ptr)
+/**<Define unref function body (statistics disabled)
+ **/
+
+#define CMX_STRUCT_STATS_FOREACH_IMPL(Type, Snapshot)                   \
+    for ((void) (Snapshot); 0; )
+/**<Implementation macro (statistics disabled)
+ **/
+
+#endif  /* CMX_STRUCT_STATS_ENABLED */
+
+static inline size_t
+cmx_struct_stats_dump (FILE *file) {
+    struct CMX_Struct_Stats_Snapshot snapshot;
+    size_t retval = 0;
+
+    CMX_STRUCT_STATS_FOREACH (snapshot) {
+        fprintf (
+            file,
+            "%s: live %zu, peak %zu, created %zu, destroyed %zu (%.1f/s), refs %zu (%.1f/s), unrefs %zu (%.1f/s)\n",
+            snapshot.name,
+            snapshot.live,
+            snapshot.peak,
+            snapshot.created,
+            snapshot.destroyed,
+            snapshot.destroy_rate,
+            snapshot.refs,
+            snapshot.ref_rate,
+            snapshot.unrefs,
+            snapshot.unref_rate
+        );
+        ++retval;
+    }
+
+    return retval;
+}
+/**<Implementation function
+ **/
+
+#endif  /* header guard */
@@ -2,6 +2,8 @@
 #ifndef CMX_SYNCHRONIZE_INTERNAL_H
 #define CMX_SYNCHRONIZE_INTERNAL_H 1
 
+#include <stddef.h>
+
 #include <cmx/cmx-token.h>
 #include <cmx/cmx-meta.h>
 
@@ -44,12 +46,22 @@
     if (1) {                                                            \
         CMX_MUTEX_TYPE * Name;                                          \
         MUTEX_INIT (Name, Init);                                        \
-        CMX_MUTEX_LOCK (*Name);                                         \
+        if (CMX_SINGLE_THREAD_P ())                                     \
+            Name = NULL;                                                \
+        if (CMX_LIKELY (NULL != Name))                                  \
+            CMX_MUTEX_LOCK (*Name);                                     \
         DO_COND ((Cond), Body, Else);                                   \
     Finish:                                                             \
-        CMX_MUTEX_UNLOCK (*Name);                                       \
+        if (CMX_LIKELY (NULL != Name))                                  \
+            CMX_MUTEX_UNLOCK (*Name);                                   \
     } else DO_BODY (Body, Else, Finish)
 /**<Implementation macro
+ **
+ ** Mutex is skipped if it is NULL or process is single threaded,
+ ** Name (NULL) remembers that for Finish, so block never unlocks
+ ** mutex it didn't lock.
+ ** Locked path is hinted as likely (it is the one worth laying out
+ ** as fall-through), contention is handled out of line by env mutex.
  **
  ** @param MUTEX_TYPE What is internal variable (value or pointer)
  ** @param MUTEX_VAR  How to get MUTEX_TYPE from Init expression
@@ -58,9 +70,18 @@
  **/
 
 #define CMX_SYNCHRONIZE_INTERNAL_MUTEX_VALUE_INIT(Name, Init)           \
-    static CMX_MUTEX_TYPE Name##_static = Init;                         \
+    static CMX_MUTEX_TYPE Name##_static = Init ();                      \
     Name = &Name##_static;
 
+#define CMX_SYNCHRONIZE_INTERNAL_MUTEX_CREATE()                         \
+    CMX_MUTEX_CREATE
+/**<Deferred CMX_MUTEX_CREATE
+ **
+ ** Used as VALUE Init argument (without parentheses) so CMX_MUTEX_CREATE
+ ** is not expanded before it reaches initializer. Expansion may contain
+ ** commas (eg. PTHREAD_MUTEX_INITIALIZER).
+ **/
+
 #define CMX_SYNCHRONIZE_INTERNAL_MUTEX_PTR_INIT(Name, Init)             \
     Name = Init
 
@@ -71,7 +92,7 @@
     goto Body;
 
 #define CMX_SYNCHRONIZE_INTERNAL_DO_COND_BODY(Body, Else, Finish)       \
-    CMX_META_BODY_ELSE_BREAK (Body, Finish)
+    CMX_META_BODY_ELSE_BREAK (Body, Else, Finish)
 
 #define CMX_SYNCHRONIZE_INTERNAL_DO_COND_JUMP(Cond, Body, Else)         \
     if (Cond) goto Body; else goto Else;
@@ -2,6 +2,9 @@
 #ifndef CMX_SYNCHRONIZE_H
 #define CMX_SYNCHRONIZE_H 1
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <cmx/cmx-token.h>
 #include <cmx/cmx-meta.h>
 #include <cmx/cmx-synchronize-internal.h>
@@ -11,7 +14,7 @@
         VALUE,                                                          \
         DO,                                                             \
         CMX_UNIQUE_TOKEN (CMX_SYNCHRONIZE),                             \
-        CMX_MUTEX_CREATE,                                               \
+        CMX_SYNCHRONIZE_INTERNAL_MUTEX_CREATE,                          \
         1                                                               \
     )
 /**<Synchronize following block
@@ -50,7 +53,7 @@
         VALUE,                                                          \
         COND,                                                           \
         CMX_UNIQUE_TOKEN (CMX_SYNCHRONIZE_IF),                          \
-        CMX_MUTEX_CREATE,                                               \
+        CMX_SYNCHRONIZE_INTERNAL_MUTEX_CREATE,                          \
         Cond                                                            \
     )
 /**<Synchronize execution of following block with in-place mutex.
@@ -128,7 +131,7 @@
     CMX_SYNCHRONIZE                                                     \
     if (1) {                                                            \
         static int State = 0;                                           \
-        if (State == 0) {                                               \
+        if (CMX_UNLIKELY (State == 0)) {                                \
             State = 1;                                                  \
             goto Body;                                                  \
         } else                                                          \
@@ -137,4 +140,114 @@
 /**<Implementation macro
  **/
 
+#define CMX_SYNCHRONIZE_MULTI(...)                                      \
+    CMX_SYNCHRONIZE_MULTI_TRAN (                                        \
+        CMX_UNIQUE_TOKEN (CMX_SYNCHRONIZE_MULTI),                       \
+        __VA_ARGS__                                                     \
+    )
+/**<Synchronize following statement / block using multiple mutexes
+ **
+ ** Mutexes are sorted by address, duplicates and NULLs are removed,
+ ** then they are locked in that order, so blocks locking the same
+ ** mutexes cannot deadlock (ABBA). Mutexes are unlocked in reverse
+ ** order when block finishes (or break is evaluated).
+ **
+ ** Use CMX_STRUCT_SHAREABLE_MUTEX() to pass mutex of shareable struct,
+ ** it evaluates NULL if struct is not shared.
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single statement code.
+ **
+ ** @param ... CMX_MUTEX_TYPE pointers (NULL allowed)
+ **
+ ** Usage:
+ **   CMX_SYNCHRONIZE_MULTI (&from->mutex, &to->mutex) { ... }
+ **   CMX_SYNCHRONIZE_MULTI (
+ **       CMX_STRUCT_SHAREABLE_MUTEX (from),
+ **       CMX_STRUCT_SHAREABLE_MUTEX (to)
+ **   ) { ... }
+ **/
+
+#define CMX_SYNCHRONIZE_MULTI_TRAN(Prefix, ...)                         \
+    CMX_SYNCHRONIZE_MULTI_IMPL (                                        \
+        CMX_TOKEN (Prefix, Mutexes),                                    \
+        CMX_TOKEN (Prefix, Count),                                      \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Finish),                                     \
+        __VA_ARGS__                                                     \
+    )
+/**<Intermediate macro to expand params and produce
+ ** tokens used by implementation macro
+ **/
+
+#define CMX_SYNCHRONIZE_MULTI_IMPL(Mutexes, Count, Body, Finish, ...)   \
+    for (CMX_MUTEX_TYPE *Mutexes[] = { __VA_ARGS__ }, **Count = Mutexes; \
+         NULL != Count;                                                 \
+         Count = NULL)                                                  \
+        if (1) {                                                        \
+            Count = Mutexes + cmx_synchronize_multi_lock (              \
+                Mutexes,                                                \
+                sizeof (Mutexes) / sizeof (*Mutexes)                    \
+            );                                                          \
+            goto Body;                                                  \
+        Finish:                                                         \
+            cmx_synchronize_multi_unlock (Mutexes, Count - Mutexes);    \
+        } else CMX_META_BODY_BREAK (Body, Finish)
+/**<Implementation macro
+ **
+ ** Mutex array is declared by for statement so it lives until block
+ ** finishes, for statement is evaluated once.
+ ** Count points behind last locked mutex.
+ **/
+
+static inline int
+cmx_synchronize_multi_lock (CMX_MUTEX_TYPE **mutexes, int count) {
+    CMX_MUTEX_TYPE *mutex;
+    int unique = 0;
+    int i;
+    int j;
+    int k;
+
+    if (CMX_SINGLE_THREAD_P ())
+        return 0;
+
+    /* insertion sort (few mutexes), skipping NULLs and duplicates */
+    for (i = 0; i < count; ++i) {
+        mutex = mutexes[i];
+        if (NULL == mutex)
+            continue;
+
+        for (j = unique; j > 0 && (uintptr_t) mutexes[j - 1] > (uintptr_t) mutex; --j)
+            ;
+        if (j > 0 && mutexes[j - 1] == mutex)
+            continue;
+
+        for (k = unique; k > j; --k)
+            mutexes[k] = mutexes[k - 1];
+        mutexes[j] = mutex;
+        ++unique;
+    }
+
+    for (i = 0; i < unique; ++i)
+        CMX_MUTEX_LOCK (*mutexes[i]);
+
+    return unique;
+}
+/**<Implementation function
+ **
+ ** Sorts mutexes in place, returns number of locked mutexes
+ ** (stored at the beginning of array).
+ ** Mutexes are not locked while process is single threaded.
+ **/
+
+static inline void
+cmx_synchronize_multi_unlock (CMX_MUTEX_TYPE **mutexes, int count) {
+    (void) mutexes;     /* env may implement unlock as no-op */
+
+    while (count-- > 0)
+        CMX_MUTEX_UNLOCK (*mutexes[count]);
+}
+/**<Implementation function
+ **/
+
 #endif  /* header guard */
@@ -0,0 +1,131 @@
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Per-thread initialization without synchronization.
+ **
+ ** @section Idea behind
+ **
+ ** State lives in CMX_THREAD_LOCAL variables, so every thread has its
+ ** own copy and hot path is single thread-local read, without lock
+ ** or atomic operation.
+ **
+ ** CMX_THREAD_LAZY additionally registers destructor (CMX_THREAD_KEY_)
+ ** to release value when thread exits.
+ **
+ ** Macros require environment with CMX_THREAD_LOCAL defined,
+ ** CMX_THREAD_LAZY also CMX_THREAD_KEY_ and CMX_MUTEX_.
+ **
+ ** @section Proposed usage
+ **
+ **     CMX_RUN_ONCE_PER_THREAD {
+ **         register_thread ();
+ **     }
+ **
+ **     CMX_THREAD_LAZY (struct Scratch, scratch, scratch_init, scratch_destroy);
+ **
+ **     struct Scratch *s = scratch ();
+ **/
+
+#ifndef CMX_THREAD_LOCAL_H
+#define CMX_THREAD_LOCAL_H 1
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-meta.h>
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-synchronize.h>
+
+#define CMX_RUN_ONCE_PER_THREAD                                         \
+    CMX_RUN_ONCE_PER_THREAD_TRAN (                                      \
+        CMX_UNIQUE_TOKEN (CMX_RUN_ONCE_PER_THREAD)                      \
+    )
+/**<Keyword-like expression to evaluate following statement only once
+ ** in every thread.
+ ** Supports also optional else-clause evaluated on subsequent call.
+ **
+ ** Statement evaluation is not synchronized.
+ **
+ ** Macro generates break-safe code.
+ ** Macro generates single-statement code.
+ **
+ ** Usage:
+ **   CMX_RUN_ONCE_PER_THREAD { ... }
+ **   CMX_RUN_ONCE_PER_THREAD { ... } else { ... }
+ **/
+
+#define CMX_RUN_ONCE_PER_THREAD_TRAN(Prefix)                            \
+    CMX_RUN_ONCE_PER_THREAD_IMPL (                                      \
+        CMX_TOKEN (Prefix, State),                                      \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Else)                                        \
+    )
+/**<Intermediate macro to expand params and produce
+ ** tokens used by implementation macro
+ **/
+
+#define CMX_RUN_ONCE_PER_THREAD_IMPL(State, Body, Else)                 \
+    if (1) {                                                            \
+        static CMX_THREAD_LOCAL int State = 0;                          \
+        if (State == 0) {                                               \
+            State = 1;                                                  \
+            goto Body;                                                  \
+        } else                                                          \
+            goto Else;                                                  \
+    } else CMX_META_DO_ELSE_BREAK (Body, Else)
+/**<Implementation macro
+ **/
+
+#define CMX_THREAD_LAZY(Type, Name, Init, Destroy)                      \
+    static CMX_THREAD_LOCAL Type cmx_thread_lazy_##Name##_value;        \
+    static CMX_THREAD_LOCAL int cmx_thread_lazy_##Name##_ready;         \
+    static CMX_THREAD_KEY_TYPE cmx_thread_lazy_##Name##_key;            \
+                                                                        \
+    static inline void                                                  \
+    cmx_thread_lazy_##Name##_destroy (void *ptr) {                      \
+        cmx_thread_lazy_##Name##_ready = 0;                             \
+        Destroy ((Type *) ptr);                                         \
+    }                                                                   \
+                                                                        \
+    static inline Type *                                                \
+    cmx_thread_lazy_##Name##_create (void) {                            \
+        CMX_RUN_ONCE                                                    \
+            CMX_THREAD_KEY_INIT (                                       \
+                cmx_thread_lazy_##Name##_key,                           \
+                cmx_thread_lazy_##Name##_destroy                        \
+            );                                                          \
+        Init (&cmx_thread_lazy_##Name##_value);                         \
+        CMX_THREAD_KEY_SET (                                            \
+            cmx_thread_lazy_##Name##_key,                               \
+            &cmx_thread_lazy_##Name##_value                             \
+        );                                                              \
+        cmx_thread_lazy_##Name##_ready = 1;                             \
+        return &cmx_thread_lazy_##Name##_value;                         \
+    }                                                                   \
+                                                                        \
+    static inline Type *                                                \
+    Name (void) {                                                       \
+        return cmx_thread_lazy_##Name##_ready                           \
+            ? &cmx_thread_lazy_##Name##_value                           \
+            : cmx_thread_lazy_##Name##_create ();                       \
+    }                                                                   \
+                                                                        \
+    extern int cmx_thread_lazy_##Name##_unused
+/**<Define lazily initialized per-thread value
+ **
+ ** Defines function Type * Name (void) returning pointer to value
+ ** of current thread. Value is initialized by first call in every
+ ** thread, later calls only test thread-local flag.
+ **
+ ** @param Type    value type
+ ** @param Name    accessor function name
+ ** @param Init    function or macro: void Init (Type *)
+ ** @param Destroy function or macro: void Destroy (Type *),
+ **                called when thread exits (not for main thread
+ **                returning from main)
+ **
+ ** Usage (at file scope):
+ **   CMX_THREAD_LAZY (struct Scratch, scratch, scratch_init, scratch_free);
+ **/
+
+#endif  /* header guard */
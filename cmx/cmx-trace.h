@@ -0,0 +1,350 @@
+
+/** @file
+ **
+ ** @section Summary
+ **
+ ** Tracing spans recorded into per-thread buffers, exported
+ ** in Chrome trace event format (chrome://tracing, Perfetto).
+ **
+ ** @section Idea behind
+ **
+ ** CMX_TRACE reads clock before and after its block and appends single
+ ** complete event into ring buffer owned by current thread, so recording
+ ** takes no lock and touches no shared cache line. Buffers are registered
+ ** in global lock-free list when thread records its first span.
+ **
+ ** CMX_TRACE_FLUSH drains all buffers (it is the only consumer of every
+ ** ring), events recorded while buffer is full are dropped and counted.
+ **
+ ** Tracing is compiled in only when CMX_TRACE_ENABLED is defined,
+ ** otherwise CMX_TRACE executes its block without any overhead
+ ** and CMX_TRACE_STORAGE / CMX_TRACE_FLUSH do nothing.
+ **
+ ** Span name must be valid until flush (use string literals).
+ ** Buffers of finished threads stay registered (events are not lost).
+ **
+ ** Macros require environment with CMX_THREAD_LOCAL and CMX_ATOMIC_
+ ** defined. Enabled tracing requires POSIX clock_gettime (), strict ISO C
+ ** builds (-std=c99, -std=c11) have to define _POSIX_C_SOURCE 199309L
+ ** or later.
+ **
+ ** @section Proposed usage
+ **
+ **     // exactly one translation unit
+ **     CMX_TRACE_STORAGE;
+ **
+ **     void handle_request (...) {
+ **         CMX_TRACE ("handle_request") {
+ **             CMX_TRACE ("parse")
+ **                 parse (...);
+ **             ...
+ **         }
+ **     }
+ **
+ **     CMX_TRACE_FLUSH (file);
+ **/
+
+#ifndef CMX_TRACE_H
+#define CMX_TRACE_H 1
+
+#include <cmx/cmx-token.h>
+#include <cmx/cmx-meta.h>
+#include <cmx/cmx-env.h>
+
+#ifndef CMX_TRACE_BUFFER_SIZE
+#define CMX_TRACE_BUFFER_SIZE                                           \
+    4096
+/**<Number of events per thread buffer, must be power of two
+ **
+ ** You can override default value defining this macro before including cmx.h
+ **/
+#endif
+
+#define CMX_TRACE(Name)                                                 \
+    CMX_TRACE_TRAN (                                                    \
+        CMX_UNIQUE_TOKEN (CMX_TRACE),                                   \
+        (Name)                                                          \
+    )
+/**<Record execution of following block as span Name
+ **
+ ** Macro generates single statement expression.
+ ** Block can be terminated by break.
+ **
+ ** Usage:
+ **   CMX_TRACE ("name") { ... }
+ **/
+
+#define CMX_TRACE_TRAN(Prefix, Name)                                    \
+    CMX_TRACE_IMPL (                                                    \
+        CMX_TOKEN (Prefix, Start),                                      \
+        CMX_TOKEN (Prefix, Body),                                       \
+        CMX_TOKEN (Prefix, Finish),                                     \
+        (Name)                                                          \
+    )
+/**<Transient macro to expand arguments and define tokens required
+ ** by implementation macro
+ **/
+
+#ifdef CMX_TRACE_ENABLED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#ifndef CLOCK_MONOTONIC
+#error "CMX_TRACE_ENABLED requires clock_gettime (), define _POSIX_C_SOURCE 199309L or later"
+#endif
+
+#include <cmx/cmx-ring-spsc.h>
+
+#ifndef CMX_TRACE_TICKS
+#define CMX_TRACE_TICKS()                                               \
+    cmx_trace_clock ()
+/**<Timestamp of span enter / exit (uint64_t)
+ **
+ ** Default implementation reads CLOCK_MONOTONIC in nanoseconds.
+ **
+ ** You can provide cheaper clock (eg. invariant TSC, __builtin_ia32_rdtsc)
+ ** defining this macro before including cmx.h. Such ticks are converted
+ ** into nanoseconds by flush, using rate measured against CLOCK_MONOTONIC
+ ** since first recorded span.
+ **/
+#else
+#define CMX_TRACE_CALIBRATE 1
+#endif
+
+struct _CMX_Trace_Event {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+};
+
+struct _CMX_Trace_Buffer {
+    struct _CMX_Trace_Buffer *next;
+    unsigned int tid;
+    CMX_ATOMIC_SIZE_TYPE dropped;
+    CMX_RING_SPSC_DEFINE (struct _CMX_Trace_Event, CMX_TRACE_BUFFER_SIZE) events;
+};
+
+struct _CMX_Trace {
+    CMX_ATOMIC_PTR_TYPE (struct _CMX_Trace_Buffer) buffers;
+    CMX_ATOMIC_SIZE_TYPE threads;
+    CMX_ATOMIC_INT_TYPE calibrated;
+    uint64_t base_ticks;
+    uint64_t base_ns;
+};
+
+extern struct _CMX_Trace cmx_trace;
+extern CMX_THREAD_LOCAL struct _CMX_Trace_Buffer *cmx_trace_buffer;
+
+#define CMX_TRACE_STORAGE                                               \
+    struct _CMX_Trace cmx_trace;                                        \
+    CMX_THREAD_LOCAL struct _CMX_Trace_Buffer *cmx_trace_buffer
+/**<Define trace storage
+ **
+ ** Must be used exactly once in program, at file scope.
+ **/
+
+#define CMX_TRACE_FLUSH(File)                                           \
+    cmx_trace_flush (File)
+/**<Write recorded events into FILE * as Chrome trace JSON document
+ **
+ ** Must not be called by multiple threads at the same time.
+ ** Returns number of written events.
+ **/
+
+#define CMX_TRACE_IMPL(Start, Body, Finish, Name)                       \
+    if (1) {                                                            \
+        uint64_t Start = CMX_TRACE_TICKS ();                            \
+        goto Body;                                                      \
+    Finish:                                                             \
+        cmx_trace_record ((Name), Start, CMX_TRACE_TICKS ());           \
+    } else CMX_META_BODY_BREAK (Body, Finish)
+/**<Implementation macro
+ **/
+
+static inline uint64_t
+cmx_trace_clock (void) {
+    struct timespec now;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_trace_calibrate_start (void) {
+#ifdef CMX_TRACE_CALIBRATE
+    int expected = 0;
+
+    if (CMX_ATOMIC_INT_LOAD (cmx_trace.calibrated))
+        return;
+    if (! CMX_ATOMIC_INT_COMPARE_EXCHANGE (cmx_trace.calibrated, expected, 1))
+        return;
+
+    cmx_trace.base_ticks = CMX_TRACE_TICKS ();
+    cmx_trace.base_ns = cmx_trace_clock ();
+    CMX_ATOMIC_INT_STORE (cmx_trace.calibrated, 2);
+#endif
+}
+/**<Implementation function
+ **
+ ** Remember first (ticks, nanoseconds) pair used to compute ticks rate
+ **/
+
+static inline double
+cmx_trace_calibrate_rate (void) {
+#ifdef CMX_TRACE_CALIBRATE
+    uint64_t ticks = CMX_TRACE_TICKS ();
+    uint64_t ns = cmx_trace_clock ();
+
+    if (2 == CMX_ATOMIC_INT_LOAD (cmx_trace.calibrated) && ticks != cmx_trace.base_ticks)
+        return (double) (ns - cmx_trace.base_ns) / (double) (ticks - cmx_trace.base_ticks);
+#endif
+    return 1.0;
+}
+/**<Implementation function
+ **
+ ** Nanoseconds per tick (1.0 when ticks are nanoseconds)
+ **/
+
+static inline struct _CMX_Trace_Buffer *
+cmx_trace_buffer_create (void) {
+    struct _CMX_Trace_Buffer *buffer = calloc (1, sizeof (*buffer));
+    struct _CMX_Trace_Buffer *head;
+
+    if (NULL == buffer)
+        return NULL;
+
+    CMX_RING_SPSC_INIT (&buffer->events);
+    cmx_trace_calibrate_start ();
+    buffer->tid = 1 + CMX_ATOMIC_SIZE_FETCH_ADD (cmx_trace.threads, 1);
+
+    head = CMX_ATOMIC_PTR_LOAD (cmx_trace.buffers);
+    do
+        buffer->next = head;
+    while (! CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK (cmx_trace.buffers, head, buffer));
+
+    return cmx_trace_buffer = buffer;
+}
+/**<Implementation function
+ **
+ ** Allocate and register buffer of current thread
+ **/
+
+static inline void
+cmx_trace_record (const char *name, uint64_t start, uint64_t end) {
+    struct _CMX_Trace_Buffer *buffer = cmx_trace_buffer;
+
+    if (NULL == buffer && NULL == (buffer = cmx_trace_buffer_create ()))
+        return;
+
+    if (! CMX_RING_SPSC_RESERVE (&buffer->events, 1)) {
+        CMX_ATOMIC_SIZE_FETCH_ADD (buffer->dropped, 1);
+        return;
+    }
+
+    CMX_RING_SPSC_SLOT (&buffer->events, 0).name = name;
+    CMX_RING_SPSC_SLOT (&buffer->events, 0).start = start;
+    CMX_RING_SPSC_SLOT (&buffer->events, 0).end = end;
+    CMX_RING_SPSC_COMMIT (&buffer->events, 1);
+}
+/**<Implementation function
+ **/
+
+static inline void
+cmx_trace_write_string (FILE *file, const char *str) {
+    fputc ('"', file);
+    for (; *str; ++str) {
+        if ('"' == *str || '\\' == *str)
+            fputc ('\\', file);
+        if ((unsigned char) *str >= ' ')
+            fputc (*str, file);
+    }
+    fputc ('"', file);
+}
+/**<Implementation function
+ **
+ ** Control characters are skipped
+ **/
+
+static inline size_t
+cmx_trace_flush (FILE *file) {
+    struct _CMX_Trace_Buffer *buffer;
+    double rate = cmx_trace_calibrate_rate ();
+    size_t retval = 0;
+
+    fputs ("{\"traceEvents\":[", file);
+
+    for (buffer = CMX_ATOMIC_PTR_LOAD (cmx_trace.buffers); NULL != buffer; buffer = buffer->next) {
+        size_t dropped = CMX_ATOMIC_SIZE_EXCHANGE (buffer->dropped, 0);
+        size_t count = CMX_RING_SPSC_PEEK (&buffer->events, CMX_TRACE_BUFFER_SIZE);
+        size_t i;
+
+        for (i = 0; i < count; ++i) {
+            struct _CMX_Trace_Event *event = &CMX_RING_SPSC_ITEM (&buffer->events, i);
+
+            fputs (retval++ ? ",\n{\"name\":" : "\n{\"name\":", file);
+            cmx_trace_write_string (file, event->name);
+            fprintf (
+                file,
+                ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                buffer->tid,
+                (cmx_trace.base_ns + (double) (int64_t) (event->start - cmx_trace.base_ticks) * rate) / 1000.0,
+                (double) (event->end - event->start) * rate / 1000.0
+            );
+        }
+        CMX_RING_SPSC_RELEASE (&buffer->events, count);
+
+        if (dropped)
+            fprintf (
+                file,
+                "%s\n{\"name\":\"dropped %zu events\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                retval++ ? "," : "",
+                dropped,
+                buffer->tid,
+                cmx_trace_clock () / 1000.0
+            );
+    }
+
+    fputs ("\n]}\n", file);
+
+    return retval;
+}
+/**<Implementation function
+ **/
+
+#else  /* CMX_TRACE_ENABLED */
+
+#include <stddef.h>
+
+#define CMX_TRACE_STORAGE                                               \
+    extern int cmx_trace_disabled
+/**<Define trace storage (tracing disabled)
+ **/
+
+#define CMX_TRACE_FLUSH(File)                                           \
+    cmx_trace_flush (File)
+/**<Write recorded events (tracing disabled)
+ **/
+
+#define CMX_TRACE_IMPL(Start, Body, Finish, Name)                       \
+    if (1)                                                              \
+        goto Body;                                                      \
+    else CMX_META_DO_BREAK (Body)
+/**<Implementation macro (tracing disabled)
+ **/
+
+static inline size_t
+cmx_trace_flush (void *file) {
+    (void) file;
+    return 0;
+}
+/**<Implementation function (tracing disabled)
+ **/
+
+#endif  /* CMX_TRACE_ENABLED */
+
+#endif  /* header guard */
@@ -24,8 +24,23 @@
 #include <cmx/cmx-token.h>
 #include <cmx/cmx-meta.h>
 #include <cmx/cmx-local.h>
+#include <cmx/cmx-coro.h>
 #include <cmx/cmx-synchronize.h>
+#include <cmx/cmx-combiner.h>
+#include <cmx/cmx-barrier.h>
+#include <cmx/cmx-limit.h>
+#include <cmx/cmx-rseq.h>
+#include <cmx/cmx-thread-local.h>
+#include <cmx/cmx-lazy.h>
 #include <cmx/cmx-struct-refs.h>
+#include <cmx/cmx-struct-cow.h>
 #include <cmx/cmx-struct-shareable.h>
+#include <cmx/cmx-struct-list.h>
+#include <cmx/cmx-struct-rbtree.h>
+#include <cmx/cmx-queue-mpsc.h>
+#include <cmx/cmx-ring-spsc.h>
+#include <cmx/cmx-hashmap.h>
+#include <cmx/cmx-trace.h>
+#include <cmx/cmx-struct-stats.h>
 
 #endif
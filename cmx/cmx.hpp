@@ -0,0 +1,357 @@
+/** @file
+ **
+ ** @section Summary
+ **
+ ** C++ wrappers: intrusive pointer for CMX_STRUCT_REFS structs,
+ ** member traits and RAII synchronization guards.
+ **
+ ** @section Idea behind
+ **
+ ** Raw pointers passed through C++ code need explicit ref / unref
+ ** around every copy, and defensive pairs are added where ownership
+ ** is not obvious. cmx::ref_ptr<T> holds one reference: copy takes
+ ** reference, move only transfers pointer (no atomic operation),
+ ** destructor releases reference. Passing ref_ptr by value and moving
+ ** it transfers ownership across function boundaries without any
+ ** ref count traffic, borrowing is plain get ().
+ **
+ ** Reference is taken by CMX_STRUCT_REFS_INCREMENT (or
+ ** CMX_STRUCT_SHAREABLE_REFS_INCREMENT when struct is also shareable).
+ ** Reference is released by cmx_unref (T *) found by argument dependent
+ ** lookup (define it next to struct, usually calling its unref function),
+ ** or by specialization of cmx::ref_traits<T>.
+ **
+ ** Guards lock in constructor and unlock in destructor, with same rules
+ ** as corresponding block macros.
+ **
+ ** Requires C++11. Mutex / shareable guards require env with mutexes.
+ **
+ ** @section Proposed usage
+ **
+ **     void cmx_unref (struct Job *job) { job_unref (job); }
+ **
+ **     cmx::ref_ptr<Job> job = cmx::ref_ptr<Job>::adopt (job_new ());
+ **     queue.push_back (std::move (job));
+ **
+ **     {
+ **         cmx::shareable_guard guard (counter.get ());
+ **         ++ counter->value;
+ **     }
+ **/
+
+#ifndef CMX_HPP
+#define CMX_HPP 1
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+#include <cmx/cmx-env.h>
+#include <cmx/cmx-struct-refs.h>
+
+#ifdef CMX_MUTEX_TYPE
+#include <cmx/cmx-synchronize.h>
+#include <cmx/cmx-struct-shareable.h>
+#endif
+
+namespace cmx {
+
+template <typename...>
+struct make_void {
+    typedef void type;
+};
+/**<Implementation helper (std::void_t of C++17)
+ **/
+
+template <typename T, typename = void>
+struct has_refs : std::false_type { };
+
+template <typename T>
+struct has_refs<
+    T,
+    typename make_void<decltype (std::declval<T &> ().CMX_STRUCT_REFS_NAME)>::type
+> : std::true_type { };
+/**<Trait: T has member defined by CMX_STRUCT_REFS_DEFINE
+ **
+ ** Usage:
+ **   static_assert (cmx::has_refs<struct Job>::value, "...");
+ **/
+
+template <typename T, typename = void>
+struct has_shareable : std::false_type { };
+
+#ifdef CMX_STRUCT_SHAREABLE_NAME
+template <typename T>
+struct has_shareable<
+    T,
+    typename make_void<decltype (std::declval<T &> ().CMX_STRUCT_SHAREABLE_NAME)>::type
+> : std::true_type { };
+#endif
+/**<Trait: T has member defined by CMX_STRUCT_SHAREABLE_DEFINE
+ **/
+
+template <typename T>
+constexpr bool
+is_refcounted () {
+    return has_refs<T>::value;
+}
+/**<Constexpr function form of has_refs
+ **/
+
+template <typename T>
+constexpr bool
+is_shareable () {
+    return has_shareable<T>::value;
+}
+/**<Constexpr function form of has_shareable
+ **/
+
+template <typename T>
+inline void
+ref_increment (T *ptr, std::false_type) {
+    CMX_STRUCT_REFS_INCREMENT (ptr);
+}
+/**<Implementation function
+ **/
+
+#ifdef CMX_STRUCT_SHAREABLE_NAME
+template <typename T>
+inline void
+ref_increment (T *ptr, std::true_type) {
+    CMX_STRUCT_SHAREABLE_REFS_INCREMENT (ptr);
+}
+/**<Implementation function
+ **/
+#endif
+
+template <typename T>
+struct ref_traits {
+    static void
+    ref (T *ptr) {
+        ref_increment (ptr, has_shareable<T> ());
+    }
+
+    static void
+    unref (T *ptr) {
+        cmx_unref (ptr);
+    }
+};
+/**<How ref_ptr takes and releases reference of T
+ **
+ ** Specialize it for structs without cmx_unref (T *).
+ **/
+
+template <typename T, typename Traits = ref_traits<T> >
+class ref_ptr {
+    static_assert (has_refs<T>::value, "T must use CMX_STRUCT_REFS_DEFINE");
+
+    T *ptr;
+
+    explicit
+    ref_ptr (T *ptr) noexcept : ptr (ptr) { }
+
+public:
+    typedef T element_type;
+
+    ref_ptr () noexcept : ptr (nullptr) { }
+
+    ref_ptr (std::nullptr_t) noexcept : ptr (nullptr) { }
+
+    static ref_ptr
+    adopt (T *ptr) noexcept {
+        return ref_ptr (ptr);
+    }
+    /**<Take over caller's reference (eg. of newly created struct)
+     **/
+
+    static ref_ptr
+    ref (T *ptr) {
+        if (ptr)
+            Traits::ref (ptr);
+        return ref_ptr (ptr);
+    }
+    /**<Take new reference of borrowed pointer
+     **/
+
+    ref_ptr (const ref_ptr &other) : ptr (other.ptr) {
+        if (ptr)
+            Traits::ref (ptr);
+    }
+
+    ref_ptr (ref_ptr &&other) noexcept : ptr (other.ptr) {
+        other.ptr = nullptr;
+    }
+    /**<Move: reference is transferred, ref counter is not touched
+     **/
+
+    ~ref_ptr () {
+        if (ptr)
+            Traits::unref (ptr);
+    }
+
+    ref_ptr &
+    operator = (const ref_ptr &other) {
+        ref_ptr (other).swap (*this);
+        return *this;
+    }
+
+    ref_ptr &
+    operator = (ref_ptr &&other) noexcept {
+        ref_ptr (std::move (other)).swap (*this);
+        return *this;
+    }
+
+    ref_ptr &
+    operator = (std::nullptr_t) {
+        reset ();
+        return *this;
+    }
+
+    T *
+    get () const noexcept {
+        return ptr;
+    }
+    /**<Borrow pointer, reference stays owned by ref_ptr
+     **/
+
+    T *
+    release () noexcept {
+        T *retval = ptr;
+        ptr = nullptr;
+        return retval;
+    }
+    /**<Pass reference to caller (eg. to C code taking ownership)
+     **/
+
+    void
+    reset () {
+        ref_ptr ().swap (*this);
+    }
+
+    void
+    swap (ref_ptr &other) noexcept {
+        std::swap (ptr, other.ptr);
+    }
+
+    T &
+    operator * () const noexcept {
+        return *ptr;
+    }
+
+    T *
+    operator -> () const noexcept {
+        return ptr;
+    }
+
+    explicit
+    operator bool () const noexcept {
+        return nullptr != ptr;
+    }
+
+    friend bool
+    operator == (const ref_ptr &a, const ref_ptr &b) noexcept {
+        return a.ptr == b.ptr;
+    }
+
+    friend bool
+    operator != (const ref_ptr &a, const ref_ptr &b) noexcept {
+        return a.ptr != b.ptr;
+    }
+
+    friend bool
+    operator == (const ref_ptr &a, std::nullptr_t) noexcept {
+        return nullptr == a.ptr;
+    }
+
+    friend bool
+    operator != (const ref_ptr &a, std::nullptr_t) noexcept {
+        return nullptr != a.ptr;
+    }
+};
+/**<Intrusive pointer holding one reference of T
+ **
+ ** Usage:
+ **   cmx::ref_ptr<Job> a = cmx::ref_ptr<Job>::adopt (job_new ());
+ **   cmx::ref_ptr<Job> b = a;             // ref
+ **   cmx::ref_ptr<Job> c = std::move (a); // no ref count update
+ **/
+
+#ifdef CMX_MUTEX_TYPE
+
+class synchronize_guard {
+    CMX_MUTEX_TYPE *mutex;
+
+public:
+    explicit
+    synchronize_guard (CMX_MUTEX_TYPE *mutex) : mutex (mutex) {
+        if (CMX_SINGLE_THREAD_P ())
+            this->mutex = nullptr;
+        if (this->mutex)
+            CMX_MUTEX_LOCK (*this->mutex);
+    }
+
+    ~synchronize_guard () {
+        if (mutex)
+            CMX_MUTEX_UNLOCK (*mutex);
+    }
+
+    synchronize_guard (const synchronize_guard &) = delete;
+    synchronize_guard & operator = (const synchronize_guard &) = delete;
+};
+/**<Lock mutex for guard's scope, same as CMX_SYNCHRONIZE_WITH
+ **
+ ** NULL mutex is skipped, mutex is skipped while process is single
+ ** threaded.
+ **
+ ** Usage:
+ **   cmx::synchronize_guard guard (&big_global_mutex);
+ **/
+
+class shareable_guard {
+    struct _CMX_Struct_Shareable *shareable;
+    int biased;
+
+public:
+    template <typename T>
+    explicit
+    shareable_guard (T *ptr) : shareable (nullptr), biased (0) {
+        static_assert (has_shareable<T>::value, "T must use CMX_STRUCT_SHAREABLE_DEFINE");
+
+        int enabled;
+
+        if (nullptr == ptr)
+            return;
+
+        enabled = CMX_ATOMIC_INT_LOAD (ptr->CMX_STRUCT_SHAREABLE_NAME.enabled);
+        if (CMX_UNLIKELY (CMX_STRUCT_SHAREABLE_INITIALIZING == enabled))
+            enabled = cmx_struct_shareable_wait (&ptr->CMX_STRUCT_SHAREABLE_NAME.enabled);
+
+        if (enabled && ! CMX_SINGLE_THREAD_P ()) {
+            shareable = &ptr->CMX_STRUCT_SHAREABLE_NAME;
+            biased = CMX_STRUCT_SHAREABLE_LOCK (shareable->mutex);
+        }
+    }
+
+    ~shareable_guard () {
+        if (shareable)
+            CMX_STRUCT_SHAREABLE_UNLOCK (shareable->mutex, biased);
+    }
+
+    shareable_guard (const shareable_guard &) = delete;
+    shareable_guard & operator = (const shareable_guard &) = delete;
+};
+/**<Lock shareable struct for guard's scope,
+ ** same as CMX_STRUCT_SHAREABLE_SYNCHRONIZE
+ **
+ ** Lock is skipped for NULL pointer (unlike macro, guarded scope
+ ** is still evaluated), unshared struct and single threaded process.
+ **
+ ** Usage:
+ **   cmx::shareable_guard guard (ptr);
+ **/
+
+#endif  /* CMX_MUTEX_TYPE */
+
+}  /* namespace cmx */
+
+#endif  /* header guard */
@@ -0,0 +1,4 @@
+
+#define HAVE_CMX_ENV_C11 1
+
+#include "atomic.c"
@@ -0,0 +1,189 @@
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <cmx/cmx-env.h>
+
+#define THREADS 4
+#define ITEMS   100000
+
+#define BIG     ((int64_t) 1 << 33)
+
+struct Node {
+    struct Node *next;
+};
+
+CMX_ATOMIC_INT_TYPE   int_counter;
+CMX_ATOMIC_INT_TYPE   cas_counter;
+CMX_ATOMIC_INT_TYPE   lock;
+CMX_ATOMIC_INT_TYPE   bits;
+CMX_ATOMIC_INT64_TYPE int64_counter;
+CMX_ATOMIC_SIZE_TYPE  size_counter;
+CMX_ATOMIC_PTR_TYPE (struct Node) stack;
+
+int locked_counter;
+struct Node nodes[THREADS][ITEMS];
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+void check_single_thread (void) {
+    struct Node a;
+    struct Node b;
+    struct Node *ptr = NULL;
+    int i = 0;
+    int64_t i64 = 0;
+    size_t size = 0;
+
+    printf ("  1..16\n");
+
+    CMX_ATOMIC_INT_STORE (int_counter, 5);
+    printf ("  %s 1 - int store / load\n", status (5 == CMX_ATOMIC_INT_LOAD (int_counter)));
+    printf ("  %s 2 - int exchange returns previous value\n", status (5 == CMX_ATOMIC_INT_EXCHANGE (int_counter, 7)));
+
+    i = 5;
+    printf ("  %s 3 - int compare exchange fails\n", status (! CMX_ATOMIC_INT_COMPARE_EXCHANGE (int_counter, i, 9)));
+    printf ("  %s 4 - failed compare exchange updates expected\n", status (7 == i));
+    printf ("  %s 5 - int compare exchange succeeds\n", status (CMX_ATOMIC_INT_COMPARE_EXCHANGE (int_counter, i, 9)));
+    printf ("  %s 6 - int value changed\n", status (9 == CMX_ATOMIC_INT_LOAD (int_counter)));
+
+    printf ("  %s 7 - int fetch add\n", status (9 == CMX_ATOMIC_INT_FETCH_ADD (int_counter, 3)));
+    printf ("  %s 8 - int fetch sub\n", status (12 == CMX_ATOMIC_INT_FETCH_SUB (int_counter, 2)));
+    printf ("  %s 9 - int fetch or\n", status (10 == CMX_ATOMIC_INT_FETCH_OR (int_counter, 5)));
+    printf ("  %s 10 - int fetch and\n", status (15 == CMX_ATOMIC_INT_FETCH_AND (int_counter, 6) && 6 == CMX_ATOMIC_INT_LOAD (int_counter)));
+
+    CMX_ATOMIC_INT64_STORE (int64_counter, BIG);
+    printf ("  %s 11 - int64 fetch add keeps high bits\n", status (BIG == CMX_ATOMIC_INT64_FETCH_ADD (int64_counter, BIG)));
+    i64 = 2 * BIG;
+    printf ("  %s 12 - int64 compare exchange\n", status (CMX_ATOMIC_INT64_COMPARE_EXCHANGE (int64_counter, i64, 1) && 1 == CMX_ATOMIC_INT64_LOAD (int64_counter)));
+
+    CMX_ATOMIC_SIZE_STORE (size_counter, 1);
+    printf ("  %s 13 - size fetch add\n", status (1 == CMX_ATOMIC_SIZE_FETCH_ADD (size_counter, 1) && 2 == CMX_ATOMIC_SIZE_LOAD (size_counter)));
+    while (! CMX_ATOMIC_SIZE_COMPARE_EXCHANGE_WEAK (size_counter, size, 0))
+        ;
+    printf ("  %s 14 - size weak compare exchange\n", status (2 == size && 0 == CMX_ATOMIC_SIZE_LOAD (size_counter)));
+
+    CMX_ATOMIC_PTR_STORE (stack, &a);
+    printf ("  %s 15 - ptr exchange\n", status (&a == CMX_ATOMIC_PTR_EXCHANGE (stack, &b)));
+    printf ("  %s 16 - ptr compare exchange\n", status (
+        ! CMX_ATOMIC_PTR_COMPARE_EXCHANGE (stack, ptr, NULL) && &b == ptr
+        && CMX_ATOMIC_PTR_COMPARE_EXCHANGE (stack, ptr, NULL) && NULL == CMX_ATOMIC_PTR_LOAD (stack)
+    ));
+}
+
+void * worker (void *arg) {
+    int id = (int) (size_t) arg;
+    int bit = 1 << id;
+    int errors = 0;
+    int i;
+
+    for (i = 0; i < ITEMS; ++i) {
+        struct Node *head = CMX_ATOMIC_PTR_LOAD (stack);
+        int value = CMX_ATOMIC_INT_LOAD (cas_counter);
+
+        CMX_ATOMIC_INT_FETCH_ADD (int_counter, 1);
+        CMX_ATOMIC_INT64_FETCH_ADD (int64_counter, BIG);
+        CMX_ATOMIC_SIZE_FETCH_ADD (size_counter, 1);
+
+        while (! CMX_ATOMIC_INT_COMPARE_EXCHANGE_WEAK (cas_counter, value, value + 1))
+            ;
+
+        while (CMX_ATOMIC_INT_EXCHANGE (lock, 1))
+            sched_yield ();
+        ++locked_counter;
+        CMX_ATOMIC_INT_STORE (lock, 0);
+
+        if (CMX_ATOMIC_INT_FETCH_OR (bits, bit) & bit)
+            ++errors;
+        if (! (CMX_ATOMIC_INT_FETCH_AND (bits, ~bit) & bit))
+            ++errors;
+
+        do
+            nodes[id][i].next = head;
+        while (! CMX_ATOMIC_PTR_COMPARE_EXCHANGE_WEAK (stack, head, &nodes[id][i]));
+    }
+
+    return (void *) (size_t) errors;
+}
+
+void check_multi_thread (void) {
+    pthread_t threads[THREADS];
+    struct Node *node;
+    size_t errors = 0;
+    size_t length = 0;
+    int i;
+
+    CMX_ATOMIC_INT_STORE (int_counter, 0);
+    CMX_ATOMIC_INT_STORE (cas_counter, 0);
+    CMX_ATOMIC_INT_STORE (lock, 0);
+    CMX_ATOMIC_INT_STORE (bits, 0);
+    CMX_ATOMIC_INT64_STORE (int64_counter, 0);
+    CMX_ATOMIC_SIZE_STORE (size_counter, 0);
+    CMX_ATOMIC_PTR_STORE (stack, NULL);
+    locked_counter = 0;
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, (void *) (size_t) i);
+
+    for (i = 0; i < THREADS; ++i) {
+        void *retval;
+        pthread_join (threads[i], &retval);
+        errors += (size_t) retval;
+    }
+
+    for (node = CMX_ATOMIC_PTR_LOAD (stack); NULL != node; node = node->next)
+        ++length;
+
+    printf ("  1..7\n");
+    printf ("  %s 1 - int fetch add\n", status (THREADS * ITEMS == CMX_ATOMIC_INT_LOAD (int_counter)));
+    printf ("  %s 2 - int64 fetch add\n", status (THREADS * ITEMS * BIG == CMX_ATOMIC_INT64_LOAD (int64_counter)));
+    printf ("  %s 3 - size fetch add\n", status (THREADS * ITEMS == CMX_ATOMIC_SIZE_LOAD (size_counter)));
+    printf ("  %s 4 - compare exchange loop\n", status (THREADS * ITEMS == CMX_ATOMIC_INT_LOAD (cas_counter)));
+    printf ("  %s 5 - exchange spinlock\n", status (THREADS * ITEMS == locked_counter));
+    printf ("  %s 6 - fetch or / and owns bits\n", status (0 == errors && 0 == CMX_ATOMIC_INT_LOAD (bits)));
+    printf ("  %s 7 - ptr compare exchange stack\n", status (THREADS * ITEMS == length));
+}
+
+void benchmark (void) {
+    struct timespec start;
+    struct timespec end;
+    double seconds;
+    int i;
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (i = 0; i < 10 * ITEMS; ++i)
+        CMX_ATOMIC_INT_FETCH_ADD (int_counter, 1);
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf ("# uncontended fetch add: %.1f M ops/s\n", 10 * ITEMS / seconds / 1e6);
+}
+
+void subtest (int num, const char * name, void (*function) (void)) {
+    int local = failed;
+
+    failed = 0;
+    function ();
+
+    printf ("  # %s\n", name);
+    printf ("%s %d - %s\n", status (failed == 0), num, name);
+
+    if (failed) local ++;
+    failed = local;
+}
+
+int main (void) {
+    printf ("1..2\n");
+
+    subtest (1, "single thread semantics", check_single_thread);
+    subtest (2, "multiple threads", check_multi_thread);
+    benchmark ();
+
+    return failed;
+}
@@ -0,0 +1,144 @@
+
+#include <limits.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-barrier.h>
+
+#define THREADS 4
+#define ROUNDS  1000
+
+/* benchmark: phases per thread count */
+#define BENCH_PHASES   200
+#define BENCH_THREADS  128
+
+CMX_BARRIER_DEFINE barrier;
+CMX_PHASER_DEFINE phaser;
+CMX_ATOMIC_INT_TYPE arrived[ROUNDS];
+CMX_ATOMIC_INT_TYPE serial;
+int ordered = 1;
+int phased = 1;
+int bench_phases;
+
+void * barrier_worker (void *arg) {
+    int i;
+
+    (void) arg;
+    for (i = 0; i < ROUNDS; ++i) {
+        CMX_ATOMIC_INT_FETCH_ADD (arrived[i], 1);
+        if (CMX_BARRIER_WAIT (&barrier))
+            CMX_ATOMIC_INT_FETCH_ADD (serial, 1);
+        if (THREADS != CMX_ATOMIC_INT_LOAD (arrived[i]))
+            ordered = 0;
+    }
+
+    return NULL;
+}
+
+void * phaser_worker (void *arg) {
+    int phases = *(int *) arg;
+    int i;
+
+    for (i = 0; i < phases; ++i)
+        if (CMX_PHASER_ARRIVE_AND_WAIT (&phaser) + 1 > CMX_PHASER_PHASE (&phaser))
+            phased = 0;
+    CMX_PHASER_ARRIVE_AND_DEREGISTER (&phaser);
+
+    return NULL;
+}
+
+void * bench_worker (void *arg) {
+    int i;
+
+    (void) arg;
+    for (i = 0; i < bench_phases; ++i)
+        CMX_BARRIER_WAIT (&barrier);
+
+    return NULL;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double run (int threads, void * (* function) (void *), void *arg) {
+    pthread_t thread[BENCH_THREADS];
+    double start = now ();
+    int i;
+
+    for (i = 0; i < threads; ++i)
+        pthread_create (&thread[i], NULL, function, arg);
+    for (i = 0; i < threads; ++i)
+        pthread_join (thread[i], NULL);
+
+    return now () - start;
+}
+
+int main (void) {
+    pthread_t thread[THREADS];
+    int phases[THREADS];
+    int threads;
+    int i;
+
+    printf ("1..9\n");
+
+    CMX_BARRIER_INIT (&barrier, 1);
+    printf ("%s - 1 - single party does not wait\n", status (CMX_BARRIER_WAIT (&barrier) && CMX_BARRIER_WAIT (&barrier)));
+
+    CMX_BARRIER_INIT (&barrier, THREADS);
+    run (THREADS, barrier_worker, NULL);
+    printf ("%s - 2 - no thread passes barrier before others arrive\n", status (ordered));
+    printf ("%s - 3 - one serial thread per phase\n", status (ROUNDS == CMX_ATOMIC_INT_LOAD (serial)));
+
+    CMX_PHASER_INIT (&phaser, 2);
+    printf ("%s - 4 - arrive does not wait\n", status (0 == CMX_PHASER_ARRIVE (&phaser) && 0 == CMX_PHASER_PHASE (&phaser)));
+    printf ("%s - 5 - last arrival advances phase\n", status (0 == CMX_PHASER_ARRIVE (&phaser) && 1 == CMX_PHASER_PHASE (&phaser)));
+
+    /* main thread stays registered and registers workers with growing lifetime */
+    CMX_PHASER_INIT (&phaser, 1);
+    for (i = 0; i < THREADS; ++i) {
+        phases[i] = 10 * (i + 1);
+        CMX_PHASER_REGISTER (&phaser);
+        pthread_create (&thread[i], NULL, phaser_worker, &phases[i]);
+    }
+    for (i = 0; i < 10 * THREADS + 1; ++i)
+        CMX_PHASER_ARRIVE_AND_WAIT (&phaser);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (thread[i], NULL);
+
+    printf ("%s - 6 - no party passes phase before others arrive\n", status (phased));
+    printf ("%s - 7 - deregistered parties are not waited for\n", status (10 * THREADS + 1 == CMX_PHASER_PHASE (&phaser)));
+    printf ("%s - 8 - deregistered parties are removed\n", status (1 == (int) (CMX_ATOMIC_INT64_LOAD (phaser.state) >> 32)));
+
+    CMX_PHASER_INIT (&phaser, 1);
+    CMX_ATOMIC_INT_STORE (phaser.phase, INT_MAX);
+    printf ("%s - 9 - phase wraps around\n", status (INT_MAX == CMX_PHASER_ARRIVE (&phaser) && INT_MIN == CMX_PHASER_PHASE (&phaser)));
+
+    for (threads = 2; threads <= BENCH_THREADS; threads *= 2) {
+        double elapsed;
+
+        bench_phases = BENCH_PHASES;
+        CMX_BARRIER_INIT (&barrier, threads);
+        elapsed = run (threads, bench_worker, NULL);
+
+        printf (
+            "# %3d threads: %.1f us per phase transition\n",
+            threads,
+            elapsed * 1e6 / BENCH_PHASES
+        );
+    }
+
+    return failed;
+}
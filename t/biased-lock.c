@@ -0,0 +1,149 @@
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+#define CMX_STRUCT_SHAREABLE_BIASED 1
+
+#include <cmx/cmx-biased-lock.h>
+#include <cmx/cmx-struct-shareable.h>
+
+#define THREADS 4
+#define ITEMS   100000
+
+/* benchmark: uncontended lock / unlock pairs */
+#define BENCH_OPS 10000000
+
+struct Counter {
+    CMX_STRUCT_SHAREABLE_DEFINE;
+    long value;
+};
+
+struct CMX_Biased_Lock lock;
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+struct Counter shared;
+long counter;
+
+struct Counter * counter_share (struct Counter *self) {
+    CMX_STRUCT_SHAREABLE_SHARE (self) { }
+}
+
+void counter_add (struct Counter *self) {
+    CMX_STRUCT_SHAREABLE_SYNCHRONIZE (self) {
+        ++self->value;
+    }
+}
+
+void * worker (void *arg) {
+    int i;
+
+    (void) arg;
+    for (i = 0; i < ITEMS; ++i) {
+        CMX_SYNCHRONIZE_BIASED (&lock) {
+            ++counter;
+        }
+        counter_add (&shared);
+    }
+
+    return NULL;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void * nothing (void *arg) {
+    return arg;
+}
+
+int t_break (void) {
+    int reached = 0;
+
+    CMX_SYNCHRONIZE_BIASED (&lock) {
+        if (CMX_ATOMIC_INT_LOAD (lock.busy))
+            break;
+        reached = 1;
+    }
+
+    return ! reached && 0 == CMX_ATOMIC_INT_LOAD (lock.busy);
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    struct CMX_Biased_Lock other;
+    double biased;
+    double locked;
+    int i;
+
+    printf ("1..8\n");
+    printf ("# process-wide barrier %savailable\n", CMX_MEMBARRIER_INIT () ? "" : "not ");
+
+    /* leave single thread mode, shareable structs skip locking otherwise */
+    pthread_create (&threads[0], NULL, nothing, NULL);
+    pthread_join (threads[0], NULL);
+
+    CMX_BIASED_LOCK_INIT (&lock);
+    CMX_SYNCHRONIZE_BIASED (&lock) {
+        ++counter;
+    }
+    printf ("%s - 1 - first locking thread becomes owner\n", status (CMX_BIASED_LOCK_BIASED == CMX_ATOMIC_INT_LOAD (lock.state) && pthread_equal (lock.owner, pthread_self ())));
+    printf ("%s - 2 - owner lock is released on break\n", status (t_break ()));
+
+    CMX_STRUCT_SHAREABLE_INIT (&shared);
+    counter_share (&shared);
+    counter_add (&shared);
+    printf ("%s - 3 - shareable struct uses biased lock\n", status (CMX_BIASED_LOCK_BIASED == CMX_ATOMIC_INT_LOAD (shared.cmx_struct_shareable.mutex.state)));
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    worker (NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+
+    printf ("%s - 4 - no update lost while bias is revoked\n", status (1 + (THREADS + 1) * ITEMS == counter));
+    printf ("%s - 5 - other thread revokes bias\n", status (CMX_BIASED_LOCK_REVOKED == CMX_ATOMIC_INT_LOAD (lock.state)));
+    printf ("%s - 6 - no update of shareable struct lost\n", status (1 + (THREADS + 1) * ITEMS == shared.value));
+
+    CMX_BIASED_LOCK_INIT (&other);
+    CMX_SYNCHRONIZE_BIASED (&other) { }
+    printf ("%s - 7 - mutex pointer revokes bias\n", status (&other.mutex == CMX_BIASED_LOCK_MUTEX (&other) && CMX_BIASED_LOCK_REVOKED == CMX_ATOMIC_INT_LOAD (other.state)));
+
+    CMX_STRUCT_SHAREABLE_INIT (&shared);
+    counter_share (&shared);
+    counter_add (&shared);
+    printf ("%s - 8 - shareable mutex pointer revokes bias\n", status (&shared.cmx_struct_shareable.mutex.mutex == CMX_STRUCT_SHAREABLE_MUTEX (&shared) && CMX_BIASED_LOCK_REVOKED == CMX_ATOMIC_INT_LOAD (shared.cmx_struct_shareable.mutex.state)));
+
+    CMX_BIASED_LOCK_INIT (&other);
+    biased = now ();
+    for (i = 0; i < BENCH_OPS; ++i)
+        CMX_SYNCHRONIZE_BIASED (&other) {
+            ++counter;
+        }
+    biased = now () - biased;
+
+    locked = now ();
+    for (i = 0; i < BENCH_OPS; ++i) {
+        pthread_mutex_lock (&mutex);
+        ++counter;
+        pthread_mutex_unlock (&mutex);
+    }
+    locked = now () - locked;
+
+    printf (
+        "# uncontended: biased %.1f ns, mutex %.1f ns per lock / unlock\n",
+        biased * 1e9 / BENCH_OPS,
+        locked * 1e9 / BENCH_OPS
+    );
+
+    return failed;
+}
@@ -0,0 +1,132 @@
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-combiner.h>
+
+#define THREADS 4
+#define ITEMS   10000
+
+/* benchmark: same number of operations split between threads */
+#define BENCH_OPS 64000
+
+struct Add {
+    int value;
+    long result;
+};
+
+struct CMX_Combiner combiner = CMX_COMBINER_INITIALIZER;
+pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+long counter;
+int monotonic = 1;
+int bench_items;
+
+void counter_add (void *arg) {
+    struct Add *add = arg;
+
+    add->result = counter += add->value;
+}
+
+void * worker (void *arg) {
+    struct Add add = { 1, 0 };
+    long last = 0;
+    int i;
+
+    (void) arg;
+    for (i = 0; i < ITEMS; ++i) {
+        CMX_SYNCHRONIZE_COMBINING (&combiner, counter_add, &add);
+        if (add.result <= last)
+            monotonic = 0;
+        last = add.result;
+    }
+
+    return NULL;
+}
+
+void * bench_combiner (void *arg) {
+    struct Add add = { 1, 0 };
+    int i;
+
+    (void) arg;
+    for (i = 0; i < bench_items; ++i)
+        CMX_SYNCHRONIZE_COMBINING (&combiner, counter_add, &add);
+
+    return NULL;
+}
+
+void * bench_mutex (void *arg) {
+    struct Add add = { 1, 0 };
+    int i;
+
+    (void) arg;
+    for (i = 0; i < bench_items; ++i) {
+        pthread_mutex_lock (&mutex);
+        counter_add (&add);
+        pthread_mutex_unlock (&mutex);
+    }
+
+    return NULL;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double run (int threads, void * (* function) (void *)) {
+    pthread_t thread[64];
+    double start = now ();
+    int i;
+
+    for (i = 0; i < threads; ++i)
+        pthread_create (&thread[i], NULL, function, NULL);
+    for (i = 0; i < threads; ++i)
+        pthread_join (thread[i], NULL);
+
+    return now () - start;
+}
+
+int main (void) {
+    struct Add add = { 5, 0 };
+    int threads;
+
+    printf ("1..4\n");
+
+    CMX_SYNCHRONIZE_COMBINING (&combiner, counter_add, &add);
+    printf ("%s - 1 - operation evaluated without contention\n", status (5 == counter && 5 == add.result));
+
+    counter = 0;
+    run (THREADS, worker);
+    printf ("%s - 2 - no operation lost\n", status (THREADS * ITEMS == counter));
+    printf ("%s - 3 - operations of thread are ordered\n", status (monotonic));
+    printf ("%s - 4 - combiner is released\n", status (0 == CMX_ATOMIC_INT_LOAD (combiner.lock) && NULL == CMX_ATOMIC_PTR_LOAD (combiner.pending)));
+
+    for (threads = 8; threads <= 64; threads *= 2) {
+        double combining;
+        double locking;
+
+        bench_items = BENCH_OPS / threads;
+        combining = run (threads, bench_combiner);
+        locking = run (threads, bench_mutex);
+
+        printf (
+            "# %2d threads: combining %.1f ns, mutex %.1f ns per operation\n",
+            threads,
+            combining * 1e9 / BENCH_OPS,
+            locking * 1e9 / BENCH_OPS
+        );
+    }
+
+    return failed;
+}
@@ -0,0 +1,90 @@
+
+#include <stdio.h>
+
+#include <cmx/cmx-coro.h>
+
+struct Counter {
+    CMX_CORO_DEFINE;
+    int i;
+    int limit;
+    int value;
+};
+
+int counter_step (struct Counter *self) {
+    CMX_CORO_BEGIN (self);
+    for (self->i = 1; self->i <= self->limit; ++self->i) {
+        self->value = self->i;
+        CMX_CORO_YIELD;
+    }
+    CMX_CORO_END;
+}
+
+struct Waiter {
+    CMX_CORO_DEFINE;
+    int *flag;
+    int steps;
+};
+
+int waiter_step (struct Waiter *self) {
+    CMX_CORO_BEGIN (self);
+    ++self->steps;
+    CMX_CORO_AWAIT (*self->flag);
+    ++self->steps;
+    CMX_CORO_YIELD; CMX_CORO_YIELD;
+    if (*self->flag > 1)
+        CMX_CORO_EXIT;
+    ++self->steps;
+    CMX_CORO_END;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+int main (void) {
+    struct Counter counter = { .limit = 3 };
+    struct Waiter waiter;
+    int flag = 0;
+    int sum = 0;
+    int rv;
+
+    printf ("1..14\n");
+
+    printf ("%s 1 - zero initialized coroutine is not finished\n", status (! CMX_CORO_FINISHED_P (&counter)));
+
+    while (CMX_CORO_YIELDED == (rv = counter_step (&counter)))
+        sum = sum * 10 + counter.value;
+
+    printf ("%s 2 - yielded values\n", status (sum == 123));
+    printf ("%s 3 - last call returns finished\n", status (rv == CMX_CORO_FINISHED));
+    printf ("%s 4 - finished predicate\n", status (CMX_CORO_FINISHED_P (&counter)));
+    printf ("%s 5 - finished coroutine stays finished\n", status (counter_step (&counter) == CMX_CORO_FINISHED));
+
+    CMX_CORO_INIT (&counter);
+    printf ("%s 6 - restarted coroutine yields again\n", status (counter_step (&counter) == CMX_CORO_YIELDED && counter.value == 1));
+
+    CMX_CORO_INIT (&waiter);
+    waiter.flag = &flag;
+    waiter.steps = 0;
+
+    printf ("%s 7 - await returns waiting\n", status (waiter_step (&waiter) == CMX_CORO_WAITING));
+    printf ("%s 8 - await keeps waiting\n", status (waiter_step (&waiter) == CMX_CORO_WAITING));
+    printf ("%s 9 - code before await evaluated once\n", status (waiter.steps == 1));
+
+    flag = 1;
+    printf ("%s 10 - await continues when condition holds\n", status (waiter_step (&waiter) == CMX_CORO_YIELDED));
+    printf ("%s 11 - two yields on the same line\n", status (waiter_step (&waiter) == CMX_CORO_YIELDED));
+    printf ("%s 12 - coroutine finishes\n", status (waiter_step (&waiter) == CMX_CORO_FINISHED && waiter.steps == 3));
+
+    CMX_CORO_INIT (&waiter);
+    waiter.steps = 0;
+    flag = 2;
+    waiter_step (&waiter);
+    waiter_step (&waiter);
+    printf ("%s 13 - exit finishes coroutine\n", status (waiter_step (&waiter) == CMX_CORO_FINISHED));
+    printf ("%s 14 - code after exit not evaluated\n", status (waiter.steps == 2));
+
+    return failed;
+}
@@ -0,0 +1,195 @@
+
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <pthread.h>
+#include <sched.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx.hpp>
+
+#define THREADS 4
+#define ROUNDS  1000
+
+struct Job {
+    CMX_STRUCT_REFS_DEFINE;
+    int value;
+};
+
+struct Counter {
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_STRUCT_SHAREABLE_DEFINE;
+    long value;
+};
+
+struct Plain {
+    int value;
+};
+
+static_assert (cmx::has_refs<Job>::value, "Job is ref counted");
+static_assert (! cmx::has_refs<Plain>::value, "Plain is not ref counted");
+static_assert (! cmx::is_shareable<Job> (), "Job is not shareable");
+static_assert (cmx::is_shareable<Counter> () && cmx::is_refcounted<Counter> (), "Counter is shareable");
+
+int destroyed = 0;
+int traits_calls = 0;
+
+void cmx_unref (Job *self) {
+    CMX_STRUCT_REFS_UNREF (self) {
+        ++ destroyed;
+        free (self);
+    }
+}
+
+void cmx_unref (Counter *self) {
+    CMX_STRUCT_SHAREABLE_REFS_UNREF (self) {
+        ++ destroyed;
+        free (self);
+    }
+}
+
+struct Counting_Traits {
+    static void ref (Job *ptr) {
+        ++ traits_calls;
+        cmx::ref_traits<Job>::ref (ptr);
+    }
+
+    static void unref (Job *ptr) {
+        ++ traits_calls;
+        cmx::ref_traits<Job>::unref (ptr);
+    }
+};
+
+typedef cmx::ref_ptr<Job, Counting_Traits> Job_Ptr;
+
+Job * job_new (int value) {
+    Job *retval = (Job *) calloc (1, sizeof (*retval));
+
+    CMX_STRUCT_REFS_INIT (retval);
+    retval->value = value;
+
+    return retval;
+}
+
+Counter * counter_share (Counter *self) {
+    CMX_STRUCT_SHAREABLE_SHARE (self) { }
+}
+
+int job_value (Job_Ptr job) {
+    return job->value;
+}
+
+int refs (Job *job) {
+    return CMX_ATOMIC_INT_LOAD (job->CMX_STRUCT_REFS_NAME);
+}
+
+CMX_MUTEX_TYPE mutex;
+CMX_ATOMIC_INT_TYPE inside;
+CMX_ATOMIC_INT_TYPE overlaps;
+long total;
+Counter *counter;
+
+/* thread yields inside guarded scope, other thread entering it is detected */
+void enter (void) {
+    if (0 != CMX_ATOMIC_INT_FETCH_ADD (inside, 1))
+        CMX_ATOMIC_INT_FETCH_ADD (overlaps, 1);
+    sched_yield ();
+    CMX_ATOMIC_INT_FETCH_SUB (inside, 1);
+}
+
+void * synchronize_worker (void *arg) {
+    int i;
+
+    for (i = 0; i < ROUNDS; ++i) {
+        cmx::synchronize_guard guard (&mutex);
+        enter ();
+        ++ total;
+    }
+
+    return arg;
+}
+
+void * shareable_worker (void *arg) {
+    cmx::ref_ptr<Counter> self = cmx::ref_ptr<Counter>::ref (counter);
+    int i;
+
+    for (i = 0; i < ROUNDS; ++i) {
+        cmx::shareable_guard guard (self.get ());
+        enter ();
+        ++ self->value;
+    }
+
+    return arg;
+}
+
+void run (void * (* fn) (void *)) {
+    pthread_t threads[THREADS];
+    int i;
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, fn, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+int main () {
+    Job *raw;
+    int value;
+
+    printf ("1..9\n");
+
+    {
+        Job_Ptr a = Job_Ptr::adopt (job_new (1));
+        Job_Ptr b = std::move (a);
+
+        printf ("%s - 1 - adopt and move don't touch reference count\n", status (0 == traits_calls && ! a && b && 1 == refs (b.get ())));
+
+        value = job_value (std::move (b));
+        printf ("%s - 2 - ownership moved into function is released there\n", status (1 == value && ! b && 1 == traits_calls && 1 == destroyed));
+    }
+
+    traits_calls = 0;
+    {
+        Job_Ptr a = Job_Ptr::adopt (job_new (2));
+        {
+            Job_Ptr b = a;
+            Job_Ptr c;
+
+            c = b;
+            printf ("%s - 3 - copy takes reference\n", status (3 == refs (a.get ()) && 2 == traits_calls));
+
+            c = std::move (b);
+            printf ("%s - 4 - move assignment releases only replaced reference\n", status (2 == refs (a.get ()) && 3 == traits_calls && ! b));
+        }
+        printf ("%s - 5 - destructors release copies\n", status (1 == refs (a.get ()) && 1 == destroyed));
+
+        raw = a.release ();
+        a = Job_Ptr::adopt (raw);
+        Job_Ptr d = Job_Ptr::ref (raw);
+        printf ("%s - 6 - release and ref pass references\n", status (a == d && 2 == refs (raw)));
+    }
+    printf ("%s - 7 - last reference destroys struct\n", status (2 == destroyed));
+
+    /* leave single thread mode, guards take their locked paths */
+    CMX_MUTEX_INIT (mutex);
+    run (synchronize_worker);
+    printf ("%s - 8 - synchronize guard excludes other threads\n", status (THREADS * ROUNDS == total && 0 == CMX_ATOMIC_INT_LOAD (overlaps)));
+
+    counter = (Counter *) calloc (1, sizeof (*counter));
+    CMX_STRUCT_REFS_INIT (counter);
+    CMX_STRUCT_SHAREABLE_INIT (counter);
+    counter_share (counter);
+    run (shareable_worker);
+    value = THREADS * ROUNDS == counter->value && 1 == CMX_ATOMIC_INT_LOAD (counter->CMX_STRUCT_REFS_NAME);
+    cmx_unref (counter);
+    printf ("%s - 9 - shareable guard excludes other threads\n", status (value && 0 == CMX_ATOMIC_INT_LOAD (overlaps) && 3 == destroyed));
+
+    return failed;
+}
@@ -0,0 +1,265 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-hashmap.h>
+
+#define THREADS 4
+#define ITEMS   20000
+
+/* benchmark: lookups with 10 % of remove / insert over shared keys */
+#define BENCH_KEYS 4096
+#define BENCH_OPS  400000
+
+struct Obj {
+    int key;
+    CMX_STRUCT_REFS_DEFINE;
+};
+
+#define int_hash(Key) ((size_t) (Key) * 2654435761u)
+#define int_eq(A, B)  ((A) == (B))
+
+CMX_HASHMAP_DEFINE (Obj_Map, int, struct Obj *, int_hash, int_eq);
+
+/* baseline: the same map guarded by single mutex */
+#undef CMX_HASHMAP_SEGMENTS
+#define CMX_HASHMAP_SEGMENTS 1
+
+CMX_HASHMAP_DEFINE (Single_Map, int, struct Obj *, int_hash, int_eq);
+
+struct Obj_Map map;
+struct Single_Map single_map;
+int unrefs = 0;
+int bench_items;
+
+struct Obj * obj_new (int key) {
+    struct Obj *obj = malloc (sizeof (*obj));
+    obj->key = key;
+    CMX_STRUCT_REFS_INIT (obj);
+    return obj;
+}
+
+void obj_unref (struct Obj *obj) {
+    ++unrefs;
+    free (obj);
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+void check_single_thread (void) {
+    struct Obj *obj = obj_new (1);
+    struct Obj *found;
+    struct Single_Map migrating;
+    struct Single_Map_Segment *segment = &migrating.segments[0];
+    size_t count;
+    int i;
+    int ok;
+
+    Obj_Map_init (&map);
+
+    printf ("  1..14\n");
+    printf ("  %s 1 - lookup in empty map\n", status (NULL == Obj_Map_lookup (&map, 1)));
+    printf ("  %s 2 - insert\n", status (1 == Obj_Map_insert (&map, 1, obj)));
+    printf ("  %s 3 - insert existing key\n", status (0 == Obj_Map_insert (&map, 1, obj)));
+
+    found = Obj_Map_lookup (&map, 1);
+    printf ("  %s 4 - lookup returns value\n", status (obj == found));
+    printf ("  %s 5 - lookup takes reference\n", status (2 == obj->CMX_STRUCT_REFS_NAME));
+
+    found = Obj_Map_remove (&map, 1);
+    printf ("  %s 6 - remove returns value\n", status (obj == found));
+    printf ("  %s 7 - removed key not found\n", status (NULL == Obj_Map_lookup (&map, 1)));
+    free (obj);
+
+    for (i = 0; i < ITEMS; ++i)
+        Obj_Map_insert (&map, i, obj_new (i));
+    for (i = 0; i < ITEMS; i += 2)
+        obj_unref (Obj_Map_remove (&map, i));
+    printf ("  %s 8 - count after grow and remove\n", status (ITEMS / 2 == Obj_Map_count (&map)));
+
+    ok = 1;
+    for (i = 0; i < ITEMS; ++i) {
+        found = Obj_Map_lookup (&map, i);
+        if ((i % 2) ? (NULL == found || found->key != i) : (NULL != found))
+            ok = 0;
+        if (NULL != found)
+            --found->CMX_STRUCT_REFS_NAME;
+    }
+    printf ("  %s 9 - lookup after grow and remove\n", status (ok));
+
+    unrefs = 0;
+    Obj_Map_destroy (&map, obj_unref);
+    printf ("  %s 10 - destroy releases values\n", status (ITEMS / 2 == unrefs));
+
+    /* remove key already moved to new table while old table is still in use */
+    Single_Map_init (&migrating);
+    for (i = 0; NULL == segment->old.slots || segment->old.size < 32; ++i)
+        Single_Map_insert (&migrating, i, obj_new (i));
+    /* keys below i - 1 are in old table, insert migrates its first slots */
+    Single_Map_insert (&migrating, i, obj_new (i));
+    for (i -= 2; i >= 0 && NULL == Single_Map_table_find (&segment->table, int_hash (i), i); --i)
+        ;
+    count = Single_Map_count (&migrating);
+    found = Single_Map_remove (&migrating, i);
+    printf ("  %s 11 - remove of migrated key during migration\n", status (i >= 0 && NULL != found && NULL != segment->old.slots));
+    printf ("  %s 12 - removed migrated key not found\n", status (NULL == Single_Map_lookup (&migrating, i)));
+    printf ("  %s 13 - count after remove of migrated key\n", status (count - 1 == Single_Map_count (&migrating)));
+    printf ("  %s 14 - removed migrated key can be inserted again\n", status (1 == Single_Map_insert (&migrating, i, found)));
+    Single_Map_destroy (&migrating, obj_unref);
+}
+
+void * worker (void *arg) {
+    int base = (int) (size_t) arg * ITEMS;
+    int errors = 0;
+    int i;
+
+    for (i = base; i < base + ITEMS; ++i)
+        if (1 != Obj_Map_insert (&map, i, obj_new (i)))
+            ++errors;
+
+    for (i = base; i < base + ITEMS; ++i) {
+        struct Obj *obj = Obj_Map_lookup (&map, i);
+        if (NULL == obj || obj->key != i)
+            ++errors;
+    }
+
+    for (i = base; i < base + ITEMS; ++i) {
+        struct Obj *obj = Obj_Map_remove (&map, i);
+        if (NULL == obj || 2 != obj->CMX_STRUCT_REFS_NAME)
+            ++errors;
+        free (obj);
+    }
+
+    return (void *) (size_t) errors;
+}
+
+void check_multi_thread (void) {
+    pthread_t threads[THREADS];
+    size_t errors = 0;
+    int i;
+
+    Obj_Map_init (&map);
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, (void *) (size_t) i);
+
+    for (i = 0; i < THREADS; ++i) {
+        void *retval;
+        pthread_join (threads[i], &retval);
+        errors += (size_t) retval;
+    }
+
+    printf ("  1..2\n");
+    printf ("  %s 1 - concurrent insert / lookup / remove\n", status (0 == errors));
+    printf ("  %s 2 - map is empty\n", status (0 == Obj_Map_count (&map)));
+
+    Obj_Map_destroy (&map, NULL);
+}
+
+#define BENCH_WORKER(Name, Type, Map)                                   \
+    void * Name (void *arg) {                                           \
+        unsigned key = (unsigned) (size_t) arg;                         \
+        struct Obj *obj;                                                \
+        int i;                                                          \
+                                                                        \
+        for (i = 0; i < bench_items; ++i) {                             \
+            key = (key * 1103515245u + 12345u) % BENCH_KEYS;            \
+            if (0 == i % 10) {                                          \
+                obj = Type##_remove (&Map, key);                         \
+                if (NULL != obj)                                        \
+                    Type##_insert (&Map, key, obj);                      \
+            } else {                                                    \
+                obj = Type##_lookup (&Map, key);                         \
+                if (NULL != obj)                                        \
+                    CMX_STRUCT_REFS_DECREMENT_AND_TEST (obj);           \
+            }                                                           \
+        }                                                               \
+                                                                        \
+        return NULL;                                                    \
+    }
+
+BENCH_WORKER (bench_segmented, Obj_Map, map)
+BENCH_WORKER (bench_single, Single_Map, single_map)
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double run (int threads, void * (* function) (void *)) {
+    pthread_t thread[THREADS];
+    double start = now ();
+    int i;
+
+    for (i = 0; i < threads; ++i)
+        pthread_create (&thread[i], NULL, function, (void *) (size_t) i);
+    for (i = 0; i < threads; ++i)
+        pthread_join (thread[i], NULL);
+
+    return now () - start;
+}
+
+void benchmark (void) {
+    int threads;
+    int i;
+
+    Obj_Map_init (&map);
+    Single_Map_init (&single_map);
+    for (i = 0; i < BENCH_KEYS; ++i) {
+        Obj_Map_insert (&map, i, obj_new (i));
+        Single_Map_insert (&single_map, i, obj_new (i));
+    }
+
+    for (threads = 1; threads <= THREADS; threads *= 2) {
+        double segmented;
+        double locking;
+
+        bench_items = BENCH_OPS / threads;
+        segmented = run (threads, bench_segmented);
+        locking = run (threads, bench_single);
+
+        printf (
+            "# %d threads: segmented %.1f ns, single mutex %.1f ns per operation\n",
+            threads,
+            segmented * 1e9 / BENCH_OPS,
+            locking * 1e9 / BENCH_OPS
+        );
+    }
+
+    Obj_Map_destroy (&map, obj_unref);
+    Single_Map_destroy (&single_map, obj_unref);
+}
+
+void subtest (int num, const char * name, void (*function) (void)) {
+    int local = failed;
+
+    failed = 0;
+    function ();
+
+    printf ("  # %s\n", name);
+    printf ("%s %d - %s\n", status (failed == 0), num, name);
+
+    if (failed) local ++;
+    failed = local;
+}
+
+int main (void) {
+    printf ("1..2\n");
+
+    subtest (1, "single thread workflow", check_single_thread);
+    subtest (2, "multiple threads", check_multi_thread);
+
+    benchmark ();
+
+    return failed;
+}
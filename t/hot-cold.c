@@ -0,0 +1,282 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx.h>
+#include <cmx/cmx-limit.h>
+
+#if defined (__linux__) && defined (__ELF__)
+#include <elf.h>
+#include <link.h>
+#define HAVE_SYMTAB 1
+#endif
+
+/* benchmark: every variant is distinct code using block macros,
+ * together they don't fit into L1 instruction cache */
+#define VARIANTS    512
+#define BENCH_ROUNDS 2000
+
+struct Job {
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_STRUCT_SHAREABLE_DEFINE;
+    long value;
+};
+
+static CMX_MUTEX_TYPE mutex;
+static long total;
+static int destroyed;
+
+struct Job * job_new (void) {
+    struct Job *retval = calloc (1, sizeof (*retval));
+
+    CMX_STRUCT_REFS_INIT (retval);
+
+    return retval;
+}
+
+struct Job * job_share (struct Job *self) {
+    CMX_STRUCT_SHAREABLE_SHARE (self) { }
+}
+
+void job_unref (struct Job *self) {
+    CMX_STRUCT_REFS_UNREF (self) {
+        ++ destroyed;
+        free (self);
+    }
+}
+
+#define VARIANT(N)                                                      \
+    long variant_##N (struct Job *job) {                                \
+        long retval = __COUNTER__;                                      \
+        CMX_STRUCT_SHAREABLE_REFS_INCREMENT (job);                      \
+        CMX_STRUCT_SHAREABLE_SYNCHRONIZE (job) {                        \
+            job->value += retval;                                       \
+        }                                                               \
+        CMX_SYNCHRONIZE_WITH (&mutex) {                                 \
+            total += retval;                                            \
+        }                                                               \
+        CMX_STRUCT_REFS_UNREF (job) {                                   \
+            ++ destroyed;                                               \
+            free (job);                                                 \
+        }                                                               \
+        return retval;                                                  \
+    }
+
+#define ENTRY(N)                                                        \
+    variant_##N,
+
+#define REPEAT_8(M, P)                                                  \
+    M (P##0) M (P##1) M (P##2) M (P##3) M (P##4) M (P##5) M (P##6) M (P##7)
+
+#define REPEAT_64(M, P)                                                 \
+    REPEAT_8 (M, P##0) REPEAT_8 (M, P##1) REPEAT_8 (M, P##2) REPEAT_8 (M, P##3) \
+    REPEAT_8 (M, P##4) REPEAT_8 (M, P##5) REPEAT_8 (M, P##6) REPEAT_8 (M, P##7)
+
+#define REPEAT_512(M, P)                                                \
+    REPEAT_64 (M, P##0) REPEAT_64 (M, P##1) REPEAT_64 (M, P##2) REPEAT_64 (M, P##3) \
+    REPEAT_64 (M, P##4) REPEAT_64 (M, P##5) REPEAT_64 (M, P##6) REPEAT_64 (M, P##7)
+
+REPEAT_512 (VARIANT, v)
+
+static long (* const variants[VARIANTS]) (struct Job *) = {
+    REPEAT_512 (ENTRY, v)
+};
+
+int failed = 0;
+
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void * idle (void *arg) {
+    return arg;
+}
+
+#ifdef HAVE_SYMTAB
+struct Symtab {
+    char *image;
+    ElfW(Sym) *symbols;
+    size_t count;
+    const char *names;
+};
+
+int symtab_load (struct Symtab *symtab) {
+    ElfW(Ehdr) *header;
+    ElfW(Shdr) *sections;
+    FILE *file;
+    long size;
+    int i;
+
+    memset (symtab, 0, sizeof (*symtab));
+
+    if (NULL == (file = fopen ("/proc/self/exe", "rb")))
+        return 0;
+
+    fseek (file, 0, SEEK_END);
+    size = ftell (file);
+    rewind (file);
+    symtab->image = malloc (size);
+    if (size != (long) fread (symtab->image, 1, size, file))
+        size = 0;
+    fclose (file);
+
+    header = (ElfW(Ehdr) *) symtab->image;
+    if (size < (long) sizeof (*header) || 0 != memcmp (header->e_ident, ELFMAG, SELFMAG))
+        return 0;
+
+    sections = (ElfW(Shdr) *) (symtab->image + header->e_shoff);
+    for (i = 0; i < header->e_shnum; ++i)
+        if (SHT_SYMTAB == sections[i].sh_type) {
+            symtab->symbols = (ElfW(Sym) *) (symtab->image + sections[i].sh_offset);
+            symtab->count = sections[i].sh_size / sizeof (ElfW(Sym));
+            symtab->names = symtab->image + sections[sections[i].sh_link].sh_offset;
+        }
+
+    return NULL != symtab->symbols;
+}
+
+/* sum of sizes of functions named Prefix..., cold parts (Prefix....cold)
+ * counted separately */
+size_t symtab_size (struct Symtab *symtab, const char *prefix, size_t *cold, int *found) {
+    size_t retval = 0;
+    size_t i;
+    const char *name;
+
+    *cold = 0;
+    *found = 0;
+    for (i = 0; i < symtab->count; ++i) {
+        if (STT_FUNC != ELF64_ST_TYPE (symtab->symbols[i].st_info))
+            continue;
+        name = symtab->names + symtab->symbols[i].st_name;
+        if (0 != strncmp (prefix, name, strlen (prefix)))
+            continue;
+        if (strstr (name, ".cold"))
+            *cold += symtab->symbols[i].st_size;
+        else {
+            retval += symtab->symbols[i].st_size;
+            ++ *found;
+        }
+    }
+
+    return retval;
+}
+#endif
+
+int main () {
+    struct Job *job;
+    struct Job *other;
+    pthread_t thread;
+    CMX_SEMAPHORE_DEFINE semaphore = CMX_SEMAPHORE_INITIALIZER (1);
+    long expected = 0;
+    long sum = 0;
+    double start;
+    double cold_time;
+    double hot_time;
+    int acquired;
+    int i;
+    int j;
+
+    CMX_MUTEX_INIT (mutex);
+
+    /* leave single thread mode, so macros take their locked paths */
+    pthread_create (&thread, NULL, idle, NULL);
+    pthread_join (thread, NULL);
+
+    printf ("1..5\n");
+
+    job = job_new ();
+    other = job_new ();
+    CMX_STRUCT_REFS_INCREMENT (other);
+    job_unref (other);
+    i = destroyed;
+    job_unref (other);
+    printf ("%s - 1 - unref destroys object with last reference only\n", status (0 == i && 1 == destroyed));
+
+    job_share (job);
+    job_share (job);
+    printf ("%s - 2 - first share publishes mutex\n", status (CMX_STRUCT_SHAREABLE_SHARED == CMX_ATOMIC_INT_LOAD (job->CMX_STRUCT_SHAREABLE_NAME.enabled)));
+
+    CMX_SEMAPHORE_ACQUIRE (&semaphore);
+    acquired = CMX_SEMAPHORE_TRY_ACQUIRE (&semaphore);
+    CMX_SEMAPHORE_RELEASE (&semaphore);
+    acquired = ! acquired && CMX_SEMAPHORE_TRY_ACQUIRE (&semaphore);
+    CMX_SEMAPHORE_RELEASE (&semaphore);
+    printf ("%s - 3 - semaphore fast path and exhausted slow path\n", status (acquired && 1 == CMX_SEMAPHORE_AVAILABLE (&semaphore)));
+
+#ifdef HAVE_SYMTAB
+    {
+        struct Symtab symtab;
+        const char *helpers[] = {
+            "cmx_struct_shareable_publish",
+            "cmx_semaphore_acquire_slow",
+            "cmx_semaphore_wake",
+            "cmx_struct_refs_wake",
+        };
+        size_t size;
+        size_t cold;
+        int found;
+        int out_of_line = 1;
+
+        if (! symtab_load (&symtab)) {
+            printf ("ok - 4 # skip symbol table not available\n");
+        } else {
+            for (i = 0; i < (int) (sizeof (helpers) / sizeof (*helpers)); ++i) {
+                size = symtab_size (&symtab, helpers[i], &cold, &found);
+                printf ("# %-32s %5zu bytes\n", helpers[i], size);
+                out_of_line = out_of_line && 1 == found;
+            }
+            printf ("%s - 4 - slow path helpers are out of line\n", status (out_of_line));
+
+            size = symtab_size (&symtab, "job_unref", &cold, &found);
+            printf ("# %-32s %5zu bytes hot, %zu bytes cold\n", "job_unref", size, cold);
+            size = symtab_size (&symtab, "variant_", &cold, &found);
+            printf ("# %-32s %5zu bytes hot, %zu bytes cold (%d functions)\n", "variant_*", size, cold, found);
+            printf ("# %-32s %5zu bytes hot, %zu bytes cold\n", "per variant", size / VARIANTS, cold / VARIANTS);
+        }
+        free (symtab.image);
+    }
+#else
+    printf ("ok - 4 # skip symbol table not available\n");
+#endif
+
+    /* cold: walk all variants, instruction cache is thrashed */
+    for (j = 0; j < VARIANTS; ++j)
+        expected += variants[j] (job);
+    expected *= BENCH_ROUNDS;
+
+    start = now ();
+    for (i = 0; i < BENCH_ROUNDS; ++i)
+        for (j = 0; j < VARIANTS; ++j)
+            sum += variants[j] (job);
+    cold_time = now () - start;
+
+    /* hot: the same number of calls of single variant */
+    start = now ();
+    for (i = 0; i < BENCH_ROUNDS; ++i)
+        for (j = 0; j < VARIANTS; ++j)
+            variants[0] (job);
+    hot_time = now () - start;
+
+    printf ("%s - 5 - every variant was evaluated\n", status (sum == expected && 1 == job->CMX_STRUCT_REFS_NAME));
+
+    printf ("# %d variants: %.1f ns / call\n", VARIANTS, cold_time * 1e9 / BENCH_ROUNDS / VARIANTS);
+    printf ("# single variant: %.1f ns / call\n", hot_time * 1e9 / BENCH_ROUNDS / VARIANTS);
+
+    job_unref (job);
+
+    return failed;
+}
@@ -0,0 +1,105 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include <cmx/cmx-lazy.h>
+
+#define THREADS 4
+
+struct Value {
+    int id;
+};
+
+CMX_ATOMIC_PTR_TYPE (struct Value) value;
+CMX_ATOMIC_INT_TYPE builds;
+CMX_ATOMIC_INT_TYPE destroys;
+CMX_ATOMIC_INT_TYPE ready;
+
+struct Value * build (void) {
+    struct Value *retval = malloc (sizeof (*retval));
+
+    retval->id = CMX_ATOMIC_INT_FETCH_ADD (builds, 1) + 1;
+
+    /* let other threads race */
+    while (CMX_ATOMIC_INT_LOAD (ready) < THREADS)
+        sched_yield ();
+
+    return retval;
+}
+
+struct Value * get_value (void) {
+    struct Value *candidate;
+
+    CMX_LAZY_INIT (value, candidate) {
+        candidate = build ();
+    } else {
+        CMX_ATOMIC_INT_FETCH_ADD (destroys, 1);
+        free (candidate);
+    }
+
+    return CMX_ATOMIC_PTR_LOAD (value);
+}
+
+void * worker (void *arg) {
+    (void) arg;
+    CMX_ATOMIC_INT_FETCH_ADD (ready, 1);
+    return get_value ();
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    struct Value *result[THREADS];
+    struct Value *candidate;
+    int same = 1;
+    int i;
+
+    printf ("1..8\n");
+
+    CMX_ATOMIC_INT_STORE (ready, THREADS);
+    CMX_LAZY_INIT (value, candidate) {
+        break;
+    }
+    printf ("%s - 1 - break publishes nothing\n", status (NULL == CMX_ATOMIC_PTR_LOAD (value)));
+
+    candidate = get_value ();
+    printf ("%s - 2 - value built and published\n", status (NULL != candidate && 1 == CMX_ATOMIC_INT_LOAD (builds)));
+    printf ("%s - 3 - published value is not rebuilt\n", status (candidate == get_value () && 1 == CMX_ATOMIC_INT_LOAD (builds)));
+    printf ("%s - 4 - else clause not evaluated without race\n", status (0 == CMX_ATOMIC_INT_LOAD (destroys)));
+    free (candidate);
+
+    CMX_ATOMIC_PTR_STORE (value, NULL);
+    CMX_ATOMIC_INT_STORE (builds, 0);
+    CMX_ATOMIC_INT_STORE (ready, 0);
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], (void **) &result[i]);
+
+    for (i = 0; i < THREADS; ++i)
+        if (result[i] != CMX_ATOMIC_PTR_LOAD (value))
+            same = 0;
+
+    printf ("%s - 5 - all threads see published value\n", status (same && NULL != result[0]));
+    printf ("%s - 6 - racing threads built candidates\n", status (CMX_ATOMIC_INT_LOAD (builds) >= 1));
+    printf ("%s - 7 - losers destroyed their candidates\n", status (CMX_ATOMIC_INT_LOAD (builds) - 1 == CMX_ATOMIC_INT_LOAD (destroys)));
+    printf ("# %d racing builds\n", CMX_ATOMIC_INT_LOAD (builds));
+
+    CMX_LAZY_INIT (value, candidate) {
+        candidate = NULL;
+        same = 0;
+    }
+    printf ("%s - 8 - block skipped when value is set\n", status (same));
+
+    free (CMX_ATOMIC_PTR_LOAD (value));
+
+    return failed;
+}
@@ -0,0 +1,114 @@
+
+#include <stdio.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-limit.h>
+
+#define THREADS 16
+#define ITEMS   1000
+#define SLOTS   3
+
+CMX_SEMAPHORE_DEFINE semaphore = CMX_SEMAPHORE_INITIALIZER (SLOTS);
+CMX_ATOMIC_INT_TYPE inside;
+CMX_ATOMIC_INT_TYPE max_inside;
+CMX_ATOMIC_INT_TYPE evaluated;
+
+void * worker (void *arg) {
+    int current;
+    int max;
+    int i;
+
+    (void) arg;
+    for (i = 0; i < ITEMS; ++i)
+        CMX_LIMIT (&semaphore) {
+            current = CMX_ATOMIC_INT_FETCH_ADD (inside, 1) + 1;
+            max = CMX_ATOMIC_INT_LOAD (max_inside);
+            while (current > max && ! CMX_ATOMIC_INT_COMPARE_EXCHANGE (max_inside, max, current))
+                ;
+            sched_yield ();
+            CMX_ATOMIC_INT_FETCH_ADD (evaluated, 1);
+            CMX_ATOMIC_INT_FETCH_SUB (inside, 1);
+        }
+
+    return NULL;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+int t_try (void) {
+    int retval = 0;
+
+    CMX_LIMIT_TRY (&semaphore) {
+        retval = SLOTS - 1 == CMX_SEMAPHORE_AVAILABLE (&semaphore);
+    } else {
+        retval = 0;
+    }
+
+    return retval && SLOTS == CMX_SEMAPHORE_AVAILABLE (&semaphore);
+}
+
+int t_try_else (void) {
+    int retval = 0;
+    int i;
+
+    for (i = 0; i < SLOTS; ++i)
+        CMX_SEMAPHORE_ACQUIRE (&semaphore);
+
+    CMX_LIMIT_TRY (&semaphore) {
+        retval = 0;
+    } else {
+        retval = 0 == CMX_SEMAPHORE_AVAILABLE (&semaphore);
+    }
+
+    for (i = 0; i < SLOTS; ++i)
+        CMX_SEMAPHORE_RELEASE (&semaphore);
+
+    return retval && SLOTS == CMX_SEMAPHORE_AVAILABLE (&semaphore);
+}
+
+int t_break (void) {
+    int reached = 0;
+
+    CMX_LIMIT (&semaphore) {
+        if (SLOTS - 1 == CMX_SEMAPHORE_AVAILABLE (&semaphore))
+            break;
+        reached = 1;
+    }
+
+    CMX_LIMIT_TRY (&semaphore) {
+        if (SLOTS - 1 == CMX_SEMAPHORE_AVAILABLE (&semaphore))
+            break;
+        reached = 1;
+    }
+
+    return ! reached && SLOTS == CMX_SEMAPHORE_AVAILABLE (&semaphore);
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    int i;
+
+    printf ("1..6\n");
+
+    printf ("%s - 1 - try acquires available slot\n", status (t_try ()));
+    printf ("%s - 2 - try evaluates else-clause when no slot is available\n", status (t_try_else ()));
+    printf ("%s - 3 - slot is released on break\n", status (t_break ()));
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+
+    printf ("%s - 4 - every block evaluated\n", status (THREADS * ITEMS == CMX_ATOMIC_INT_LOAD (evaluated)));
+    printf ("%s - 5 - concurrency is limited\n", status (SLOTS >= CMX_ATOMIC_INT_LOAD (max_inside)));
+    printf ("%s - 6 - all slots released, no waiter left\n", status (SLOTS == CMX_ATOMIC_INT_LOAD (semaphore.state)));
+
+    return failed;
+}
@@ -0,0 +1,127 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <cmx/cmx-queue-mpsc.h>
+
+#define PRODUCERS 4
+#define ITEMS     100000
+
+struct Msg {
+    int producer;
+    int seq;
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_QUEUE_MPSC_NODE_DEFINE (link);
+};
+
+CMX_QUEUE_MPSC_DEFINE (struct Msg, link) queue;
+
+void * producer (void *arg) {
+    int id = (int) (size_t) arg;
+    int i;
+
+    for (i = 0; i < ITEMS; ++i) {
+        struct Msg *msg = malloc (sizeof (*msg));
+        msg->producer = id;
+        msg->seq = i;
+        CMX_QUEUE_MPSC_PUSH (&queue, msg);
+    }
+
+    return NULL;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+void check_single_thread (void) {
+    struct Msg data[3];
+    struct Msg *msg;
+    int i;
+    int order = 1;
+
+    CMX_QUEUE_MPSC_INIT (&queue);
+
+    printf ("  1..7\n");
+    printf ("  %s 1 - empty queue pops NULL\n", status (NULL == CMX_QUEUE_MPSC_POP (&queue)));
+
+    for (i = 0; i < 3; ++i) {
+        data[i].seq = i;
+        CMX_STRUCT_REFS_INIT (&data[i]);
+        CMX_QUEUE_MPSC_PUSH_REF (&queue, &data[i]);
+    }
+
+    printf ("  %s 2 - push ref takes reference\n", status (data[0].CMX_STRUCT_REFS_NAME == 2));
+
+    for (i = 0; i < 3; ++i) {
+        msg = CMX_QUEUE_MPSC_POP (&queue);
+        if (msg != &data[i])
+            order = 0;
+    }
+    printf ("  %s 3 - items popped in push order\n", status (order));
+    printf ("  %s 4 - drained queue pops NULL\n", status (NULL == CMX_QUEUE_MPSC_POP (&queue)));
+
+    CMX_QUEUE_MPSC_PUSH (&queue, &data[1]);
+    printf ("  %s 5 - reuse after drain\n", status (&data[1] == CMX_QUEUE_MPSC_POP (&queue)));
+    printf ("  %s 6 - empty again\n", status (NULL == CMX_QUEUE_MPSC_POP (&queue)));
+    printf ("  %s 7 - push doesn't take reference\n", status (data[1].CMX_STRUCT_REFS_NAME == 2));
+}
+
+void check_multi_thread (void) {
+    pthread_t threads[PRODUCERS];
+    int next[PRODUCERS] = { 0 };
+    int received = 0;
+    int order = 1;
+    int i;
+
+    CMX_QUEUE_MPSC_INIT (&queue);
+
+    for (i = 0; i < PRODUCERS; ++i)
+        pthread_create (&threads[i], NULL, producer, (void *) (size_t) i);
+
+    while (received < PRODUCERS * ITEMS) {
+        struct Msg *msg = CMX_QUEUE_MPSC_POP (&queue);
+
+        if (NULL == msg)
+            continue;
+
+        if (msg->seq != next[msg->producer])
+            order = 0;
+        next[msg->producer] = msg->seq + 1;
+        ++received;
+        free (msg);
+    }
+
+    for (i = 0; i < PRODUCERS; ++i)
+        pthread_join (threads[i], NULL);
+
+    printf ("  1..3\n");
+    printf ("  %s 1 - all items received\n", status (received == PRODUCERS * ITEMS));
+    printf ("  %s 2 - per producer order preserved\n", status (order));
+    printf ("  %s 3 - queue empty\n", status (NULL == CMX_QUEUE_MPSC_POP (&queue)));
+}
+
+void subtest (int num, const char * name, void (*function) (void)) {
+    int local = failed;
+
+    failed = 0;
+    function ();
+
+    printf ("  # %s\n", name);
+    printf ("%s %d - %s\n", status (failed == 0), num, name);
+
+    if (failed) local ++;
+    failed = local;
+}
+
+int main (void) {
+    printf ("1..2\n");
+
+    subtest (1, "single thread workflow", check_single_thread);
+    subtest (2, "multiple producers", check_multi_thread);
+
+    return failed;
+}
@@ -0,0 +1,118 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-reaper.h>
+
+#define THREADS 4
+#define ITEMS   10000
+
+struct Obj {
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_REAPER_NODE_DEFINE;
+    pthread_t owner;
+};
+
+struct CMX_Reaper reaper;
+CMX_ATOMIC_INT_TYPE destroyed;
+CMX_ATOMIC_INT_TYPE inline_destroyed;
+CMX_ATOMIC_INT_TYPE alive;
+CMX_ATOMIC_INT_TYPE gate;
+
+void obj_destroy (void *ptr) {
+    struct Obj *self = ptr;
+
+    /* test of backpressure keeps reaper busy */
+    while (CMX_ATOMIC_INT_LOAD (gate) && ! pthread_equal (self->owner, pthread_self ()))
+        sched_yield ();
+
+    if (pthread_equal (self->owner, pthread_self ()))
+        CMX_ATOMIC_INT_FETCH_ADD (inline_destroyed, 1);
+    CMX_ATOMIC_INT_FETCH_ADD (destroyed, 1);
+    free (self);
+}
+
+struct Obj * obj_new (void) {
+    struct Obj *retval = malloc (sizeof (*retval));
+
+    CMX_STRUCT_REFS_INIT (retval);
+    retval->owner = pthread_self ();
+
+    return retval;
+}
+
+struct Obj * obj_ref (struct Obj *self) {
+    CMX_STRUCT_REFS_REF (self);
+}
+
+void obj_unref (struct Obj *self) {
+    CMX_STRUCT_REFS_UNREF_ASYNC (self, &reaper, obj_destroy);
+    else
+        CMX_ATOMIC_INT_FETCH_ADD (alive, 1);
+}
+
+void * worker (void *arg) {
+    int i;
+
+    (void) arg;
+    for (i = 0; i < ITEMS; ++i)
+        obj_unref (obj_new ());
+
+    return NULL;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    struct Obj *obj;
+    int i;
+
+    printf ("1..8\n");
+
+    printf ("%s - 1 - reaper started\n", status (0 == CMX_REAPER_START (&reaper, 1 << 20)));
+
+    obj = obj_ref (obj_new ());
+    obj_unref (obj);
+    printf ("%s - 2 - else clause when object is alive\n", status (1 == CMX_ATOMIC_INT_LOAD (alive)));
+
+    obj_unref (obj);
+    CMX_REAPER_FLUSH (&reaper);
+    printf ("%s - 3 - object destroyed after flush\n", status (1 == CMX_ATOMIC_INT_LOAD (destroyed)));
+    printf ("%s - 4 - object destroyed by reaper thread\n", status (0 == CMX_ATOMIC_INT_LOAD (inline_destroyed)));
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+    CMX_REAPER_FLUSH (&reaper);
+
+    printf ("%s - 5 - objects of all threads destroyed\n", status (1 + THREADS * ITEMS == CMX_ATOMIC_INT_LOAD (destroyed)));
+    CMX_REAPER_STOP (&reaper);
+
+    /* backpressure */
+    CMX_ATOMIC_INT_STORE (destroyed, 0);
+    CMX_REAPER_START (&reaper, 4);
+    CMX_ATOMIC_INT_STORE (gate, 1);
+    for (i = 0; i < 4; ++i)
+        obj_unref (obj_new ());
+    printf ("%s - 6 - objects under limit are queued\n", status (0 == CMX_REAPER_OVERFLOWS (&reaper)));
+
+    for (i = 0; i < 4; ++i)
+        obj_unref (obj_new ());
+    printf ("%s - 7 - objects over limit are destroyed inline\n", status (4 == CMX_REAPER_OVERFLOWS (&reaper) && 4 == CMX_ATOMIC_INT_LOAD (inline_destroyed)));
+
+    CMX_ATOMIC_INT_STORE (gate, 0);
+    CMX_REAPER_STOP (&reaper);
+    printf ("%s - 8 - stop destroys pending objects\n", status (8 == CMX_ATOMIC_INT_LOAD (destroyed)));
+
+    return failed;
+}
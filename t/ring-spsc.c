@@ -0,0 +1,137 @@
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <cmx/cmx-ring-spsc.h>
+
+#define ITEMS 10000000
+#define BATCH 32
+
+CMX_RING_SPSC_DEFINE (unsigned, 1024) ring;
+CMX_RING_SPSC_DEFINE (int, 4) small;
+
+void * producer (void *arg) {
+    unsigned next = 0;
+
+    (void) arg;
+
+    while (next < ITEMS) {
+        size_t n = CMX_RING_SPSC_RESERVE (&ring, BATCH);
+        size_t i;
+
+        if (0 == n)
+            sched_yield ();
+
+        for (i = 0; i < n && next < ITEMS; ++i)
+            CMX_RING_SPSC_SLOT (&ring, i) = next++;
+
+        CMX_RING_SPSC_COMMIT (&ring, i);
+    }
+
+    return NULL;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+void check_single_thread (void) {
+    int value = 0;
+    int order = 1;
+    int i;
+
+    CMX_RING_SPSC_INIT (&small);
+
+    printf ("  1..10\n");
+    printf ("  %s 1 - capacity\n", status (CMX_RING_SPSC_CAPACITY (&small) == 4));
+    printf ("  %s 2 - empty ring pops nothing\n", status (! CMX_RING_SPSC_POP (&small, value)));
+    printf ("  %s 3 - reserve limited by capacity\n", status (CMX_RING_SPSC_RESERVE (&small, 10) == 4));
+
+    for (i = 0; i < 3; ++i)
+        CMX_RING_SPSC_SLOT (&small, i) = i + 1;
+
+    printf ("  %s 4 - reserved slots are not visible\n", status (CMX_RING_SPSC_PEEK (&small, 4) == 0));
+
+    CMX_RING_SPSC_COMMIT (&small, 3);
+
+    printf ("  %s 5 - committed slots are visible\n", status (CMX_RING_SPSC_PEEK (&small, 4) == 3));
+    printf ("  %s 6 - push into last slot\n", status (CMX_RING_SPSC_PUSH (&small, 4)));
+    printf ("  %s 7 - push into full ring fails\n", status (! CMX_RING_SPSC_PUSH (&small, 5)));
+
+    for (i = 0; i < 4; ++i)
+        if (CMX_RING_SPSC_ITEM (&small, i) != i + 1)
+            order = 0;
+    printf ("  %s 8 - peeked items\n", status (order));
+
+    CMX_RING_SPSC_RELEASE (&small, 2);
+    printf ("  %s 9 - released slots can be reserved\n", status (CMX_RING_SPSC_RESERVE (&small, 4) == 2));
+
+    CMX_RING_SPSC_PUSH (&small, 5);
+    CMX_RING_SPSC_POP (&small, value);
+    CMX_RING_SPSC_POP (&small, value);
+    CMX_RING_SPSC_POP (&small, value);
+    printf ("  %s 10 - wrapped around\n", status (value == 5));
+}
+
+void check_two_threads (void) {
+    struct timespec start, end;
+    pthread_t thread;
+    unsigned expect = 0;
+    int order = 1;
+    double elapsed;
+
+    CMX_RING_SPSC_INIT (&ring);
+
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    pthread_create (&thread, NULL, producer, NULL);
+
+    while (expect < ITEMS) {
+        size_t n = CMX_RING_SPSC_PEEK (&ring, BATCH);
+        size_t i;
+
+        if (0 == n)
+            sched_yield ();
+
+        for (i = 0; i < n; ++i)
+            if (CMX_RING_SPSC_ITEM (&ring, i) != expect++)
+                order = 0;
+
+        CMX_RING_SPSC_RELEASE (&ring, n);
+    }
+
+    pthread_join (thread, NULL);
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf ("  1..2\n");
+    printf ("  %s 1 - all items received in order\n", status (order && expect == ITEMS));
+    printf ("  %s 2 - ring empty\n", status (CMX_RING_SPSC_PEEK (&ring, 1) == 0));
+    printf ("  # %.1f M items/s\n", ITEMS / elapsed / 1e6);
+}
+
+void subtest (int num, const char * name, void (*function) (void)) {
+    int local = failed;
+
+    failed = 0;
+    function ();
+
+    printf ("  # %s\n", name);
+    printf ("%s %d - %s\n", status (failed == 0), num, name);
+
+    if (failed) local ++;
+    failed = local;
+}
+
+int main (void) {
+    printf ("1..2\n");
+
+    subtest (1, "single thread workflow", check_single_thread);
+    subtest (2, "producer and consumer threads", check_two_threads);
+
+    return failed;
+}
@@ -0,0 +1,156 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-rseq.h>
+
+#define THREADS 4
+#define ITEMS   100000
+#define BLOCKS  64
+
+/* benchmark: counter increments */
+#define BENCH_OPS 10000000
+
+struct CMX_Percpu_Counter counter;
+struct CMX_Percpu_Counter maximum;
+struct CMX_Percpu_List list;
+CMX_ATOMIC_INT64_TYPE shared;
+CMX_ATOMIC_INT_TYPE duplicates;
+
+struct Block {
+    void *link;
+    int used;
+};
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void * worker (void *arg) {
+    int64_t value;
+    struct Block *blocks[BLOCKS];
+    int i;
+    int j;
+
+    for (i = 0; i < ITEMS; ++i) {
+        CMX_PERCPU_ADD (&counter, 1);
+
+        value = CMX_PERCPU_LOAD (&maximum);
+        while (value < i && ! CMX_PERCPU_COMPARE_STORE (&maximum, value, (int64_t) i))
+            ;
+    }
+
+    /* every block is owned by one thread between pop and push */
+    for (i = 0; i < ITEMS / BLOCKS; ++i) {
+        for (j = 0; j < BLOCKS; ++j) {
+            blocks[j] = CMX_PERCPU_LIST_POP (&list);
+            if (NULL == blocks[j])
+                blocks[j] = calloc (1, sizeof (struct Block));
+            if (blocks[j]->used++)
+                CMX_ATOMIC_INT_FETCH_ADD (duplicates, 1);
+        }
+        for (j = 0; j < BLOCKS; ++j) {
+            blocks[j]->used = 0;
+            CMX_PERCPU_LIST_PUSH (&list, blocks[j]);
+        }
+    }
+
+    return arg;
+}
+
+void * shared_worker (void *arg) {
+    int i;
+
+    for (i = 0; i < BENCH_OPS / THREADS; ++i)
+        CMX_ATOMIC_INT64_FETCH_ADD (shared, 1);
+
+    return arg;
+}
+
+void * percpu_worker (void *arg) {
+    int i;
+
+    for (i = 0; i < BENCH_OPS / THREADS; ++i)
+        CMX_PERCPU_ADD (&counter, 1);
+
+    return arg;
+}
+
+double bench (void * (* fn) (void *)) {
+    pthread_t threads[THREADS];
+    double retval = now ();
+    int i;
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, fn, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+
+    return now () - retval;
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    struct Block *block;
+    int64_t max = 0;
+    double atomic;
+    double percpu;
+    int i;
+
+    printf ("1..7\n");
+    printf ("# rseq critical sections %s\n", CMX_PERCPU_RESTARTABLE () ? "enabled" : "disabled");
+
+    i = CMX_CPU_CURRENT ();
+    printf ("%s - 1 - current CPU is valid\n", status (i >= 0 && 0 == (CMX_PERCPU_SLOT & ~ (CMX_PERCPU_SLOTS - 1))));
+
+    CMX_PERCPU_ADD (&counter, 5);
+    printf ("%s - 2 - zero filled counter is initialized\n", status (5 == CMX_PERCPU_SUM (&counter)));
+
+    block = malloc (sizeof (*block));
+    CMX_PERCPU_LIST_PUSH (&list, block);
+    printf ("%s - 3 - pop returns block pushed on the same CPU\n", status (block == CMX_PERCPU_LIST_POP (&list) && NULL == CMX_PERCPU_LIST_POP (&list)));
+    free (block);
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+
+    printf ("%s - 4 - no increment lost\n", status (5 + THREADS * ITEMS == CMX_PERCPU_SUM (&counter)));
+
+    for (i = 0; i < CMX_PERCPU_SLOTS; ++i)
+        if (max < CMX_ATOMIC_INT64_LOAD (maximum.slots[i].value))
+            max = CMX_ATOMIC_INT64_LOAD (maximum.slots[i].value);
+    printf ("%s - 5 - compare and store keeps per-CPU maximum\n", status (ITEMS - 1 == max));
+    printf ("%s - 6 - free list block never popped twice\n", status (0 == CMX_ATOMIC_INT_LOAD (duplicates)));
+
+    CMX_PERCPU_LIST_CLEAR (&list, free);
+
+    atomic = bench (shared_worker);
+    CMX_PERCPU_COUNTER_INIT (&counter);
+    percpu = bench (percpu_worker);
+
+    printf ("%s - 7 - no increment lost by preempted threads\n", status (BENCH_OPS / THREADS * THREADS == CMX_PERCPU_SUM (&counter)));
+
+    printf (
+        "# %d threads: shared atomic %.1f ns, per-CPU %.1f ns per increment\n",
+        THREADS,
+        atomic * 1e9 / BENCH_OPS,
+        percpu * 1e9 / BENCH_OPS
+    );
+
+    return failed;
+}
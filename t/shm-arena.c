@@ -0,0 +1,135 @@
+
+#define _GNU_SOURCE 1
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define HAVE_CMX_ENV_POSIX_SHARED 1
+
+#include <cmx/cmx.h>
+#include <cmx/cmx-shm-arena.h>
+
+#define PROCS 4
+#define ITEMS 10000
+
+struct Obj {
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_STRUCT_SHAREABLE_DEFINE;
+    int value;
+};
+
+struct Obj * obj_ref (struct Obj *self) {
+    CMX_STRUCT_REFS_REF (self);
+}
+
+void obj_unref (struct Obj *self) {
+    CMX_STRUCT_REFS_UNREF (self) {
+        self->value = -1;
+    }
+}
+
+struct Obj * obj_share (struct Obj *self) {
+    CMX_STRUCT_SHAREABLE_SHARE (self) { }
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+void work (struct Obj *obj) {
+    int i;
+
+    for (i = 0; i < ITEMS; ++i) {
+        obj_ref (obj);
+        CMX_STRUCT_SHAREABLE_SYNCHRONIZE (obj)
+            ++obj->value;
+        obj_unref (obj);
+    }
+}
+
+int wait_all (int count) {
+    int retval = 1;
+    int child_status;
+
+    while (count-- > 0)
+        if (wait (&child_status) < 0 || ! WIFEXITED (child_status) || 0 != WEXITSTATUS (child_status))
+            retval = 0;
+
+    return retval;
+}
+
+int main (void) {
+    struct CMX_Shm_Arena *arena;
+    struct Obj *obj;
+    int children = 1;
+    int fd;
+    int i;
+
+    printf ("1..9\n");
+
+    arena = cmx_shm_arena_create (4096);
+    obj = cmx_shm_arena_alloc (arena, sizeof (*obj));
+    printf ("%s - 1 - allocate from arena\n", status (NULL != obj));
+    printf ("%s - 2 - allocation is aligned\n", status (0 == (size_t) obj % CMX_SHM_ARENA_ALIGN));
+    printf ("%s - 3 - offset round trip\n", status (obj == cmx_shm_arena_pointer (arena, cmx_shm_arena_offset (arena, obj))));
+    printf ("%s - 4 - exhausted arena returns NULL\n", status (NULL == cmx_shm_arena_alloc (arena, 8192)));
+
+    CMX_STRUCT_REFS_INIT (obj);
+    CMX_STRUCT_SHAREABLE_INIT (obj);
+    obj_share (obj);
+    obj->value = 0;
+
+    for (i = 0; i < PROCS; ++i)
+        if (0 == fork ()) {
+            work (obj);
+            _exit (0);
+        }
+    children = wait_all (PROCS);
+
+    printf ("%s - 5 - processes finished\n", status (children));
+    printf ("%s - 6 - synchronized updates are not lost\n", status (PROCS * ITEMS == obj->value));
+    printf ("%s - 7 - ref counter is consistent\n", status (1 == CMX_ATOMIC_INT_LOAD (obj->cmx_refs)));
+
+    /* process dies holding the mutex */
+    if (0 == fork ()) {
+        CMX_MUTEX_LOCK (obj->cmx_struct_shareable.mutex);
+        _exit (0);
+    }
+    wait_all (1);
+
+    CMX_STRUCT_SHAREABLE_SYNCHRONIZE (obj)
+        ++obj->value;
+    printf ("%s - 8 - mutex recovered after owner died\n", status (PROCS * ITEMS + 1 == obj->value));
+
+    cmx_shm_arena_destroy (arena);
+
+    /* arena attached by file descriptor */
+    fd = memfd_create ("cmx-shm-arena", 0);
+    arena = cmx_shm_arena_create_fd (fd, 4096);
+    obj = cmx_shm_arena_alloc (arena, sizeof (*obj));
+    CMX_STRUCT_REFS_INIT (obj);
+    CMX_STRUCT_SHAREABLE_INIT (obj);
+    obj_share (obj);
+    obj->value = 0;
+
+    for (i = 0; i < PROCS; ++i)
+        if (0 == fork ()) {
+            struct CMX_Shm_Arena *attached = cmx_shm_arena_attach (fd);
+
+            work (cmx_shm_arena_pointer (attached, cmx_shm_arena_offset (arena, obj)));
+            cmx_shm_arena_destroy (attached);
+            _exit (0);
+        }
+    children = wait_all (PROCS);
+
+    printf ("%s - 9 - attached arena shares data\n", status (children && PROCS * ITEMS == obj->value));
+
+    cmx_shm_arena_destroy (arena);
+    close (fd);
+
+    return failed;
+}
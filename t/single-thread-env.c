@@ -0,0 +1,4 @@
+
+#define HAVE_CMX_ENV_SINGLE_THREAD 1
+
+#include "single-thread.c"
@@ -0,0 +1,117 @@
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#ifndef HAVE_CMX_ENV_SINGLE_THREAD
+#define HAVE_CMX_ENV_POSIX 1
+#endif
+
+#include <cmx/cmx.h>
+
+#define ITEMS 1000000
+
+struct Obj {
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_STRUCT_SHAREABLE_DEFINE;
+    int value;
+};
+
+struct Obj obj;
+CMX_MUTEX_TYPE mutex;
+int destroyed = 0;
+
+struct Obj * obj_ref (struct Obj *self) {
+    CMX_STRUCT_REFS_REF (self);
+}
+
+void obj_unref (struct Obj *self) {
+    CMX_STRUCT_REFS_UNREF (self) {
+        ++destroyed;
+    }
+}
+
+struct Obj * obj_share (struct Obj *self) {
+    CMX_STRUCT_SHAREABLE_SHARE (self) {
+    }
+}
+
+void obj_increment (struct Obj *self) {
+    CMX_STRUCT_SHAREABLE_SYNCHRONIZE (self)
+        ++self->value;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+double workload (void) {
+    double start = now ();
+    int i;
+
+    for (i = 0; i < ITEMS; ++i) {
+        obj_unref (obj_ref (&obj));
+        obj_increment (&obj);
+        CMX_SYNCHRONIZE_WITH (&mutex)
+            ++obj.value;
+    }
+
+    return now () - start;
+}
+
+void * noop (void *arg) {
+    return arg;
+}
+
+int main (void) {
+    pthread_t thread;
+    double single;
+    double multi;
+
+    printf ("1..5\n");
+
+    CMX_STRUCT_REFS_INIT (&obj);
+    CMX_STRUCT_SHAREABLE_INIT (&obj);
+    obj_share (&obj);
+    CMX_MUTEX_INIT (mutex);
+    obj.value = 0;
+
+    printf (
+        "%s - 1 - process starts single threaded%s\n",
+        status (CMX_SINGLE_THREAD_P ()),
+        CMX_SINGLE_THREAD_P () ? "" : " # SKIP runtime detection not available"
+    );
+    if (! CMX_SINGLE_THREAD_P ())
+        failed = 0;
+
+    single = workload ();
+    printf ("%s - 2 - single thread mode workload\n", status (2 * ITEMS == obj.value && 0 == destroyed));
+
+    pthread_create (&thread, NULL, noop, NULL);
+    pthread_join (thread, NULL);
+
+#ifndef HAVE_CMX_ENV_SINGLE_THREAD
+    printf ("%s - 3 - single thread mode ends with first thread\n", status (! CMX_SINGLE_THREAD_P ()));
+#else
+    printf ("%s - 3 - single thread env stays single threaded\n", status (CMX_SINGLE_THREAD_P ()));
+#endif
+
+    multi = workload ();
+    printf ("%s - 4 - multi thread mode workload\n", status (4 * ITEMS == obj.value && 0 == destroyed));
+
+    obj_unref (&obj);
+    printf ("%s - 5 - last unref destroys\n", status (1 == destroyed));
+
+    printf ("# single thread: %.1f ns, multi thread: %.1f ns per iteration\n", single * 1e9 / ITEMS, multi * 1e9 / ITEMS);
+
+    return failed;
+}
@@ -0,0 +1,134 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cmx/cmx-struct-cow.h>
+
+struct Snapshot {
+    CMX_STRUCT_REFS_DEFINE;
+    int value;
+};
+
+int copies = 0;
+int destroyed = 0;
+int copy_fails = 0;
+
+struct Snapshot * snapshot_new (int value) {
+    struct Snapshot *retval = malloc (sizeof (*retval));
+
+    CMX_STRUCT_REFS_INIT (retval);
+    retval->value = value;
+
+    return retval;
+}
+
+struct Snapshot * snapshot_ref (struct Snapshot *self) {
+    CMX_STRUCT_REFS_REF (self);
+}
+
+void snapshot_unref (struct Snapshot *self) {
+    CMX_STRUCT_REFS_UNREF (self) {
+        ++destroyed;
+        free (self);
+    }
+}
+
+struct Snapshot * snapshot_clone (struct Snapshot *self) {
+    if (copy_fails)
+        return NULL;
+
+    ++copies;
+    return snapshot_new (self->value);
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+int t_in_place (void) {
+    struct Snapshot *writer = snapshot_new (1);
+    struct Snapshot *original = writer;
+
+    CMX_STRUCT_COW_WRITE (writer, snapshot_clone, snapshot_unref) {
+        writer->value = 2;
+    }
+
+    snapshot_unref (writer);
+
+    return original == writer && 0 == copies && 1 == destroyed;
+}
+
+int t_copy (void) {
+    struct Snapshot *reader = snapshot_new (1);
+    struct Snapshot *writer = snapshot_ref (reader);
+    int retval;
+
+    copies = destroyed = 0;
+    CMX_STRUCT_COW_WRITE (writer, snapshot_clone, snapshot_unref) {
+        writer->value = 2;
+    }
+
+    retval = reader != writer
+        && 1 == copies
+        && 1 == reader->value
+        && 2 == writer->value
+        && 1 == CMX_ATOMIC_INT_LOAD (reader->cmx_refs)
+        && 1 == CMX_ATOMIC_INT_LOAD (writer->cmx_refs);
+
+    snapshot_unref (reader);
+    snapshot_unref (writer);
+
+    return retval && 2 == destroyed;
+}
+
+int t_copy_failed (void) {
+    struct Snapshot *reader = snapshot_new (1);
+    struct Snapshot *writer = snapshot_ref (reader);
+    int modified = 0;
+    int handled = 0;
+
+    copy_fails = 1;
+    CMX_STRUCT_COW_WRITE (writer, snapshot_clone, snapshot_unref) {
+        modified = 1;
+    } else {
+        handled = 1;
+    }
+    copy_fails = 0;
+
+    snapshot_unref (writer);
+    snapshot_unref (reader);
+
+    return ! modified && handled && reader == writer;
+}
+
+int t_break (void) {
+    struct Snapshot *writer = snapshot_new (1);
+    int reached = 0;
+    int retval;
+
+    do {
+        CMX_STRUCT_COW_WRITE (writer, snapshot_clone, snapshot_unref) {
+            if (1 == writer->value)
+                break;
+            reached = 1;
+        }
+        reached |= 2;
+    } while (0);
+
+    retval = 2 == reached;
+    snapshot_unref (writer);
+
+    return retval;
+}
+
+int main (void) {
+    printf ("1..4\n");
+    printf ("%s - 1 - exclusive struct is modified in place\n", status (t_in_place ()));
+    printf ("%s - 2 - shared struct is copied, original kept for readers\n", status (t_copy ()));
+    printf ("%s - 3 - else-clause evaluated when copy fails\n", status (t_copy_failed ()));
+    printf ("%s - 4 - break leaves only block\n", status (t_break ()));
+
+    return failed;
+}
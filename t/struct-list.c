@@ -0,0 +1,105 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cmx/cmx-struct-list.h>
+
+struct Job {
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_STRUCT_LIST_DEFINE (link);
+    CMX_STRUCT_LIST_DEFINE (other);
+    int value;
+};
+
+typedef CMX_STRUCT_LIST_HEAD_DEFINE (struct Job, link) Jobs;
+
+int destroyed = 0;
+
+struct Job * job_new (int value) {
+    struct Job *retval = malloc (sizeof (*retval));
+
+    CMX_STRUCT_REFS_INIT (retval);
+    retval->value = value;
+
+    return retval;
+}
+
+void job_unref (struct Job *self) {
+    CMX_STRUCT_REFS_UNREF (self) {
+        ++destroyed;
+        free (self);
+    }
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+int sequence (Jobs *jobs, const char *expected) {
+    struct Job *job;
+
+    CMX_STRUCT_LIST_FOREACH (jobs, job) {
+        if (*expected++ != '0' + job->value)
+            return 0;
+    }
+
+    return '\0' == *expected;
+}
+
+int main (void) {
+    CMX_STRUCT_LIST_HEAD_DEFINE (struct Job, other) others;
+    Jobs jobs;
+    struct Job *job;
+    struct Job *first;
+    int visited;
+    int i;
+
+    printf ("1..8\n");
+
+    CMX_STRUCT_LIST_INIT (&jobs);
+    printf ("%s - 1 - initialized list is empty\n", status (CMX_STRUCT_LIST_EMPTY_P (&jobs) && NULL == CMX_STRUCT_LIST_FIRST (&jobs) && NULL == CMX_STRUCT_LIST_LAST (&jobs)));
+
+    for (i = 1; i <= 5; ++i) {
+        job = job_new (i);
+        CMX_STRUCT_LIST_INSERT_TAIL (&jobs, job);
+    }
+    job = job_new (0);
+    CMX_STRUCT_LIST_INSERT_HEAD (&jobs, job);
+    printf ("%s - 2 - items are kept in insertion order\n", status (sequence (&jobs, "012345") && 6 == CMX_STRUCT_LIST_COUNT (&jobs)));
+    printf ("%s - 3 - first and last item\n", status (0 == ((struct Job *) CMX_STRUCT_LIST_FIRST (&jobs))->value && 5 == ((struct Job *) CMX_STRUCT_LIST_LAST (&jobs))->value));
+
+    CMX_STRUCT_LIST_FOREACH (&jobs, job) {
+        if (job->value % 2) {
+            CMX_STRUCT_LIST_REMOVE (&jobs, job);
+            job_unref (job);
+        }
+    }
+    printf ("%s - 4 - current item can be removed while iterating\n", status (sequence (&jobs, "024") && 3 == destroyed));
+
+    visited = 0;
+    CMX_STRUCT_LIST_FOREACH (&jobs, job) {
+        if (2 == job->value)
+            break;
+        ++visited;
+    }
+    printf ("%s - 5 - break leaves iteration\n", status (1 == visited && 2 == job->value));
+
+    CMX_STRUCT_LIST_INIT (&others);
+    CMX_STRUCT_LIST_FOREACH (&jobs, job)
+        CMX_STRUCT_LIST_INSERT_HEAD_REF (&others, job);
+    first = CMX_STRUCT_LIST_FIRST (&others);
+    printf ("%s - 6 - item can be member of more lists, _REF takes reference\n", status (4 == first->value && 2 == CMX_ATOMIC_INT_LOAD (first->cmx_refs)));
+
+    CMX_STRUCT_LIST_REMOVE (&others, first);
+    job_unref (first);
+    printf ("%s - 7 - remove passes reference to caller\n", status (2 == CMX_STRUCT_LIST_COUNT (&others) && 1 == CMX_ATOMIC_INT_LOAD (first->cmx_refs) && 3 == destroyed));
+
+    destroyed = 0;
+    CMX_STRUCT_LIST_CLEAR (&others, job_unref);
+    CMX_STRUCT_LIST_CLEAR (&jobs, job_unref);
+    printf ("%s - 8 - clear releases all references\n", status (CMX_STRUCT_LIST_EMPTY_P (&jobs) && CMX_STRUCT_LIST_EMPTY_P (&others) && 3 == destroyed));
+
+    return failed;
+}
@@ -0,0 +1,163 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <cmx/cmx-struct-rbtree.h>
+
+#define ITEMS 1000
+
+struct Timer {
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_STRUCT_RBTREE_DEFINE (by_id);
+    int id;
+};
+
+typedef CMX_STRUCT_RBTREE_HEAD_DEFINE (struct Timer, by_id) Timers;
+
+int destroyed = 0;
+
+struct Timer * timer_new (int id) {
+    struct Timer *retval = malloc (sizeof (*retval));
+
+    CMX_STRUCT_REFS_INIT (retval);
+    retval->id = id;
+
+    return retval;
+}
+
+void timer_unref (struct Timer *self) {
+    CMX_STRUCT_REFS_UNREF (self) {
+        ++destroyed;
+        free (self);
+    }
+}
+
+int timer_compare (const void *a, const void *b) {
+    const struct Timer *x = a;
+    const struct Timer *y = b;
+
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+/* returns black height, -1 if red-black properties are violated */
+int black_height (struct _CMX_Struct_Rbtree_Link *link) {
+    int left;
+    int right;
+
+    if (NULL == link)
+        return 1;
+
+    if (link->left && link->left->parent != link)
+        return -1;
+    if (link->right && link->right->parent != link)
+        return -1;
+    if (link->red && ((link->left && link->left->red) || (link->right && link->right->red)))
+        return -1;
+
+    left = black_height (link->left);
+    right = black_height (link->right);
+    if (left < 0 || left != right)
+        return -1;
+
+    return left + ! link->red;
+}
+
+int valid (Timers *timers) {
+    struct Timer *timer;
+    size_t count = 0;
+    int last = -1;
+
+    if (timers->tree.root && (timers->tree.root->red || timers->tree.root->parent))
+        return 0;
+    if (black_height (timers->tree.root) < 0)
+        return 0;
+
+    CMX_STRUCT_RBTREE_FOREACH (timers, timer) {
+        if (timer->id <= last)
+            return 0;
+        last = timer->id;
+        ++count;
+    }
+
+    return count == CMX_STRUCT_RBTREE_COUNT (timers);
+}
+
+int main (void) {
+    Timers timers;
+    struct Timer probe;
+    struct Timer *timer;
+    struct Timer *found;
+    int ids[ITEMS];
+    int inserted = 1;
+    int retval;
+    int visited;
+    int i;
+    int j;
+
+    printf ("1..8\n");
+
+    CMX_STRUCT_RBTREE_INIT (&timers);
+    printf ("%s - 1 - initialized tree is empty\n", status (CMX_STRUCT_RBTREE_EMPTY_P (&timers) && NULL == CMX_STRUCT_RBTREE_FIRST (&timers)));
+
+    /* shuffled unique ids */
+    srand (42);
+    for (i = 0; i < ITEMS; ++i)
+        ids[i] = i * 3;
+    for (i = ITEMS - 1; i > 0; --i) {
+        j = rand () % (i + 1);
+        retval = ids[i]; ids[i] = ids[j]; ids[j] = retval;
+    }
+
+    for (i = 0; i < ITEMS; ++i) {
+        timer = timer_new (ids[i]);
+        inserted &= NULL == CMX_STRUCT_RBTREE_INSERT (&timers, timer, timer_compare);
+    }
+    printf ("%s - 2 - inserted items are balanced and ordered\n", status (inserted && ITEMS == CMX_STRUCT_RBTREE_COUNT (&timers) && valid (&timers)));
+
+    probe.id = 300;
+    found = CMX_STRUCT_RBTREE_FIND (&timers, &probe, timer_compare);
+    probe.id = 301;
+    printf ("%s - 3 - find\n", status (found && 300 == found->id && NULL == CMX_STRUCT_RBTREE_FIND (&timers, &probe, timer_compare)));
+
+    timer = timer_new (300);
+    retval = found == CMX_STRUCT_RBTREE_INSERT (&timers, timer, timer_compare);
+    retval = retval && 0 == CMX_STRUCT_RBTREE_INSERT_REF (&timers, timer, timer_compare);
+    printf ("%s - 4 - equal item is not inserted\n", status (retval && 1 == CMX_ATOMIC_INT_LOAD (timer->cmx_refs) && ITEMS == CMX_STRUCT_RBTREE_COUNT (&timers)));
+    timer->id = 301;
+    retval = CMX_STRUCT_RBTREE_INSERT_REF (&timers, timer, timer_compare);
+    printf ("%s - 5 - _REF takes reference\n", status (retval && 2 == CMX_ATOMIC_INT_LOAD (timer->cmx_refs) && timer == CMX_STRUCT_RBTREE_FIND (&timers, &probe, timer_compare)));
+    timer_unref (timer);
+
+    for (i = 0; i < ITEMS; i += 2) {
+        probe.id = ids[i];
+        found = CMX_STRUCT_RBTREE_FIND (&timers, &probe, timer_compare);
+        CMX_STRUCT_RBTREE_REMOVE (&timers, found);
+        timer_unref (found);
+    }
+    printf ("%s - 6 - tree stays balanced while items are removed\n", status (ITEMS / 2 + 1 == CMX_STRUCT_RBTREE_COUNT (&timers) && ITEMS / 2 == destroyed && valid (&timers)));
+
+    visited = 0;
+    CMX_STRUCT_RBTREE_FOREACH (&timers, timer) {
+        if (timer->id % 2) {
+            CMX_STRUCT_RBTREE_REMOVE (&timers, timer);
+            timer_unref (timer);
+            continue;
+        }
+        if (++visited > 10)
+            break;
+    }
+    printf ("%s - 7 - current item can be removed while iterating, break\n", status (11 == visited && valid (&timers)));
+
+    destroyed = 0;
+    i = CMX_STRUCT_RBTREE_COUNT (&timers);
+    CMX_STRUCT_RBTREE_CLEAR (&timers, timer_unref);
+    printf ("%s - 8 - clear releases all references\n", status (CMX_STRUCT_RBTREE_EMPTY_P (&timers) && 0 == CMX_STRUCT_RBTREE_COUNT (&timers) && i == destroyed));
+
+    return failed;
+}
@@ -0,0 +1,97 @@
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-struct-refs.h>
+
+#define THREADS 4
+#define ITEMS   100000
+
+struct Obj {
+    CMX_STRUCT_REFS_DEFINE;
+};
+
+struct Obj obj;
+CMX_ATOMIC_INT_TYPE destroyed;
+CMX_ATOMIC_INT_TYPE released;
+
+struct Obj * obj_ref (struct Obj *self) {
+    CMX_STRUCT_REFS_REF (self);
+}
+
+void obj_unref (struct Obj *self) {
+    CMX_STRUCT_REFS_UNREF (self) {
+        CMX_ATOMIC_INT_FETCH_ADD (destroyed, 1);
+    }
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void * worker (void *arg) {
+    struct timespec delay = { 0, 20 * 1000 * 1000 };
+    int i;
+
+    (void) arg;
+
+    /* in-flight user: churn own references, then release the one
+     * taken by main thread */
+    for (i = 0; i < ITEMS; ++i)
+        obj_unref (obj_ref (&obj));
+
+    nanosleep (&delay, NULL);
+    CMX_ATOMIC_INT_FETCH_ADD (released, 1);
+    obj_unref (&obj);
+
+    return NULL;
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    double start;
+    double waited;
+    int i;
+
+    printf ("1..5\n");
+
+    CMX_STRUCT_REFS_INIT (&obj);
+    for (i = 0; i < THREADS; ++i) {
+        obj_ref (&obj);
+        pthread_create (&threads[i], NULL, worker, NULL);
+    }
+
+    start = now ();
+    CMX_STRUCT_REFS_WAIT_ZERO (&obj);
+    waited = now () - start;
+
+    printf ("%s - 1 - all users released references\n", status (THREADS == CMX_ATOMIC_INT_LOAD (released)));
+    printf ("%s - 2 - own reference is left\n", status (1 == CMX_ATOMIC_INT_LOAD (obj.cmx_refs)));
+    printf ("%s - 3 - object is not destroyed\n", status (0 == CMX_ATOMIC_INT_LOAD (destroyed)));
+
+    obj_unref (&obj);
+    printf ("%s - 4 - last unref destroys\n", status (1 == CMX_ATOMIC_INT_LOAD (destroyed)));
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+
+    CMX_STRUCT_REFS_INIT (&obj);
+    CMX_STRUCT_REFS_WAIT_ZERO (&obj);
+    printf ("%s - 5 - wait without other users returns\n", status (1 == CMX_ATOMIC_INT_LOAD (obj.cmx_refs)));
+
+    printf ("# drained in %.1f ms (users released after ~20 ms)\n", waited * 1e3);
+
+    return failed;
+}
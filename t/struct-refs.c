@@ -13,6 +13,32 @@
 #define CMX_ATOMIC_INT_DECREMENT_AND_TEST(Var)                          \
     (--(Var) == 0)
 
+#define CMX_ATOMIC_INT_LOAD(Var)                                        \
+    (Var)
+
+#define CMX_ATOMIC_INT_FETCH_SUB(Var, Value)                            \
+    (((Var) -= (Value)) + (Value))
+
+#define CMX_ATOMIC_INT_FETCH_OR(Var, Value)                             \
+    fetch_or (& (Var), (Value))
+
+#define CMX_ATOMIC_INT_FETCH_AND(Var, Value)                            \
+    fetch_and (& (Var), (Value))
+
+int fetch_or (int *var, int value) {
+    int previous = *var;
+
+    *var |= value;
+    return previous;
+}
+
+int fetch_and (int *var, int value) {
+    int previous = *var;
+
+    *var &= value;
+    return previous;
+}
+
 #include <cmx/cmx-struct-refs.h>
 
 int on_ref           = 0;
@@ -46,7 +72,7 @@ int main (void) {
     struct Dummy data = { .CMX_STRUCT_REFS_NAME = -1 };
 
     printf ("# cmx-struct-refs workflow (using custom, \"mocked\", atomic macros)\n");
-    printf ("1..11\n");
+    printf ("1..12\n");
     printf ("%s 1 - static init\n", status (data.CMX_STRUCT_REFS_NAME == -1));
 
     CMX_STRUCT_REFS_INIT (&(data));
@@ -70,5 +96,9 @@ int main (void) {
     printf ("%s 10 - unref 'destroy' block called\n", status (on_unref_destroy == 1));
     printf ("%s 11 - refcount after second unref\n", status (data.CMX_STRUCT_REFS_NAME == 0));
 
+    CMX_STRUCT_REFS_INIT (&(data));
+    CMX_STRUCT_REFS_WAIT_ZERO (&data);
+    printf ("%s 12 - wait zero returns with only own reference\n", status (data.CMX_STRUCT_REFS_NAME == 1));
+
     return failed;
 }
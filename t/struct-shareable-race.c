@@ -0,0 +1,88 @@
+
+#include <stdio.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-struct-shareable.h>
+
+#define THREADS 4
+#define ROUNDS  100
+#define ITEMS   100
+
+struct Obj {
+    CMX_STRUCT_SHAREABLE_DEFINE;
+    int value;
+};
+
+struct Obj objs[ROUNDS];
+CMX_ATOMIC_INT_TYPE on_share;
+CMX_ATOMIC_INT_TYPE ready;
+
+struct Obj * obj_share (struct Obj *self) {
+    CMX_STRUCT_SHAREABLE_SHARE (self) {
+        CMX_ATOMIC_INT_FETCH_ADD (on_share, 1);
+    }
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+void * worker (void *arg) {
+    int round;
+    int i;
+
+    (void) arg;
+    for (round = 0; round < ROUNDS; ++round) {
+        /* every round starts with all threads sharing new object */
+        CMX_ATOMIC_INT_FETCH_ADD (ready, 1);
+        while (CMX_ATOMIC_INT_LOAD (ready) < THREADS * (round + 1))
+            sched_yield ();
+
+        obj_share (&objs[round]);
+        for (i = 0; i < ITEMS; ++i)
+            CMX_STRUCT_SHAREABLE_SYNCHRONIZE (&objs[round])
+                ++objs[round].value;
+    }
+
+    return NULL;
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    int shared = 1;
+    int values = 1;
+    int i;
+
+    printf ("1..4\n");
+
+    for (i = 0; i < ROUNDS; ++i) {
+        CMX_STRUCT_SHAREABLE_INIT (&objs[i]);
+        objs[i].value = 0;
+    }
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+
+    for (i = 0; i < ROUNDS; ++i) {
+        if (CMX_STRUCT_SHAREABLE_SHARED != CMX_ATOMIC_INT_LOAD (objs[i].cmx_struct_shareable.enabled))
+            shared = 0;
+        if (THREADS * ITEMS != objs[i].value)
+            values = 0;
+    }
+
+    printf ("%s - 1 - concurrent share evaluates block once\n", status (ROUNDS == CMX_ATOMIC_INT_LOAD (on_share)));
+    printf ("%s - 2 - structs are shared\n", status (shared));
+    printf ("%s - 3 - synchronized updates are not lost\n", status (values));
+
+    obj_share (&objs[0]);
+    printf ("%s - 4 - repeated share evaluates else\n", status (ROUNDS == CMX_ATOMIC_INT_LOAD (on_share)));
+
+    return failed;
+}
@@ -7,9 +7,46 @@
 #define CMX_MUTEX_LOCK(Var)     ++(Var)
 #define CMX_MUTEX_UNLOCK(Var)   --(Var)
 
+int atomic_ops = 0;
+
+#define CMX_SINGLE_THREAD_P()     0
+#define CMX_ATOMIC_INT_TYPE       int
+#define CMX_ATOMIC_INT_SET(Var, Value)                                  \
+    (++atomic_ops, (Var) = (Value))
+#define CMX_ATOMIC_INT_INCREMENT(Var)                                   \
+    (++atomic_ops, ++(Var))
+#define CMX_ATOMIC_INT_DECREMENT_AND_TEST(Var)                          \
+    (++atomic_ops, 0 == --(Var))
+#define CMX_ATOMIC_INT_FETCH_SUB(Var, Value)                            \
+    (++atomic_ops, ((Var) -= (Value)) + (Value))
+#define CMX_ATOMIC_INT_FETCH_OR(Var, Value)                             \
+    fetch_or (& (Var), (Value))
+#define CMX_ATOMIC_INT_FETCH_AND(Var, Value)                            \
+    fetch_and (& (Var), (Value))
+#define CMX_ATOMIC_INT_LOAD(Var)  (Var)
+#define CMX_ATOMIC_INT_STORE(Var, Value)                                \
+    ((Var) = (Value))
+#define CMX_ATOMIC_INT_COMPARE_EXCHANGE(Var, Expected, Desired)         \
+    ((Var) == (Expected) ? ((Var) = (Desired), 1) : ((Expected) = (Var), 0))
+
+int fetch_or (int *var, int value) {
+    int previous = *var;
+
+    *var |= value;
+    return previous;
+}
+
+int fetch_and (int *var, int value) {
+    int previous = *var;
+
+    *var &= value;
+    return previous;
+}
+
 #include <cmx/cmx-struct-shareable.h>
 
 int on_share = 0;
+int destroyed = 0;
 
 struct Dummy {
     CMX_STRUCT_SHAREABLE_DEFINE;
@@ -21,6 +58,25 @@ struct Dummy * struct_shareable_share (struct Dummy *ptr) {
     }
 }
 
+struct Counted {
+    CMX_STRUCT_REFS_DEFINE;
+    CMX_STRUCT_SHAREABLE_DEFINE;
+};
+
+struct Counted * counted_share (struct Counted *ptr) {
+    CMX_STRUCT_SHAREABLE_SHARE (ptr) { }
+}
+
+struct Counted * counted_ref (struct Counted *ptr) {
+    CMX_STRUCT_SHAREABLE_REFS_REF (ptr);
+}
+
+void counted_unref (struct Counted *ptr) {
+    CMX_STRUCT_SHAREABLE_REFS_UNREF (ptr) {
+        destroyed ++;
+    }
+}
+
 int failed = 0;
 char * status (int status) {
     if (! status) ++failed;
@@ -101,6 +157,33 @@ void check_struct_shareable_is_shared (void) {
     printf ("  %s 4 - unlocked \"mutex\" value\n", status (data.shared.mutex == 0));
 }
 
+void check_struct_shareable_refs (void) {
+    struct Counted data = { .shared = { -1, UNINITIALIZED_MUTEX_VALUE } };
+
+    CMX_STRUCT_REFS_INIT (&data);
+    CMX_STRUCT_SHAREABLE_INIT (&data);
+    atomic_ops = 0;
+    destroyed = 0;
+
+    printf ("  1..6\n");
+
+    counted_ref (&data);
+    counted_unref (&data);
+    printf ("  %s 1 - unshared ref/unref\n", status (1 == data.cmx_refs && 0 == destroyed));
+    printf ("  %s 2 - unshared uses plain arithmetic\n", status (0 == atomic_ops));
+
+    counted_share (&data);
+    printf ("  %s 3 - ref retval\n", status (&data == counted_ref (&data)));
+    counted_unref (&data);
+    printf ("  %s 4 - shared uses atomic arithmetic\n", status (2 == atomic_ops && 1 == data.cmx_refs));
+
+    counted_unref (&data);
+    printf ("  %s 5 - last unref destroys\n", status (1 == destroyed && 3 == atomic_ops));
+
+    counted_unref (NULL);
+    printf ("  %s 6 - NULL safe\n", status (3 == atomic_ops && 1 == destroyed));
+}
+
 void subtest (int num, const char * name, void (*function) (void)) {
     int local = failed;
 
@@ -119,12 +202,13 @@ int main (void) {
     struct Dummy data = { 0 };
     CMX_STRUCT_SHAREABLE_INIT (&data);
 
-    printf ("1..4\n");
+    printf ("1..5\n");
 
     subtest (1, "init macro", check_struct_shareable_init);
     subtest (2, "struct share ()", check_struct_shareable_shared);
     subtest (3, "is not shared workflow", check_struct_shareable_is_not_shared);
     subtest (4, "is shared workflow", check_struct_shareable_is_shared);
+    subtest (5, "shareable refs", check_struct_shareable_refs);
 
     return failed;
 }
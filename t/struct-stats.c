@@ -0,0 +1,162 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+#define CMX_STRUCT_STATS_ENABLED 1
+
+#include <cmx/cmx-struct-stats.h>
+
+#define THREADS 4
+#define ITEMS   10000
+
+/* benchmark: ref / unref pairs */
+#define BENCH_OPS 10000000
+
+struct Job {
+    CMX_STRUCT_REFS_DEFINE;
+    int value;
+};
+
+struct Plain {
+    CMX_STRUCT_REFS_DEFINE;
+};
+
+CMX_STRUCT_STATS_STORAGE;
+CMX_STRUCT_STATS_TYPE_STORAGE (Job);
+CMX_STRUCT_STATS_TYPE_STORAGE (Unused);
+
+struct Job * job_new (void) {
+    struct Job *retval = malloc (sizeof (*retval));
+
+    CMX_STRUCT_REFS_INIT_STATS (retval, Job);
+
+    return retval;
+}
+
+struct Job * job_ref (struct Job *self) {
+    CMX_STRUCT_REFS_REF_STATS (self, Job);
+}
+
+void job_unref (struct Job *self) {
+    CMX_STRUCT_REFS_UNREF_STATS (self, Job) {
+        free (self);
+    }
+}
+
+struct Plain * plain_ref (struct Plain *self) {
+    CMX_STRUCT_REFS_REF (self);
+}
+
+void plain_unref (struct Plain *self) {
+    CMX_STRUCT_REFS_UNREF (self) { }
+}
+
+void * worker (void *arg) {
+    struct Job *job;
+    int i;
+
+    (void) arg;
+    for (i = 0; i < ITEMS; ++i) {
+        job = job_new ();
+        job_ref (job);
+        job_unref (job);
+        job_unref (job);
+    }
+
+    return NULL;
+}
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+double now (void) {
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    struct CMX_Struct_Stats_Snapshot snapshot;
+    struct Job *jobs[100];
+    struct Plain plain;
+    struct Job *bench;
+    FILE *dump;
+    char line[256];
+    double counted;
+    double uncounted;
+    size_t peak;
+    int types = 0;
+    int i;
+
+    printf ("1..7\n");
+
+    CMX_STRUCT_STATS_FOREACH (snapshot)
+        ++types;
+    printf ("%s - 1 - type is registered by first created object\n", status (0 == types));
+
+    for (i = 0; i < 100; ++i)
+        jobs[i] = job_new ();
+    for (i = 0; i < 60; ++i)
+        job_unref (jobs[i]);
+
+    CMX_STRUCT_STATS_FOREACH (snapshot)
+        ++types;
+    printf ("%s - 2 - only used type is registered\n", status (1 == types && 0 == strcmp ("Job", snapshot.name)));
+    printf ("%s - 3 - live, peak, created and destroyed\n", status (40 == snapshot.live && snapshot.peak > 100 - CMX_STRUCT_STATS_PEAK_INTERVAL && snapshot.peak <= 100 && 100 == snapshot.created && 60 == snapshot.destroyed));
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+
+    peak = snapshot.peak;
+    CMX_STRUCT_STATS_FOREACH (snapshot) { }
+    printf ("%s - 4 - no counted operation lost by threads\n", status (40 == snapshot.live && 100 + THREADS * ITEMS == snapshot.created && THREADS * ITEMS == snapshot.refs && 60 + 2 * THREADS * ITEMS == snapshot.unrefs));
+    printf ("%s - 5 - rates are computed since previous snapshot\n", status (snapshot.destroy_rate > 0 && snapshot.ref_rate > 0 && snapshot.unref_rate > snapshot.ref_rate));
+
+    for (i = 60; i < 100; ++i)
+        job_unref (jobs[i]);
+    CMX_STRUCT_STATS_FOREACH (snapshot)
+        break;
+    printf ("%s - 6 - peak stays after objects are destroyed\n", status (0 == snapshot.live && snapshot.peak >= peak && 0 == snapshot.ref_rate));
+
+    dump = tmpfile ();
+    types = CMX_STRUCT_STATS_DUMP (dump);
+    rewind (dump);
+    printf ("%s - 7 - dump writes one line per type\n", status (1 == types && fgets (line, sizeof (line), dump) && 0 == strncmp ("Job: live 0, peak ", line, 18)));
+    fclose (dump);
+
+    bench = job_new ();
+    CMX_STRUCT_REFS_INIT (&plain);
+    counted = now ();
+    for (i = 0; i < BENCH_OPS; ++i) {
+        job_ref (bench);
+        job_unref (bench);
+    }
+    counted = now () - counted;
+
+    uncounted = now ();
+    for (i = 0; i < BENCH_OPS; ++i) {
+        plain_ref (&plain);
+        plain_unref (&plain);
+    }
+    uncounted = now () - uncounted;
+    job_unref (bench);
+
+    printf (
+        "# ref / unref: counted %.1f ns, plain %.1f ns\n",
+        counted * 1e9 / BENCH_OPS,
+        uncounted * 1e9 / BENCH_OPS
+    );
+
+    return failed;
+}
@@ -4,12 +4,25 @@
 #define CMX_STRUCT_SHAREABLE_NAME shared
 #define CMX_MUTEX_TYPE            int
 #define CMX_MUTEX_INIT(Var)       (Var) = 0
-#define CMX_MUTEX_LOCK(Var)     ++(Var)
-#define CMX_MUTEX_UNLOCK(Var)   --(Var)
+#define CMX_MUTEX_LOCK(Var)     (++(Var), lock_log[lock_count++ % 8] = &(Var))
+#define CMX_MUTEX_UNLOCK(Var)   (--(Var), unlock_log[unlock_count++ % 8] = &(Var))
 #define CMX_MUTEX_CREATE          0
 
+int *lock_log[8];
+int *unlock_log[8];
+int lock_count = 0;
+int unlock_count = 0;
+
 #include <cmx/cmx.h>
 
+struct Dummy {
+    CMX_STRUCT_SHAREABLE_DEFINE;
+};
+
+struct Dummy * dummy_share (struct Dummy *ptr) {
+    CMX_STRUCT_SHAREABLE_SHARE (ptr) { }
+}
+
 int t_run_only_once (void) {
     static int counter = 0;
 
@@ -26,10 +39,82 @@ const char * status (int status) {
     return status ? "ok" : "not ok";
 }
 
+int t_multi_locked (int *m) {
+    int retval = 0;
+
+    lock_count = unlock_count = 0;
+    CMX_SYNCHRONIZE_MULTI (&m[2], NULL, &m[0], &m[2], &m[1]) {
+        retval = 1 == m[0] && 1 == m[1] && 1 == m[2]
+            && 3 == lock_count
+            && &m[0] == lock_log[0] && &m[1] == lock_log[1] && &m[2] == lock_log[2];
+    }
+
+    return retval;
+}
+
+int t_multi_unlocked (int *m) {
+    return 0 == m[0] && 0 == m[1] && 0 == m[2]
+        && 3 == unlock_count
+        && &m[2] == unlock_log[0] && &m[1] == unlock_log[1] && &m[0] == unlock_log[2];
+}
+
+int t_multi_break (int *m) {
+    int reached = 0;
+
+    CMX_SYNCHRONIZE_MULTI (&m[1], &m[0]) {
+        if (m[0])
+            break;
+        reached = 1;
+    }
+
+    return ! reached && 0 == m[0] && 0 == m[1];
+}
+
+int t_multi_shareable (void) {
+    struct Dummy shared;
+    struct Dummy unshared;
+    int retval = 0;
+
+    CMX_STRUCT_SHAREABLE_INIT (&shared);
+    CMX_STRUCT_SHAREABLE_INIT (&unshared);
+    dummy_share (&shared);
+
+    lock_count = 0;
+    CMX_SYNCHRONIZE_MULTI (
+        CMX_STRUCT_SHAREABLE_MUTEX (&unshared),
+        CMX_STRUCT_SHAREABLE_MUTEX (&shared),
+        CMX_STRUCT_SHAREABLE_MUTEX ((struct Dummy *) NULL)
+    ) {
+        retval = 1 == lock_count && &shared.shared.mutex == lock_log[0];
+    }
+
+    return retval && 0 == shared.shared.mutex;
+}
+
+int t_if_with (int *m, int cond) {
+    int retval = 0;
+
+    CMX_SYNCHRONIZE_IF_WITH (&m[0], cond) {
+        retval = 1 == m[0] && cond;
+    } else {
+        retval = 1 == m[0] && ! cond;
+    }
+
+    return retval && 0 == m[0];
+}
+
 int main (void) {
-    printf ("1..2\n");
+    int m[3] = { 0, 0, 0 };
+
+    printf ("1..8\n");
     printf ("%s - 1 - run_only_once 1st time\n", status (t_run_only_once ()));
     printf ("%s - 2 - run_only_once 2nd time\n", status (t_run_only_once ()));
+    printf ("%s - 3 - multi locks unique mutexes in address order\n", status (t_multi_locked (m)));
+    printf ("%s - 4 - multi unlocks in reverse order\n", status (t_multi_unlocked (m)));
+    printf ("%s - 5 - multi unlocks on break\n", status (t_multi_break (m)));
+    printf ("%s - 6 - multi skips unshared struct\n", status (t_multi_shareable ()));
+    printf ("%s - 7 - if_with evaluates block\n", status (t_if_with (m, 1)));
+    printf ("%s - 8 - if_with evaluates else-clause\n", status (t_if_with (m, 0)));
 
     return failed;
 }
@@ -0,0 +1,92 @@
+
+#include <stdio.h>
+#include <pthread.h>
+
+#define HAVE_CMX_ENV_POSIX 1
+
+#include <cmx/cmx-thread-local.h>
+
+#define THREADS 4
+#define CALLS   100
+
+struct Scratch {
+    int id;
+    int uses;
+};
+
+CMX_ATOMIC_INT_TYPE once_counter;
+CMX_ATOMIC_INT_TYPE else_counter;
+CMX_ATOMIC_INT_TYPE inits;
+CMX_ATOMIC_INT_TYPE destroys;
+CMX_ATOMIC_INT_TYPE uses;
+
+void scratch_init (struct Scratch *scratch) {
+    scratch->id = CMX_ATOMIC_INT_FETCH_ADD (inits, 1) + 1;
+    scratch->uses = 0;
+}
+
+void scratch_destroy (struct Scratch *scratch) {
+    CMX_ATOMIC_INT_FETCH_ADD (destroys, 1);
+    CMX_ATOMIC_INT_FETCH_ADD (uses, scratch->uses);
+}
+
+CMX_THREAD_LAZY (struct Scratch, scratch, scratch_init, scratch_destroy);
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+void run_once (void) {
+    CMX_RUN_ONCE_PER_THREAD {
+        CMX_ATOMIC_INT_FETCH_ADD (once_counter, 1);
+    } else {
+        CMX_ATOMIC_INT_FETCH_ADD (else_counter, 1);
+    }
+}
+
+void * worker (void *arg) {
+    struct Scratch *first = scratch ();
+    int same = 1;
+    int i;
+
+    (void) arg;
+    for (i = 0; i < CALLS; ++i) {
+        run_once ();
+        if (scratch () != first)
+            same = 0;
+        ++scratch ()->uses;
+    }
+
+    return (void *) (size_t) same;
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    size_t same = 0;
+    int i;
+
+    printf ("1..7\n");
+
+    run_once ();
+    run_once ();
+    printf ("%s - 1 - run once per thread\n", status (1 == CMX_ATOMIC_INT_LOAD (once_counter)));
+    printf ("%s - 2 - else clause on subsequent call\n", status (1 == CMX_ATOMIC_INT_LOAD (else_counter)));
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    for (i = 0; i < THREADS; ++i) {
+        void *retval;
+        pthread_join (threads[i], &retval);
+        same += (size_t) retval;
+    }
+
+    printf ("%s - 3 - run once in every thread\n", status (1 + THREADS == CMX_ATOMIC_INT_LOAD (once_counter)));
+    printf ("%s - 4 - lazy value initialized once per thread\n", status (THREADS == CMX_ATOMIC_INT_LOAD (inits)));
+    printf ("%s - 5 - lazy value is stable within thread\n", status (THREADS == same));
+    printf ("%s - 6 - lazy value destroyed at thread exit\n", status (THREADS == CMX_ATOMIC_INT_LOAD (destroys)));
+    printf ("%s - 7 - values are per thread\n", status (THREADS * CALLS == CMX_ATOMIC_INT_LOAD (uses)));
+
+    return failed;
+}
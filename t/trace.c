@@ -0,0 +1,103 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#define CMX_TRACE_ENABLED     1
+#define CMX_TRACE_BUFFER_SIZE 1024
+
+#if defined (__x86_64__) || defined (__i386__)
+#define CMX_TRACE_TICKS()     __builtin_ia32_rdtsc ()
+#endif
+
+#include <cmx/cmx-trace.h>
+
+#define THREADS 4
+#define SPANS   100
+
+CMX_TRACE_STORAGE;
+
+int failed = 0;
+const char * status (int status) {
+    if (! status) failed ++;
+    return status ? "ok" : "not ok";
+}
+
+size_t count (const char *haystack, const char *needle) {
+    size_t retval = 0;
+
+    while (NULL != (haystack = strstr (haystack, needle))) {
+        ++retval;
+        ++haystack;
+    }
+
+    return retval;
+}
+
+void * worker (void *arg) {
+    int i;
+
+    (void) arg;
+    for (i = 0; i < SPANS; ++i)
+        CMX_TRACE ("worker")
+            ;
+
+    return NULL;
+}
+
+int main (void) {
+    pthread_t threads[THREADS];
+    char output[1 << 20];
+    FILE *file;
+    size_t written;
+    uint64_t start;
+    int executed = 0;
+    int i;
+
+    printf ("1..7\n");
+
+    CMX_TRACE ("outer") {
+        CMX_TRACE ("inner \"quoted\"")
+            ++executed;
+        CMX_TRACE ("break") {
+            ++executed;
+            break;
+            ++executed;
+        }
+    }
+    printf ("%s - 1 - blocks executed, break leaves span\n", status (2 == executed));
+
+    for (i = 0; i < THREADS; ++i)
+        pthread_create (&threads[i], NULL, worker, NULL);
+    for (i = 0; i < THREADS; ++i)
+        pthread_join (threads[i], NULL);
+
+    file = fmemopen (output, sizeof (output), "w");
+    written = CMX_TRACE_FLUSH (file);
+    fclose (file);
+
+    printf ("%s - 2 - flush returns number of events\n", status (3 + THREADS * SPANS == written));
+    printf ("%s - 3 - complete events written\n", status (written == count (output, "\"ph\":\"X\"")));
+    printf ("%s - 4 - span names escaped\n", status (1 == count (output, "\"inner \\\"quoted\\\"\"")));
+    printf ("%s - 5 - one tid per thread\n", status (SPANS == count (output, "\"tid\":5,")));
+
+    file = fmemopen (output, sizeof (output), "w");
+    for (i = 0; i < 2 * CMX_TRACE_BUFFER_SIZE; ++i)
+        CMX_TRACE ("overflow")
+            ;
+    written = CMX_TRACE_FLUSH (file);
+    fclose (file);
+    printf ("%s - 6 - full buffer drops events\n", status (CMX_TRACE_BUFFER_SIZE + 1 == written));
+    printf ("%s - 7 - dropped events reported\n", status (1 == count (output, "dropped 1024 events")));
+
+    file = fmemopen (output, sizeof (output), "w");
+    start = cmx_trace_clock ();
+    for (i = 0; i < CMX_TRACE_BUFFER_SIZE; ++i)
+        CMX_TRACE ("overhead")
+            ;
+    printf ("# %.1f ns per span\n", (double) (cmx_trace_clock () - start) / CMX_TRACE_BUFFER_SIZE);
+    CMX_TRACE_FLUSH (file);
+    fclose (file);
+
+    return failed;
+}